@@ -1,28 +1,75 @@
 #ifndef RED_BUFFER_H
 #define RED_BUFFER_H
 
-#include <windows.h>
+#include <iterator>
+#include <memory>
 #include <string>
-#include "gap_buffer.h"
+#include <string_view>
+#include "storage.h"
+#include "display_width.h"
 #include "iterator.h"
+#include "line_index.h"
+#include "undo.h"
+
+struct File_load;
 
 struct Buffer {
-	using Buffer_storage = Gap_buffer;
+	using Buffer_storage = Text_storage;
 	using size_type = Buffer_storage::size_type;
-	using iterator = Indexed_iterator;
+	using iterator = Indexed_iterator<Buffer_storage>;
 
 	std::string name;
 	Buffer_storage contents;
-	bool modified;
+	bool modified = false;
+	Line_index lines;
+	Column_index columns;
+	Undo_journal history;
+	// The rest of the file while it is still being read, see file.h
+	std::shared_ptr<File_load> load;
 
-	bool write_file(HANDLE file_handle);
+	Buffer();
+	Buffer(std::string name, Buffer_storage contents);
 
 	iterator begin();
 	iterator end();
 
 	void insert(iterator i, char c);
+	void insert(iterator i, std::string_view text);
+
+	template <typename I, typename = typename std::iterator_traits<I>::iterator_category>
+	// requires InputIterator(I) && ValueType(I) == char
+	void insert(iterator i, I f, I l)
+	{
+		insert(i, std::string(f, l));
+	}
+
 	void erase(iterator i);
 	iterator erase(iterator f, iterator l);
+
+	/*
+	 * Replaces [f, l) with `text`, returns the position after the new text.
+	 */
+	iterator replace(iterator f, iterator l, std::string_view text);
+
+	/*
+	 * Undoes or redoes the last group of edits in the history and moves
+	 * `cursor` to where it was, returns false if there was nothing to do.
+	 */
+	bool undo(iterator& cursor);
+	bool redo(iterator& cursor);
+
+	size_type line_count() const;
+	size_type line_number(iterator i) const;
+	iterator line_begin(size_type line);
+
+	/*
+	 * The display column of `i` on its line, and the first position on the
+	 * line starting at `line` at or past `column` (or the end of the line),
+	 * see Column_index.
+	 */
+	int column(iterator i);
+	iterator column_position(iterator line, int column);
+	iterator column_position(iterator line, int column, int& reached);
 };
 
 #endif
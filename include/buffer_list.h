@@ -0,0 +1,107 @@
+#ifndef RED_BUFFER_LIST_H
+#define RED_BUFFER_LIST_H
+
+#include "platform.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "buffer.h"
+
+/*
+ * Where a view was left in a buffer, as offsets so it survives the text being
+ * released and read back.
+ */
+struct Buffer_position {
+	Buffer::size_type cursor = 0;
+	Buffer::size_type top_line = 0;
+	int first_column = 0;
+	int column_desired = 0;
+};
+
+/*
+ * Buffer_list
+ *
+ * The buffers open in the editor, each with the position its view was left
+ * at.  Buffers keep their address while others are added and removed, so a
+ * View can point into one.
+ *
+ * The text of an unmodified buffer read from a file can be read again.  When
+ * the buffers hold more than the memory budget, the least recently shown of
+ * those that have been read in full have their storage released.  A released
+ * buffer keeps its name and position and is read back when it is next shown,
+ * its undo history is lost.
+ */
+class Buffer_list {
+public:
+	using size_type = std::size_t;
+
+	static constexpr size_type default_memory_budget = 256 * 1024 * 1024;
+
+private:
+	struct Entry {
+		std::unique_ptr<Buffer> buffer;
+		Buffer_position position;
+		std::uint64_t last_shown = 0;
+		bool released = false;
+	};
+
+	std::vector<Entry> entries;
+	std::uint64_t clock = 0;
+	size_type budget = default_memory_budget;
+
+	Entry& entry(const Buffer& buffer);
+	const Entry& entry(const Buffer& buffer) const;
+	static size_type memory_used(const Entry& x);
+	bool releasable(const Entry& x, const Buffer* current) const;
+
+public:
+	/*
+	 * Adds `buffer` as the least recently shown, returns where it now lives.
+	 */
+	Buffer& add(Buffer buffer);
+
+	/*
+	 * Removes a buffer, references to it are invalidated.
+	 */
+	void remove(Buffer& buffer);
+
+	bool contains(const Buffer* buffer) const;
+
+	/*
+	 * The buffer with `name`, or nullptr
+	 */
+	Buffer* find(std::string_view name);
+
+	/*
+	 * The most recently shown buffer other than `buffer`, or nullptr
+	 */
+	Buffer* alternate(const Buffer& buffer);
+
+	size_type size() const;
+	size_type modified_count() const;
+
+	/*
+	 * Reads the text of `buffer` back if it was released and makes it the
+	 * most recently shown.  Returns 0 or the error from reading the file, the
+	 * buffer stays released on error.
+	 */
+	DWORD show(Buffer& buffer);
+
+	bool released(const Buffer& buffer) const;
+	Buffer_position& position(const Buffer& buffer);
+
+	/*
+	 * Releases the least recently shown unmodified buffers, other than
+	 * `current`, until the text held fits in the budget.  Nothing is released
+	 * while a save is being written, the file on disk may be out of date.
+	 */
+	void trim(const Buffer* current);
+
+	size_type memory_used() const;
+	size_type memory_budget() const;
+	void set_memory_budget(size_type bytes);
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef RED_BYTE_SEARCH_H
+#define RED_BYTE_SEARCH_H
+
+#include <cstddef>
+
+/*
+ * Byte search kernels over a contiguous range of memory.  On x86-64 these use
+ * SSE2, or AVX2 when the processor supports it, and fall back to scalar loops
+ * elsewhere.  The implementation is picked the first time one is called.
+ */
+
+enum class Simd_level {
+	scalar,
+	sse2,
+	avx2
+};
+
+/*
+ * Returns the first occurrence of `c` in [first, last), or last.
+ */
+const char* find_byte(const char* first, const char* last, char c);
+
+/*
+ * Returns the position after the last occurrence of `c` in [first, last), or
+ * first if there isn't one.  Matches the convention of find_backward.
+ */
+const char* find_byte_backward(const char* first, const char* last, char c);
+
+/*
+ * Returns the number of occurrences of `c` in [first, last).
+ */
+std::size_t count_byte(const char* first, const char* last, char c);
+
+/*
+ * The best implementation supported by this processor, and the one in use.
+ * Selecting a level above the supported one has no effect, this is used by
+ * the tests and benchmarks to compare the implementations.
+ */
+Simd_level byte_search_supported();
+Simd_level byte_search_level();
+void byte_search_select(Simd_level level);
+
+#endif
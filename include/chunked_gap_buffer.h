@@ -0,0 +1,106 @@
+#ifndef RED_CHUNKED_GAP_BUFFER_H
+#define RED_CHUNKED_GAP_BUFFER_H
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "fenwick_tree.h"
+#include "gap_buffer.h"
+#include "iterator.h"
+
+/*
+ * Chunked_gap_buffer
+ *
+ * The text is split across a sequence of blocks of at most `block_size`
+ * bytes, each block is a Gap_buffer with its own gap.  An edit only moves the
+ * gap of the block it lands in, and a block that fills up is split in two, so
+ * no edit moves more than `block_size` bytes no matter how far it is from the
+ * previous one.
+ *
+ * A Fenwick tree over the block sizes finds the block holding an offset in
+ * O(log n).  Each block contributes two contiguous segments, the text before
+ * and after its gap, which generalises Gap_buffer's begin0/end0/begin1/end1.
+ *
+ * share() shares every block, so an edit made while a snapshot is held
+ * copies at most the one block it lands in.
+ */
+class Chunked_gap_buffer {
+public:
+	using value_type = char;
+	using reference = const value_type&;
+	using size_type = std::size_t;
+	using iterator = Indexed_iterator<Chunked_gap_buffer>;
+
+	static constexpr size_type block_size = 64 * 1024;
+
+private:
+	// Never holds an empty block
+	std::vector<Gap_buffer> blocks;
+	Fenwick_tree<size_type> sizes;
+
+	// The block most recently found by operator[], makes sequential access O(1)
+	mutable size_type cache_block = 0;
+	mutable size_type cache_begin = 0;
+	mutable size_type cache_end = 0;
+
+	size_type find_block(size_type& position) const;
+	void rebuild_sizes();
+	void split_block(size_type block, size_type offset);
+
+public:
+	Chunked_gap_buffer() = default;
+	explicit Chunked_gap_buffer(std::string_view text);
+
+	size_type size() const;
+
+	reference operator[](size_type i) const;
+
+	/*
+	 * The text is made up of segment_count() contiguous, possibly empty,
+	 * segments.
+	 */
+	size_type segment_count() const;
+	std::string_view segment(size_type k) const;
+
+	/*
+	 * Appends the segments to `segments`, they stay as they are however the
+	 * buffer is edited for as long as the returned pointer is held, which
+	 * may be on another thread.
+	 */
+	std::shared_ptr<const void> share(std::vector<std::string_view>& segments);
+
+	/*
+	 * The contiguous run of text that starts at offset `i` and extends to
+	 * the end of its segment, empty when i == size().
+	 */
+	std::string_view segment_from(size_type i) const;
+
+	/*
+	 * The contiguous run of text that ends at offset `i` and extends back
+	 * to the start of the segment holding i - 1, empty when i == 0.
+	 */
+	std::string_view segment_to(size_type i) const;
+
+	iterator begin();
+	iterator end();
+
+	void insert(iterator i, size_type n, char c);
+	void insert(iterator i, std::string_view text);
+	void insert(iterator i, const char* f, const char* l);
+
+	template <typename I, typename = typename std::iterator_traits<I>::iterator_category>
+	// requires InputIterator(I) && ValueType(I) == char
+	void insert(iterator i, I f, I l)
+	{
+		insert(i, std::string(f, l));
+	}
+
+	void erase(iterator i, size_type n);
+	iterator erase(iterator f, iterator l);
+	void replace(iterator f, iterator l, std::string_view text);
+};
+
+#endif
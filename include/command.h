@@ -23,7 +23,33 @@ inline unsigned control(unsigned key_code)
 }
 
 void commands_initialize();
+
+/*
+ * Handles one key, returns true if the editor should exit.  A command
+ * needing more keys leaves a mode or prompt for the keys after it, and
+ * command_pending is true until it has had them.
+ */
 bool evaluate(Editor_state& editor, Key_input input);
+bool command_pending();
+
+/*
+ * `trace` is called with a command's name before and after it runs, the
+ * keys of a mode or prompt run commands of their own.  The display refreshes
+ * between commands are traced as "display_refresh".
+ */
+void command_set_trace(void (*trace)(const char* name, bool done));
+
+/*
+ * Shows the result of a background save that has finished on the status
+ * line, returns false if there wasn't one.
+ */
+bool report_saves(Editor_state& editor);
+
+/*
+ * Appends what has been read of the file being shown and reports the
+ * progress on the status line, returns false if the buffer didn't change.
+ */
+bool report_loads(Editor_state& editor);
 
 COMMAND_FUNCTION(none);
 
@@ -31,6 +57,7 @@ COMMAND_FUNCTION(backward_char);
 COMMAND_FUNCTION(backward_word);
 COMMAND_FUNCTION(forward_line);
 COMMAND_FUNCTION(backward_line);
+COMMAND_FUNCTION(goto_line);
 COMMAND_FUNCTION(goto_beginning_of_line);
 COMMAND_FUNCTION(goto_beginning_of_file);
 COMMAND_FUNCTION(goto_end_of_line);
@@ -45,11 +72,18 @@ COMMAND_FUNCTION(leave_insert_mode);
 COMMAND_FUNCTION(write_file);
 COMMAND_FUNCTION(quit);
 COMMAND_FUNCTION(find_file);
+COMMAND_FUNCTION(switch_buffer);
+COMMAND_FUNCTION(kill_buffer);
+COMMAND_FUNCTION(show_latency);
 COMMAND_FUNCTION(search_forward);
+COMMAND_FUNCTION(search_backward);
+COMMAND_FUNCTION(search_next);
+COMMAND_FUNCTION(search_previous);
 COMMAND_FUNCTION(insert_self);
 COMMAND_FUNCTION(insert_newline);
 COMMAND_FUNCTION(backspace);
 COMMAND_FUNCTION(insert_tab);
+COMMAND_FUNCTION(insert_paste);
 COMMAND_FUNCTION(ctrlx_command);
 COMMAND_FUNCTION(open_line_after);
 COMMAND_FUNCTION(open_line_before);
@@ -61,5 +95,7 @@ COMMAND_FUNCTION(delete_to_end_of_line);
 COMMAND_FUNCTION(deindent_line);
 COMMAND_FUNCTION(scroll_down);
 COMMAND_FUNCTION(scroll_up);
+COMMAND_FUNCTION(undo);
+COMMAND_FUNCTION(redo);
 
 #endif
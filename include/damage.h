@@ -0,0 +1,59 @@
+#ifndef RED_DAMAGE_H
+#define RED_DAMAGE_H
+
+#include <string_view>
+
+/*
+ * Unchanged cells between two changed spans on the same row that are cheaper
+ * to rewrite than to skip with a cursor movement.
+ */
+constexpr int damage_merge_gap = 8;
+
+/*
+ * for_each_damaged_span
+ *
+ * Compares two frames of `width` columns stored row by row and calls
+ * f(row, column, text) for each span of `next` that differs from `previous`,
+ * spans on the same row separated by fewer than damage_merge_gap unchanged
+ * cells are reported as one.  Both frames must be the same size.  Returns the
+ * number of spans reported, zero when only the cursor needs to move.
+ */
+template <typename F>
+// requires Procedure(F, int, int, std::string_view)
+int for_each_damaged_span(std::string_view previous, std::string_view next, int width, F f)
+{
+	int spans = 0;
+	int height = width > 0 ? static_cast<int>(next.size()) / width : 0;
+	for (int row = 0; row < height; ++row) {
+		std::string_view before = previous.substr(row * width, width);
+		std::string_view after = next.substr(row * width, width);
+		if (before == after)
+			continue;
+
+		int column = 0;
+		while (column < width) {
+			while (column < width && before[column] == after[column])
+				++column;
+			if (column == width)
+				break;
+			int first = column;
+			int last = column;
+			// extend the span over short runs of unchanged cells
+			while (column < width) {
+				if (before[column] != after[column]) {
+					last = ++column;
+				} else if (column - last >= damage_merge_gap) {
+					break;
+				} else {
+					++column;
+				}
+			}
+			f(row, first, after.substr(first, last - first));
+			column = last;
+			++spans;
+		}
+	}
+	return spans;
+}
+
+#endif
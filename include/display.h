@@ -3,9 +3,38 @@
 
 #include "editor.h"
 #include <string_view>
+#include "screen.h"
 
+/*
+ * Redraws the parts of the view that changed since the last refresh, and
+ * places the cursor.
+ */
 void display_refresh(View& view);
 
+/*
+ * Forgets what is on the screen so the next refresh redraws all of it, for
+ * when the screen has been resized or written to by something else.
+ */
+void display_invalidate();
+
+/*
+ * Shows `str` on the status line and leaves the cursor after it, or at
+ * `column` for a prompt.
+ */
 void set_status_line(std::string_view str);
+void set_status_prompt(std::string_view str, int column);
+
+/*
+ * The cursor style shown from the next frame on
+ */
+void display_cursor_style(Cursor_style style);
+
+/*
+ * Between these frames are drawn on a thread of their own, at most 120 a
+ * second and always the newest, and publishing one only copies it.  Outside
+ * them each is drawn before the call publishing it returns.
+ */
+void display_start_thread();
+void display_stop_thread();
 
 #endif
@@ -0,0 +1,88 @@
+#ifndef RED_DISPLAY_WIDTH_H
+#define RED_DISPLAY_WIDTH_H
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+#include "storage.h"
+
+/*
+ * How wide text is on the screen.  A tab advances to the next multiple of the
+ * tab width, any other byte is one column.  Moving between lines, framing the
+ * view and drawing it all count columns the same way through here.
+ */
+int tab_width();
+void set_tab_width(int width);
+
+inline int next_tab_stop(int column)
+{
+	int width = tab_width();
+	return column + width - column % width;
+}
+
+/*
+ * The column reached after `text` starting from `column`, the text must not
+ * hold a newline.  Runs between tabs are skipped with find_byte.
+ */
+int advance_column(int column, std::string_view text);
+
+/*
+ * Column_index
+ *
+ * Columns are counted from the start of the line, so converting between a
+ * column and an offset deep into a long line would mean measuring all of the
+ * line before it.  For lines longer than checkpoint_interval the index keeps
+ * the column at every checkpoint_interval bytes, built as far as they have
+ * been asked for, and a conversion only measures from the nearest one.
+ *
+ * The checkpoints of the most recently used lines are kept.  An edit drops
+ * the checkpoints after it on its line and moves the lines after it, like
+ * Line_index the caller passes the storage and keeps the two in sync.
+ */
+class Column_index {
+public:
+	using size_type = std::size_t;
+
+	static constexpr size_type checkpoint_interval = 4096;
+	static constexpr size_type max_lines = 64;
+
+private:
+	struct Line {
+		size_type begin;
+		int tab_width;
+		// The column at begin + (i + 1) * checkpoint_interval
+		std::vector<int> checkpoints;
+		// The line ends before the next checkpoint
+		bool complete = false;
+	};
+
+	std::vector<Line> lines;
+
+	Line& find_line(size_type begin);
+	bool extend(const Text_storage& text, Line& line);
+	static void truncate(Line& line, size_type position);
+
+public:
+	/*
+	 * The column of `position` on the line starting at `line`.
+	 */
+	int column(const Text_storage& text, size_type line, size_type position);
+
+	/*
+	 * The first position on the line starting at `line` whose column is at
+	 * least `column`, or the end of the line.  `reached` is set to the
+	 * column of that position, which is past `column` after a tab.
+	 */
+	size_type position(const Text_storage& text, size_type line, int column, int& reached);
+
+	/*
+	 * Must be called after `n` bytes have been inserted at `position`, or
+	 * erased from it.
+	 */
+	void insert(size_type position, size_type n);
+	void erase(size_type position, size_type n);
+
+	void clear();
+};
+
+#endif
@@ -1,7 +1,9 @@
 #ifndef RED_EDITOR_H
 #define RED_EDITOR_H
 
+#include "platform.h"
 #include "buffer.h"
+#include "buffer_list.h"
 
 struct View {
 	Buffer* buffer;
@@ -14,8 +16,21 @@ struct View {
 };
 
 struct Editor_state {
-	Buffer buffer;
+	Buffer_list buffers;
 	View view;
 };
 
+/*
+ * Sets up an empty buffer with a view the size of the screen
+ */
+void editor_initialize(Editor_state& editor);
+
+/*
+ * Switches the view to `buffer`, which must be in the buffer list, at the
+ * position it was left at.  The position in the buffer being left is saved
+ * and buffers over the memory budget are released.  Returns 0 or the error
+ * reading the text back, the view is unchanged on error.
+ */
+DWORD editor_show_buffer(Editor_state& editor, Buffer& buffer);
+
 #endif
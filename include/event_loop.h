@@ -0,0 +1,52 @@
+#ifndef RED_EVENT_LOOP_H
+#define RED_EVENT_LOOP_H
+
+#include "platform.h"
+#include "editor.h"
+
+/*
+ * The editing thread runs in event_loop_run, asleep until there is something
+ * for it to do: keys to hand to evaluate, a timer that is due or work a
+ * worker thread has finished.  Nothing it runs waits for a key, a command
+ * needing more keys leaves a mode or prompt the next one resumes, so work
+ * finished in the background is taken in between any two keys.
+ *
+ * On POSIX the loop sleeps in poll() on a pipe the other threads write a
+ * byte to, on Windows on an event.  Both live as long as the process, so a
+ * worker may wake the loop until it has been joined.
+ */
+DWORD event_loop_initialize();
+
+/*
+ * Called from any thread to wake the loop, or its next wait.  The input
+ * reader thread calls it when keys have been queued.
+ */
+void event_loop_wake();
+
+/*
+ * Sleeps until woken or `timeout` milliseconds have passed, returns false
+ * if the time ran out.
+ */
+bool event_loop_wait(DWORD timeout);
+
+/*
+ * event_loop_background_ready is called from any thread when work done in
+ * the background can be taken in, `handler` then runs on the editing thread.
+ */
+void event_loop_set_background_handler(void (*handler)());
+void event_loop_background_ready();
+
+/*
+ * Runs `handler` on the editing thread once `delay` milliseconds have
+ * passed.  A handler has at most one timer, setting it again moves it.
+ */
+void event_loop_set_timer(void (*handler)(), DWORD delay);
+
+/*
+ * Hands keys to evaluate as they arrive, and runs the background handler
+ * and timers in between, until a command asks to exit or the terminal goes
+ * away.
+ */
+void event_loop_run(Editor_state& editor);
+
+#endif
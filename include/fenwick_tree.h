@@ -0,0 +1,88 @@
+#ifndef RED_FENWICK_TREE_H
+#define RED_FENWICK_TREE_H
+
+#include <cstddef>
+#include <vector>
+
+/*
+ * Fenwick_tree (binary indexed tree)
+ *
+ * Maintains prefix sums over a sequence of counts.  Adding to a single count,
+ * asking for the sum of the first i counts and finding the count that a given
+ * sum falls into all take O(log n).  Changing the number of counts requires
+ * rebuilding the tree with `assign` which is O(n).
+ */
+template <typename N>
+// requires Integral(N)
+class Fenwick_tree {
+public:
+	using size_type = std::size_t;
+
+private:
+	// 1-based, tree[i] holds the sum of the counts (i - lowbit(i), i]
+	std::vector<N> tree;
+
+	static size_type lowbit(size_type i)
+	{
+		return i & (~i + 1);
+	}
+
+public:
+	template <typename I>
+	// requires InputIterator(I) && ValueType(I) == N
+	void assign(I first, I last)
+	{
+		tree.assign(1, N(0));
+		tree.insert(tree.end(), first, last);
+		for (size_type i = 1; i < tree.size(); ++i) {
+			size_type parent = i + lowbit(i);
+			if (parent < tree.size())
+				tree[parent] += tree[i];
+		}
+	}
+
+	size_type size() const
+	{
+		return tree.empty() ? 0 : tree.size() - 1;
+	}
+
+	void add(size_type i, N delta)
+	{
+		for (++i; i < tree.size(); i += lowbit(i))
+			tree[i] += delta;
+	}
+
+	/*
+	 * Sum of the counts [0, i)
+	 */
+	N prefix_sum(size_type i) const
+	{
+		N sum(0);
+		for (; i > 0; i -= lowbit(i))
+			sum += tree[i];
+		return sum;
+	}
+
+	/*
+	 * Returns the smallest i such that prefix_sum(i + 1) > x, or size() if
+	 * there is no such i.  On return x has been reduced by prefix_sum(i), so
+	 * it holds the offset of the original x within count i.
+	 */
+	size_type upper_bound(N& x) const
+	{
+		size_type step = 1;
+		while (step * 2 <= size())
+			step *= 2;
+
+		size_type i = 0;
+		for (; step > 0; step /= 2) {
+			if (i + step <= size() && tree[i + step] <= x) {
+				i += step;
+				x -= tree[i];
+			}
+		}
+		return i;
+	}
+};
+
+#endif
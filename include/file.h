@@ -1,11 +1,68 @@
 #ifndef RED_FILE_H
 #define RED_FILE_H
 
-#include <Windows.h>
+#include "platform.h"
+#include <cstddef>
 #include <string>
 #include "buffer.h"
+#include "chunked_gap_buffer.h"
+#include "gap_buffer.h"
+#include "piece_table.h"
 
+/*
+ * Opens `filename` in `buffer`, a file that doesn't exist opens an empty
+ * buffer.  A large file is read in the background: file_open returns as soon
+ * as the first chunk is in the buffer and the rest is appended as it arrives,
+ * so the buffer grows at its end until buffer.load is reset.
+ */
 DWORD file_open(std::string filename, Buffer& buffer);
-DWORD file_save(Buffer& buffer);
+
+/*
+ * Appends what has been read of the file since the last call, returns true
+ * if the buffer grew.  Called while idle so loading goes on between keys.
+ */
+bool file_load_poll(Buffer& buffer);
+
+/*
+ * Wait for the reader until the buffer holds all of the file, or the text at
+ * `position`.  They return at once for a buffer that isn't loading.
+ */
+void file_load_finish(Buffer& buffer);
+void file_load_position(Buffer& buffer, Buffer::size_type position);
+
+/*
+ * Wait for the reader until the buffer holds what a command needs: at least
+ * `count` lines, the end of the line holding `position`, or all of the file,
+ * but give up and return false once `cancelled` returns true.
+ */
+bool file_load_lines(Buffer& buffer, Buffer::size_type count, bool (*cancelled)());
+bool file_load_line_end(Buffer& buffer, Buffer::size_type position, bool (*cancelled)());
+bool file_load_finish(Buffer& buffer, bool (*cancelled)());
+
+/*
+ * Returns true while the file is being read into `buffer`, with how much of
+ * it is in the buffer and its size.
+ */
+bool file_loading(const Buffer& buffer, std::size_t& loaded, std::size_t& size);
+
+/*
+ * Saving happens in the background, file_save finishes loading the buffer,
+ * starts writing a snapshot of it and returns.  It returns ERROR_CANCELLED,
+ * having started nothing, if `cancelled` returns true before the buffer is
+ * loaded.  file_save_finished reports a save that has completed since it
+ * was last called.
+ */
+DWORD file_save(Buffer& buffer, bool (*cancelled)());
+bool file_save_pending();
+bool file_save_finished(std::string& filename, DWORD& last_error);
+void file_save_wait();
+
+/*
+ * `notify` is called on the worker threads whenever more of a file has been
+ * read or a save has finished, so the editor can wake to take it in with
+ * file_load_poll and file_save_finished.  It must be safe to call from any
+ * thread.
+ */
+void file_set_notify(void (*notify)());
 
 #endif
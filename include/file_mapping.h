@@ -0,0 +1,43 @@
+#ifndef RED_FILE_MAPPING_H
+#define RED_FILE_MAPPING_H
+
+#include <cstddef>
+#include <string>
+
+/*
+ * File_mapping
+ *
+ * A read-only view of the whole of a file mapped into memory.  The pages are
+ * only read from disk when they are touched, so opening a file is O(1) in its
+ * size and the resident memory follows what is actually used.  Sizes are 64
+ * bit so files over 4 GB map on 64-bit builds.
+ */
+class File_mapping {
+public:
+	using size_type = std::size_t;
+
+private:
+	const char* view = nullptr;
+	size_type length = 0;
+
+	void unmap();
+
+public:
+	~File_mapping();
+	File_mapping() = default;
+	File_mapping(const File_mapping&) = delete;
+	File_mapping& operator=(const File_mapping&) = delete;
+	File_mapping(File_mapping&& x) noexcept;
+	File_mapping& operator=(File_mapping&& x) noexcept;
+
+	/*
+	 * Maps `filename`, returns 0 on success or the error code from the
+	 * system (GetLastError or errno).  An empty file maps to an empty view.
+	 */
+	unsigned long open(const std::string& filename);
+
+	const char* data() const;
+	size_type size() const;
+};
+
+#endif
@@ -1,101 +1,689 @@
 #ifndef RED_GAP_BUFFER_H
 #define RED_GAP_BUFFER_H
 
+#include <cassert>
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <iterator>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+template <typename I>
+struct Segmented_iterator_traits;
+
+/*
+ * move_gap
+ *
+ * Moves a gap defined by the range [gap_begin, gap_end), we don't care about
+ * the data in this range, and we want to move the gap to a new position
+ * defined by iter while maintaining the relative order of the elements not in
+ * the gap.
+ *
+ * if (iter < gap_begin) {
+ * abcdefghijk________________________________lmnopqrstuvwxyz
+ *     ^      ^                               ^
+ *     iter   gap_begin                       gap_end
+ * pair = move_gap(iter, gap_begin, gap_end) ==>
+ * abcd________________________________efghijklmnopqrstuvwxyz
+ *     ^                               ^
+ *     pair.first                      pair.second
+ *
+ * } else {
+ *
+ * abcdefghijk________________________________lmnopqrstuvwxyz
+ *            ^                               ^       ^
+ *            gap_begin                       gap_end iter
+ * pair = move_gap(iter, gap_begin, gap_end) ==>
+ * abcdefghijklmnopqrs________________________________tuvwxyz
+ *                    ^                               ^
+ *                    pair.first                      pair.second
+ * }
+ */
+template <typename I>
+// requires BidirectionalIterator(I)
+std::pair<I, I> move_gap(I iter, I gap_begin, I gap_end)
+{
+	assert(iter < gap_begin || iter >= gap_end);
+	if (iter < gap_begin)
+		return std::make_pair(iter, std::move_backward(iter, gap_begin, gap_end));
+	return std::make_pair(std::move(gap_end, iter, gap_begin), iter);
+}
+
+/*
+ * Geometric_growth
+ *
+ * Growth policy for Basic_gap_buffer.  When the gap is too small for an
+ * insert the capacity is multiplied by Numerator / Denominator, leaving at
+ * least Minimum_gap elements free, so a run of single element inserts only
+ * reallocates O(log n) times.  When an erase leaves a buffer of at least
+ * Shrink_threshold elements less than a quarter full it is shrunk.
+ */
+template <std::size_t Numerator = 3, std::size_t Denominator = 2, std::size_t Minimum_gap = 64, std::size_t Shrink_threshold = 1024 * 1024>
+struct Geometric_growth {
+	static_assert(Numerator > Denominator, "the capacity must grow");
+
+	/*
+	 * The capacity to grow to from `capacity` to hold `required` elements
+	 */
+	static std::size_t grow(std::size_t capacity, std::size_t required)
+	{
+		return std::max(capacity / Denominator * Numerator, required + Minimum_gap);
+	}
+
+	/*
+	 * The capacity to shrink to after an erase, `capacity` to leave it alone
+	 */
+	static std::size_t shrink(std::size_t capacity, std::size_t size)
+	{
+		if (capacity < Shrink_threshold || size >= capacity / 4)
+			return capacity;
+		return grow(size, size);
+	}
+};
+
+/*
+ * Basic_gap_buffer
+ *
+ * The elements are stored in a single array with a gap at the last edit
+ * position.  The gap holds uninitialised elements, so T must be trivially
+ * copyable.  Storage comes from `Allocator` and grows according to `Growth`.
+ *
+ * share() lets snapshots read the elements from other threads while the
+ * buffer is edited.  Until they let go, the array is only written where the
+ * gap was when they were taken, an edit that would write anywhere else moves
+ * the elements to a new array first.  Elements must not be assigned through
+ * operator[] or an iterator while the array is shared.
+ */
+template <typename T, typename Allocator = std::allocator<T>, typename Growth = Geometric_growth<>>
+// requires TriviallyCopyable(T) && GrowthPolicy(Growth)
+class Basic_gap_buffer {
+	static_assert(std::is_trivially_copyable<T>::value, "the gap holds uninitialised elements");
 
-class Gap_buffer {
 public:
-	using value_type = char;
+	using value_type = T;
+	using allocator_type = Allocator;
 	using reference = value_type&;
+	using const_reference = const value_type&;
 	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
 	class iterator;
 
 private:
-	char* data_begin = nullptr;
-	char* data_end = nullptr;
-	char* gap_begin = nullptr;
-	char* gap_end = nullptr;
+	using alloc_traits = std::allocator_traits<Allocator>;
+
+	Allocator alloc;
+	T* data_begin = nullptr;
+	T* data_end = nullptr;
+	T* gap_begin = nullptr;
+	T* gap_end = nullptr;
+
+	// Owns the array once it has been shared, see share()
+	std::shared_ptr<T> shared;
+	T* writable_begin = nullptr;
+	T* writable_end = nullptr;
+
+	/*
+	 * Gives up the array, it is freed once no snapshot holds it
+	 */
+	void release()
+	{
+		if (shared)
+			shared.reset();
+		else if (data_begin)
+			alloc_traits::deallocate(alloc, data_begin, capacity());
+	}
+
+	/*
+	 * Whether [f, l) may be written, while the array is shared only what
+	 * was in the gap when it was
+	 */
+	bool writable(const T* f, const T* l) const
+	{
+		if (!shared || f == l || (f >= writable_begin && l <= writable_end))
+			return true;
+		if (shared.use_count() > 1)
+			return false;
+		// The snapshots have let go, their reads happened before
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return true;
+	}
+
+	/*
+	 * Moves the elements into a new array of `n`, the gap stays at the same
+	 * offset.
+	 */
+	void reallocate(size_type n)
+	{
+		assert(n >= size());
+		T* new_data_begin = n ? alloc_traits::allocate(alloc, n) : nullptr;
+		T* new_data_end = new_data_begin + n;
+		T* new_gap_begin = std::copy(begin0(), end0(), new_data_begin);
+		T* new_gap_end = std::copy_backward(begin1(), end1(), new_data_end);
+
+		release();
+
+		data_begin = new_data_begin;
+		data_end = new_data_end;
+		gap_begin = new_gap_begin;
+		gap_end = new_gap_end;
+	}
+
+	/*
+	 * Moves the gap to `p`, after copying the elements to a new array if
+	 * moving them would overwrite any a snapshot reads
+	 */
+	void place_gap(T* p)
+	{
+		size_type gap = gap_end - gap_begin;
+		bool overwrites = p < gap_begin ? !writable(p + gap, gap_end) : !writable(gap_begin, gap_begin + (p - gap_end));
+		if (overwrites) {
+			size_type n = gap_begin - data_begin;
+			size_type i = p < gap_begin ? p - data_begin : n + (p - gap_end);
+			reallocate(capacity());
+			p = i < n ? data_begin + i : gap_end + (i - n);
+		}
+		std::tie(gap_begin, gap_end) = move_gap(p, gap_begin, gap_end);
+	}
+
+	/*
+	 * Makes room for `n` more elements at the start of the gap
+	 */
+	void grow(size_type n)
+	{
+		if (static_cast<size_type>(gap_end - gap_begin) < n)
+			reallocate(Growth::grow(capacity(), size() + n));
+		else if (!writable(gap_begin, gap_begin + n))
+			reallocate(capacity());
+	}
+
+	void shrink()
+	{
+		size_type n = Growth::shrink(capacity(), size());
+		if (n < capacity())
+			reallocate(n);
+	}
+
+	/*
+	 * Compares the first n elements of x and y a contiguous run at a time,
+	 * the result is negative, zero or positive like memcmp.
+	 */
+	static int compare(const Basic_gap_buffer& x, const Basic_gap_buffer& y, size_type n)
+	{
+		const T* spans_x[] = { x.begin0(), x.end0(), x.begin1(), x.end1() };
+		const T* spans_y[] = { y.begin0(), y.end0(), y.begin1(), y.end1() };
+		const T** s_x = spans_x;
+		const T** s_y = spans_y;
+		const T* f_x = s_x[0];
+		const T* f_y = s_y[0];
+
+		while (n > 0) {
+			if (f_x == s_x[1]) {
+				s_x += 2;
+				f_x = s_x[0];
+				continue;
+			}
+			if (f_y == s_y[1]) {
+				s_y += 2;
+				f_y = s_y[0];
+				continue;
+			}
+			size_type m = std::min<size_type>({ n, size_type(s_x[1] - f_x), size_type(s_y[1] - f_y) });
+			if (!std::equal(f_x, f_x + m, f_y)) {
+				auto mismatch = std::mismatch(f_x, f_x + m, f_y);
+				return *mismatch.first < *mismatch.second ? -1 : 1;
+			}
+			f_x += m;
+			f_y += m;
+			n -= m;
+		}
+		return 0;
+	}
 
 public:
-	~Gap_buffer();
-	Gap_buffer() = default;
-	Gap_buffer(const Gap_buffer& x);
-	Gap_buffer& operator=(const Gap_buffer& x);
-	Gap_buffer(Gap_buffer&& x) noexcept;
-	Gap_buffer& operator=(Gap_buffer&& x) noexcept;
+	~Basic_gap_buffer()
+	{
+		release();
+	}
+
+	Basic_gap_buffer() = default;
+
+	explicit Basic_gap_buffer(const Allocator& alloc) :
+		alloc(alloc)
+	{
+	}
+
+	Basic_gap_buffer(const Basic_gap_buffer& x) :
+		alloc(alloc_traits::select_on_container_copy_construction(x.alloc))
+	{
+		size_type n = x.size();
+		data_begin = n ? alloc_traits::allocate(alloc, n) : nullptr;
+		gap_begin = std::copy(x.begin0(), x.end0(), data_begin);
+		gap_end = gap_begin;
+		data_end = std::copy(x.begin1(), x.end1(), gap_end);
+	}
+
+	Basic_gap_buffer& operator=(const Basic_gap_buffer& x)
+	{
+		if (capacity() < x.size() || shared) {
+			Basic_gap_buffer tmp = x;
+			std::swap(*this, tmp);
+		} else {
+			gap_begin = std::copy(x.begin0(), x.end0(), data_begin);
+			gap_end = std::copy_backward(x.begin1(), x.end1(), data_end);
+		}
+		return *this;
+	}
+
+	Basic_gap_buffer(Basic_gap_buffer&& x) noexcept :
+		alloc(std::move(x.alloc)),
+		data_begin(x.data_begin),
+		data_end(x.data_end),
+		gap_begin(x.gap_begin),
+		gap_end(x.gap_end),
+		shared(std::move(x.shared)),
+		writable_begin(x.writable_begin),
+		writable_end(x.writable_end)
+	{
+		x.data_begin = nullptr;
+		x.data_end = nullptr;
+		x.gap_begin = nullptr;
+		x.gap_end = nullptr;
+	}
+
+	Basic_gap_buffer& operator=(Basic_gap_buffer&& x) noexcept
+	{
+		this->~Basic_gap_buffer();
+		::new (static_cast<void*>(this)) Basic_gap_buffer(std::move(x));
+		return *this;
+	}
+
+	Basic_gap_buffer(size_type n, const T& c, const Allocator& alloc = Allocator()) :
+		alloc(alloc)
+	{
+		data_begin = n ? alloc_traits::allocate(this->alloc, n) : nullptr;
+		gap_begin = std::fill_n(data_begin, n, c);
+		gap_end = gap_begin;
+		data_end = gap_end;
+	}
+
+	friend bool operator==(const Basic_gap_buffer& x, const Basic_gap_buffer& y)
+	{
+		return x.size() == y.size() && compare(x, y, x.size()) == 0;
+	}
+
+	friend bool operator!=(const Basic_gap_buffer& x, const Basic_gap_buffer& y)
+	{
+		return !(x == y);
+	}
+
+	friend bool operator <(const Basic_gap_buffer& x, const Basic_gap_buffer& y)
+	{
+		int result = compare(x, y, std::min(x.size(), y.size()));
+		return result < 0 || (result == 0 && x.size() < y.size());
+	}
+
+	friend bool operator >(const Basic_gap_buffer& x, const Basic_gap_buffer& y)
+	{
+		return y < x;
+	}
+
+	friend bool operator<=(const Basic_gap_buffer& x, const Basic_gap_buffer& y)
+	{
+		return !(y < x);
+	}
 
-	Gap_buffer(size_type n, char c);
+	friend bool operator>=(const Basic_gap_buffer& x, const Basic_gap_buffer& y)
+	{
+		return !(x < y);
+	}
 
-	friend bool operator==(const Gap_buffer& x, const Gap_buffer& y);
-	friend bool operator!=(const Gap_buffer& x, const Gap_buffer& y);
+	allocator_type get_allocator() const
+	{
+		return alloc;
+	}
 
-	friend bool operator <(const Gap_buffer& x, const Gap_buffer& y);
-	friend bool operator >(const Gap_buffer& x, const Gap_buffer& y);
-	friend bool operator<=(const Gap_buffer& x, const Gap_buffer& y);
-	friend bool operator>=(const Gap_buffer& x, const Gap_buffer& y);
+	size_type capacity() const
+	{
+		return data_end - data_begin;
+	}
 
-	size_type capacity() const;
-	size_type size() const;
+	size_type size() const
+	{
+		return (gap_begin - data_begin) + (data_end - gap_end);
+	}
 
-	reference operator[](size_type i);
+	reference operator[](size_type i)
+	{
+		size_type n = gap_begin - data_begin;
+		if (i >= n)
+			i += (gap_end - gap_begin);
+		return data_begin[i];
+	}
 
-	const char* begin0() const;
-	const char* end0() const;
-	const char* begin1() const;
-	const char* end1() const;
+	const_reference operator[](size_type i) const
+	{
+		size_type n = gap_begin - data_begin;
+		if (i >= n)
+			i += (gap_end - gap_begin);
+		return data_begin[i];
+	}
+
+	const T* begin0() const
+	{
+		return data_begin;
+	}
+
+	const T* end0() const
+	{
+		return gap_begin;
+	}
+
+	const T* begin1() const
+	{
+		return gap_end;
+	}
+
+	const T* end1() const
+	{
+		return data_end;
+	}
+
+	/*
+	 * The contiguous run of text that starts at offset `i` and extends to the
+	 * gap or the end of the buffer, empty when i == size().
+	 */
+	std::basic_string_view<T> segment_from(size_type i) const
+	{
+		size_type n = gap_begin - data_begin;
+		if (i < n)
+			return std::basic_string_view<T>(data_begin + i, n - i);
+		const T* first = gap_end + (i - n);
+		return std::basic_string_view<T>(first, data_end - first);
+	}
+
+	/*
+	 * The contiguous run of text that ends at offset `i` and extends back to
+	 * the gap or the beginning of the buffer, empty when i == 0.
+	 */
+	std::basic_string_view<T> segment_to(size_type i) const
+	{
+		size_type n = gap_begin - data_begin;
+		if (i <= n)
+			return std::basic_string_view<T>(data_begin, i);
+		return std::basic_string_view<T>(gap_end, i - n);
+	}
+
+	/*
+	 * Appends the elements to `segments` as the text before and after the
+	 * gap.  They stay as they are, however the buffer is edited, for as long
+	 * as the returned pointer is held, which may be on another thread.
+	 */
+	std::shared_ptr<const void> share(std::vector<std::basic_string_view<T>>& segments)
+	{
+		segments.emplace_back(data_begin, gap_begin - data_begin);
+		segments.emplace_back(gap_end, data_end - gap_end);
+		if (!data_begin)
+			return nullptr;
+		if (!shared) {
+			shared = std::shared_ptr<T>(data_begin, [alloc = alloc, n = capacity()] (T* p) mutable {
+				alloc_traits::deallocate(alloc, p, n);
+			});
+		}
+		if (writable(data_begin, data_end)) {
+			writable_begin = gap_begin;
+			writable_end = gap_end;
+		} else {
+			// Nothing either snapshot reads may be written
+			writable_begin = std::max(writable_begin, gap_begin);
+			writable_end = std::max(writable_begin, std::min(writable_end, gap_end));
+		}
+		return shared;
+	}
 
 	class iterator {
 	public:
-		using value_type = char;
+		using value_type = T;
 		using reference = value_type&;
 		using pointer = value_type*;
 		using difference_type = std::ptrdiff_t;
 		using iterator_category = std::random_access_iterator_tag;
 
 	private:
-		friend class Gap_buffer;
-		char* ptr;
-		char* gap_begin;
-		char* gap_end;
+		friend class Basic_gap_buffer;
+		friend struct Segmented_iterator_traits<iterator>;
+		T* ptr;
+		T* gap_begin;
+		T* gap_end;
 
 	public:
 		iterator() = default;
-		iterator(char* ptr, char* gap_begin, char* gap_end);
 
-		friend bool operator==(const iterator& x, const iterator& y);
-		friend bool operator!=(const iterator& x, const iterator& y);
+		iterator(T* ptr, T* gap_begin, T* gap_end) :
+			ptr(ptr),
+			gap_begin(gap_begin),
+			gap_end(gap_end)
+		{
+		}
+
+		friend bool operator==(const iterator& x, const iterator& y)
+		{
+			return x.ptr == y.ptr;
+		}
+
+		friend bool operator!=(const iterator& x, const iterator& y)
+		{
+			return !(x == y);
+		}
+
+		friend bool operator <(const iterator& x, const iterator& y)
+		{
+			return x.ptr < y.ptr;
+		}
+
+		friend bool operator >(const iterator& x, const iterator& y)
+		{
+			return y < x;
+		}
+
+		friend bool operator<=(const iterator& x, const iterator& y)
+		{
+			return !(y < x);
+		}
+
+		friend bool operator>=(const iterator& x, const iterator& y)
+		{
+			return !(x < y);
+		}
+
+		reference operator*() const
+		{
+			return *ptr;
+		}
+
+		pointer operator->() const
+		{
+			return &**this;
+		}
+
+		iterator& operator++()
+		{
+			++ptr;
+			if (ptr == gap_begin)
+				ptr = gap_end;
+			return *this;
+		}
 
-		friend bool operator <(const iterator& x, const iterator& y);
-		friend bool operator >(const iterator& x, const iterator& y);
-		friend bool operator<=(const iterator& x, const iterator& y);
-		friend bool operator>=(const iterator& x, const iterator& y);
+		iterator operator++(int)
+		{
+			iterator tmp = *this;
+			++*this;
+			return tmp;
+		}
 
-		reference operator*() const;
-		pointer operator->() const;
+		iterator& operator+=(difference_type n)
+		{
+			if (ptr < gap_begin) {
+				if (n >= gap_begin - ptr)
+					n += (gap_end - gap_begin);
+			} else {
+				if (n < gap_end - ptr)
+					n -= (gap_end - gap_begin);
+			}
+			ptr += n;
+			return *this;
+		}
 
-		iterator& operator++();
-		iterator operator++(int);
-		iterator& operator+=(difference_type n);
-		friend iterator operator+(iterator x, difference_type n);
+		friend iterator operator+(iterator x, difference_type n)
+		{
+			return x += n;
+		}
 
-		reference operator[](difference_type n) const;
+		reference operator[](difference_type n) const
+		{
+			return *(*this + n);
+		}
 
-		iterator& operator--();
-		iterator operator--(int);
-		iterator& operator-=(difference_type n);
-		friend iterator operator-(iterator x, difference_type n);
-		friend difference_type operator-(const iterator& x, const iterator& y);
+		iterator& operator--()
+		{
+			if (ptr == gap_end)
+				ptr = gap_begin;
+			--ptr;
+			return *this;
+		}
+
+		iterator operator--(int)
+		{
+			iterator tmp = *this;
+			--*this;
+			return tmp;
+		}
+
+		iterator& operator-=(difference_type n)
+		{
+			// TODO: Is it better to implement this here or just call operator+
+			return *this += (-n);
+		}
+
+		friend iterator operator-(iterator x, difference_type n)
+		{
+			return x -= n;
+		}
+
+		friend difference_type operator-(const iterator& x, const iterator& y)
+		{
+			assert(x.gap_begin == y.gap_begin && x.gap_end == y.gap_end);
+			difference_type n = x.ptr - y.ptr;
+			if (x.ptr < x.gap_begin && y.ptr >= y.gap_end)
+				n += (x.gap_end - x.gap_begin);
+			else if (x.ptr >= x.gap_end && y.ptr < y.gap_begin)
+				n -= (x.gap_end - x.gap_begin);
+			return n;
+		}
 	};
 
-	iterator begin();
-	iterator end();
+	iterator begin()
+	{
+		if (gap_begin == data_begin)
+			return iterator(gap_end, gap_begin, gap_end);
+		return iterator(data_begin, gap_begin, gap_end);
+	}
+
+	iterator end()
+	{
+		return iterator(data_end, gap_begin, gap_end);
+	}
+
+	/*
+	 * Makes the capacity at least `n`, allocating exactly `n` if it grows.
+	 */
+	void reserve(size_type n)
+	{
+		if (n > capacity())
+			reallocate(n);
+	}
+
+	void shrink_to_fit()
+	{
+		if (capacity() > size())
+			reallocate(size());
+	}
+
+	void insert(iterator i, size_type n, const T& c)
+	{
+		place_gap(i.ptr);
+		grow(n);
+		gap_begin = std::fill_n(gap_begin, n, c);
+	}
 
-	void reserve(size_type n);
+	/*
+	 * Inserts [f, l) before `i` with one move of the gap and at most one
+	 * reallocation.  The range must not refer to this buffer.
+	 */
+	void insert(iterator i, const T* f, const T* l)
+	{
+		size_type n = l - f;
+		place_gap(i.ptr);
+		grow(n);
+		gap_begin = std::copy(f, l, gap_begin);
+	}
 
-	void insert(iterator i, size_type n, char c);
-	void erase(iterator i, size_type n);
-	iterator erase(iterator f, iterator l);
+	void insert(iterator i, std::basic_string_view<T> text)
+	{
+		insert(i, text.data(), text.data() + text.size());
+	}
+
+	template <typename I, typename = typename std::iterator_traits<I>::iterator_category>
+	// requires InputIterator(I) && ValueType(I) == T
+	void insert(iterator i, I f, I l)
+	{
+		const std::vector<T> elements(f, l);
+		insert(i, elements.data(), elements.data() + elements.size());
+	}
+
+	void erase(iterator i, size_type n)
+	{
+		place_gap(i.ptr);
+		gap_end += n;
+		shrink();
+	}
+
+	iterator erase(iterator f, iterator l)
+	{
+		difference_type n = l - f;
+		place_gap(f.ptr);
+		gap_end += n;
+		shrink();
+		return iterator(gap_end, gap_begin, gap_end);
+	}
+
+	/*
+	 * Replaces [f, l) with [first, last), the gap is moved once and the
+	 * erased elements are reused before growing the buffer.
+	 */
+	void replace(iterator f, iterator l, const T* first, const T* last)
+	{
+		size_type n = last - first;
+		difference_type m = l - f;
+		place_gap(f.ptr);
+		gap_end += m;
+		grow(n);
+		gap_begin = std::copy(first, last, gap_begin);
+	}
+
+	void replace(iterator f, iterator l, std::basic_string_view<T> text)
+	{
+		replace(f, l, text.data(), text.data() + text.size());
+	}
 };
 
+using Gap_buffer = Basic_gap_buffer<char>;
+
+extern template class Basic_gap_buffer<char>;
+
 #endif
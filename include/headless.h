@@ -0,0 +1,34 @@
+#ifndef RED_HEADLESS_H
+#define RED_HEADLESS_H
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+#include "input.h"
+#include "screen.h"
+
+/*
+ * A screen of `width` by `height` cells kept in memory, for running the
+ * editor without a terminal.  The contents are the rows one after another.
+ */
+const Screen_backend& headless_screen(int width, int height);
+std::string_view headless_screen_contents();
+
+/*
+ * The number of characters written to the headless screen so far
+ */
+std::size_t headless_screen_written();
+
+/*
+ * Input that plays back `keys`.  Once they have all been read every further
+ * key is ESC, which backs out of any mode or prompt left waiting.
+ *
+ * Each key arrives once the one before has been handled, as when typing,
+ * unless `typeahead` is set, then they are all waiting at once as if pasted.
+ * scripted_input_finished is true once the last has been read from here,
+ * with typeahead that is before they have all been handled.
+ */
+const Input_backend& scripted_input(std::vector<Key_input> keys, bool typeahead = false);
+bool scripted_input_finished();
+
+#endif
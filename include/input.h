@@ -1,19 +1,90 @@
 #ifndef RED_INPUT_H
 #define RED_INPUT_H
 
-#include <Windows.h> // TODO: used for DWORD below, remove this
+#include <cstddef>
+#include "platform.h"
 
 #define SHIFT (1 << 8)
 #define CONTROL (1 << 9)
 #define ALT (1 << 10)
 
+/*
+ * Sent around pasted text by terminals with bracketed paste turned on, they
+ * use virtual-key codes Windows leaves unassigned
+ */
+#define KEY_PASTE_START 0x0E
+#define KEY_PASTE_END 0x0F
+
 struct Key_input {
 	SHORT key;
 	char ascii;
 };
 
+/*
+ * Keys are read through a backend, normally the terminal.  read_keys stores
+ * up to `n` keys in `keys` and returns how many, waiting up to `timeout`
+ * milliseconds for the first, or input_closed once the terminal has gone
+ * and no more will come.  A backend with `reader_thread` set is read on a
+ * thread of its own, so keys are taken in while a command runs.
+ */
+constexpr std::size_t input_closed = static_cast<std::size_t>(-1);
+
+struct Input_backend {
+	DWORD (*initialize)();
+	void (*finalize)();
+	std::size_t (*read_keys)(Key_input* keys, std::size_t n, DWORD timeout);
+	bool reader_thread;
+};
+
+extern const Input_backend terminal_input;
+
+/*
+ * Selects the backend used by the functions below, call before
+ * input_initialize.
+ */
+void input_set_backend(const Input_backend& backend);
+
 DWORD input_initialize();
 
+/*
+ * Puts the terminal back the way input_initialize found it
+ */
+void input_finalize();
+
+/*
+ * Keys are read from the backend as many at a time as have arrived, and
+ * queued until taken.  read_key takes the next without waiting, returning
+ * false if there is none.  wait_for_input waits up to `timeout` milliseconds
+ * for keys, or until the event loop is woken for something else, and
+ * returns whether there are keys waiting.
+ */
+bool read_key(Key_input& key);
+bool wait_for_input(DWORD timeout);
+
+/*
+ * Waits for the next key, for driving the editor from a script.  The editor
+ * itself never waits for a key, the event loop hands them to it.
+ */
 Key_input wait_for_key();
 
+/*
+ * ^G asks a long command to give up.  A command that may take a while polls
+ * input_cancel_requested, which is true while a ^G is queued behind it; the
+ * key itself is still read afterwards, and does nothing.
+ */
+bool is_cancel_key(const Key_input& key);
+bool input_cancel_requested();
+
+/*
+ * Whether a key can be read without waiting, a key typed ahead or pasted.
+ * The display needn't be refreshed until they have all been handled.
+ */
+bool input_pending();
+
+/*
+ * Whether the backend has reported that no more keys will come.  The event
+ * loop returns once it has handled those queued before.
+ */
+bool input_hung_up();
+
 #endif
@@ -1,42 +1,142 @@
 #ifndef RED_ITERATOR_H
 #define RED_ITERATOR_H
 
+#include <cassert>
 #include <cstddef>
 #include <iterator>
-#include "gap_buffer.h"
 
 /*
- * Stable iterator to a Gap_buffer
+ * Stable iterator to any of the Text_storage containers
+ *
+ * Refers to an element by its offset rather than its address, so it stays
+ * valid when the storage moves its contents around.
  */
+template <typename S>
+// requires Storage(S)
 struct Indexed_iterator {
-	using value_type = char;
-	using reference = value_type&;
-	using pointer = value_type*;
+	using value_type = typename S::value_type;
+	using reference = const value_type&;
+	using pointer = const value_type*;
 	using difference_type = std::ptrdiff_t;
-	using iterator_category = std::bidirectional_iterator_tag; // TODO: Use random_access_iterator_tag?
+	using iterator_category = std::random_access_iterator_tag;
+	using size_type = typename S::size_type;
 
-	Gap_buffer* data;
-	Gap_buffer::size_type index;
+	S* data;
+	size_type index;
 
 	Indexed_iterator() = default;
-	Indexed_iterator(Gap_buffer& data, Gap_buffer::size_type index);
 
-	friend bool operator==(const Indexed_iterator& x, const Indexed_iterator& y);
-	friend bool operator!=(const Indexed_iterator& x, const Indexed_iterator& y);
+	Indexed_iterator(S& data, size_type index) :
+		data(&data),
+		index(index)
+	{
+	}
 
-	friend bool operator <(const Indexed_iterator& x, const Indexed_iterator& y);
-	friend bool operator >(const Indexed_iterator& x, const Indexed_iterator& y);
-	friend bool operator<=(const Indexed_iterator& x, const Indexed_iterator& y);
-	friend bool operator>=(const Indexed_iterator& x, const Indexed_iterator& y);
+	friend bool operator==(const Indexed_iterator& x, const Indexed_iterator& y)
+	{
+		assert(x.data == y.data);
+		return x.index == y.index;
+	}
 
-	reference operator*() const;
-	pointer operator->() const;
+	friend bool operator!=(const Indexed_iterator& x, const Indexed_iterator& y)
+	{
+		return !(x == y);
+	}
 
-	Indexed_iterator& operator++();
-	Indexed_iterator operator++(int);
+	friend bool operator <(const Indexed_iterator& x, const Indexed_iterator& y)
+	{
+		assert(x.data == y.data);
+		return x.index < y.index;
+	}
 
-	Indexed_iterator& operator--();
-	Indexed_iterator operator--(int);
+	friend bool operator >(const Indexed_iterator& x, const Indexed_iterator& y)
+	{
+		return y < x;
+	}
+
+	friend bool operator<=(const Indexed_iterator& x, const Indexed_iterator& y)
+	{
+		return !(y < x);
+	}
+
+	friend bool operator>=(const Indexed_iterator& x, const Indexed_iterator& y)
+	{
+		return !(x < y);
+	}
+
+	reference operator*() const
+	{
+		return (*data)[index];
+	}
+
+	pointer operator->() const
+	{
+		return &**this;
+	}
+
+	reference operator[](difference_type n) const
+	{
+		return *(*this + n);
+	}
+
+	Indexed_iterator& operator++()
+	{
+		++index;
+		return *this;
+	}
+
+	Indexed_iterator operator++(int)
+	{
+		Indexed_iterator tmp = *this;
+		++*this;
+		return tmp;
+	}
+
+	Indexed_iterator& operator+=(difference_type n)
+	{
+		index += n;
+		return *this;
+	}
+
+	friend Indexed_iterator operator+(Indexed_iterator x, difference_type n)
+	{
+		return x += n;
+	}
+
+	friend Indexed_iterator operator+(difference_type n, Indexed_iterator x)
+	{
+		return x += n;
+	}
+
+	Indexed_iterator& operator--()
+	{
+		--index;
+		return *this;
+	}
+
+	Indexed_iterator operator--(int)
+	{
+		Indexed_iterator tmp = *this;
+		--*this;
+		return tmp;
+	}
+
+	Indexed_iterator& operator-=(difference_type n)
+	{
+		index -= n;
+		return *this;
+	}
+
+	friend Indexed_iterator operator-(Indexed_iterator x, difference_type n)
+	{
+		return x -= n;
+	}
+
+	friend difference_type operator-(const Indexed_iterator& x, const Indexed_iterator& y)
+	{
+		assert(x.data == y.data);
+		return static_cast<difference_type>(x.index - y.index);
+	}
 };
 
 #endif
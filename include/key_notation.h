@@ -0,0 +1,24 @@
+#ifndef RED_KEY_NOTATION_H
+#define RED_KEY_NOTATION_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "input.h"
+
+/*
+ * parse_key_notation
+ *
+ * Parses keys written the way Vim writes them: a character stands for the
+ * key that types it and other keys are named in angle brackets, such as
+ * <Esc>, <CR>, <Tab>, <BS>, <Del>, <Home>, <PageDown> or <F5>, and text
+ * pasted in a terminal is between <PasteStart> and <PasteEnd>.  Modifiers
+ * are prefixes within the brackets, <C-x>, <S-Right>, <A-w> or <C-S-End>, and
+ * <lt> is a '<'.  Line breaks are ignored so a trace can be split over lines.
+ *
+ * Returns false and describes the problem in `error` if the text can't be
+ * parsed.
+ */
+bool parse_key_notation(std::string_view text, std::vector<Key_input>& keys, std::string& error);
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef RED_LATENCY_H
+#define RED_LATENCY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * Latency_histogram
+ *
+ * Counts durations in nanoseconds in log-linear buckets, 16 to each power of
+ * two, so percentiles are within about 6% at any scale.  Recording is a
+ * couple of relaxed atomic increments, threads can record into the same
+ * histogram without locking and readers see a consistent enough picture.
+ */
+class Latency_histogram {
+public:
+	static constexpr int sub_bucket_bits = 4;
+	static constexpr int sub_buckets = 1 << sub_bucket_bits;
+	static constexpr int bucket_count = (64 - sub_bucket_bits + 1) * sub_buckets;
+
+private:
+	std::atomic<std::uint64_t> buckets[bucket_count];
+	std::atomic<std::uint64_t> total_count;
+	std::atomic<std::uint64_t> maximum;
+
+public:
+	Latency_histogram();
+
+	static int bucket(std::uint64_t nanoseconds);
+	// The smallest duration counted in the bucket
+	static std::uint64_t bucket_value(int bucket);
+
+	void record(std::uint64_t nanoseconds);
+	void clear();
+
+	std::uint64_t count() const;
+	std::uint64_t max() const;
+
+	/*
+	 * The duration `fraction` of the recorded durations are no longer than,
+	 * to the precision of the buckets.  Zero if nothing has been recorded.
+	 */
+	std::uint64_t percentile(double fraction) const;
+};
+
+/*
+ * The stages between a key arriving and the frame it caused reaching the
+ * terminal.  key_to_paint covers all of them.
+ */
+enum class Latency_phase {
+	input,		// from the key being read to the editor taking it, queued
+	command,	// running the command, in evaluate or the insert mode loop
+	reframe,	// scrolling the view to the cursor
+	frame,		// building the frame from the buffer
+	output,		// writing the changes to the screen and flushing
+	key_to_paint,
+	count
+};
+
+/*
+ * The instrumentation is only built when RED_LATENCY is defined, otherwise
+ * every call below is an empty inline function.
+ */
+#if defined(RED_LATENCY)
+
+#include <chrono>
+
+using Latency_mark = std::chrono::steady_clock::time_point;
+
+inline Latency_mark latency_mark()
+{
+	return std::chrono::steady_clock::now();
+}
+
+/*
+ * Records the time since `start` for `phase`
+ */
+void latency_record(Latency_phase phase, Latency_mark start);
+
+/*
+ * Called by read_key when it takes a key read at `arrived`, before the
+ * display is refreshed after a command, and when that refresh is put off for
+ * keys still waiting.
+ */
+void latency_key_read(Latency_mark arrived);
+void latency_command_done();
+void latency_frame_deferred();
+
+/*
+ * Called once a frame has been built, returns false if it shows no keys and
+ * otherwise sets `arrived` to when the first of them arrived.  The frame
+ * carries it to latency_frame_painted, called by whichever thread flushes it.
+ */
+bool latency_frame_built(Latency_mark& arrived);
+void latency_frame_painted(Latency_mark arrived);
+
+/*
+ * A line summing up the latencies for the status line, and a table of the
+ * percentiles of every phase.
+ */
+std::string latency_status();
+std::string latency_report();
+
+/*
+ * Writes latency_report to `filename`, returns false if it couldn't.
+ */
+bool latency_dump(const std::string& filename);
+
+#else
+
+struct Latency_mark {
+};
+
+inline Latency_mark latency_mark()
+{
+	return Latency_mark{};
+}
+
+inline void latency_record(Latency_phase, Latency_mark)
+{
+}
+
+inline void latency_key_read(Latency_mark)
+{
+}
+
+inline void latency_command_done()
+{
+}
+
+inline void latency_frame_deferred()
+{
+}
+
+inline bool latency_frame_built(Latency_mark&)
+{
+	return false;
+}
+
+inline void latency_frame_painted(Latency_mark)
+{
+}
+
+inline std::string latency_status()
+{
+	return "Latency instrumentation not built, configure with RED_LATENCY=ON";
+}
+
+inline std::string latency_report()
+{
+	return std::string();
+}
+
+inline bool latency_dump(const std::string&)
+{
+	return true;
+}
+
+#endif
+
+#endif
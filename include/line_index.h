@@ -0,0 +1,78 @@
+#ifndef RED_LINE_INDEX_H
+#define RED_LINE_INDEX_H
+
+#include <cstddef>
+#include <vector>
+#include "fenwick_tree.h"
+#include "storage.h"
+
+/*
+ * Line_index
+ *
+ * Keeps track of where the lines of a Text_storage start.  The text is divided
+ * into blocks and for each block we count the bytes and the newlines it holds.
+ * Fenwick trees over both counts let us find the block holding an offset or
+ * the n-th newline in O(log n), after which at most one block is scanned.
+ *
+ * An insertion or erasure only changes the counts of the blocks it touches.
+ * When a block grows past twice the block size it is split evenly, which only
+ * requires scanning that block and rebuilding the trees from the counts.
+ * When an erasure leaves a block under a quarter of the block size it is
+ * merged into a neighbour, so emptied blocks don't stay in the trees.
+ *
+ * The index doesn't own the text, the caller passes the storage it
+ * describes and is responsible for keeping the two in sync.
+ */
+class Line_index {
+public:
+	using size_type = std::size_t;
+
+private:
+	static constexpr size_type block_size = 16 * 1024;
+	static constexpr size_type low_water = block_size / 4;
+
+	std::vector<size_type> block_bytes;
+	std::vector<size_type> block_newlines;
+	Fenwick_tree<size_type> bytes;
+	Fenwick_tree<size_type> newlines;
+
+	size_type find_block(size_type& position) const;
+	void rebuild_trees();
+	void split_block(const Text_storage& text, size_type block, size_type start);
+	void merge_blocks(size_type first, size_type last);
+
+public:
+	/*
+	 * Rebuilds the index from scratch, O(n)
+	 */
+	void assign(const Text_storage& text);
+
+	/*
+	 * Must be called after `n` bytes have been inserted into `text` at
+	 * `position`.
+	 */
+	void insert(const Text_storage& text, size_type position, size_type n);
+
+	/*
+	 * Must be called before `n` bytes are erased from `text` at `position`.
+	 */
+	void erase(const Text_storage& text, size_type position, size_type n);
+
+	/*
+	 * The number of lines, a buffer without any newlines has a single line.
+	 */
+	size_type line_count() const;
+
+	/*
+	 * The 0-based number of the line containing `position`.
+	 */
+	size_type line_number(const Text_storage& text, size_type position) const;
+
+	/*
+	 * The offset of the first character of `line`, requires
+	 * line < line_count().
+	 */
+	size_type line_begin(const Text_storage& text, size_type line) const;
+};
+
+#endif
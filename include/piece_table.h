@@ -0,0 +1,124 @@
+#ifndef RED_PIECE_TABLE_H
+#define RED_PIECE_TABLE_H
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "iterator.h"
+
+struct Piece_node;
+
+/*
+ * Piece_table
+ *
+ * The text is described by a sequence of pieces, each piece refers to a run
+ * of bytes in either the original buffer, which is never modified, or the add
+ * buffer, which is only ever appended to.  Inserting appends the new text to
+ * the add buffer and splits the piece at the insertion point, erasing shortens
+ * or drops pieces.  Neither moves any of the text, so the cost of an edit
+ * doesn't depend on how far it is from the previous one.
+ *
+ * The pieces are kept in a treap ordered by their position in the text, each
+ * node caches the length of its subtree so the piece holding an offset is
+ * found in O(log n) of the number of pieces.
+ *
+ * Since neither buffer has its text changed once it is there, share() hands
+ * snapshots the pieces as they are, the add buffer is only copied when it
+ * has to grow while one still reads it.
+ */
+class Piece_table {
+public:
+	using value_type = char;
+	using reference = const value_type&;
+	using size_type = std::size_t;
+	using iterator = Indexed_iterator<Piece_table>;
+
+private:
+	using Node = Piece_node;
+
+	std::shared_ptr<const char> original;
+	size_type original_size = 0; // bytes of the original used so far
+	std::shared_ptr<std::string> add;
+	std::unique_ptr<Node> root;
+	unsigned seed = 2463534242u;
+
+	// The piece most recently found by operator[], makes sequential access O(1)
+	mutable const char* cache_data = nullptr;
+	mutable size_type cache_begin = 0;
+	mutable size_type cache_end = 0;
+
+	const char* piece_data(const Node& node) const;
+	const Node* find_piece(size_type position, size_type& piece_begin) const;
+	std::unique_ptr<Node> make_node(bool added, size_type start, size_type length);
+	void invalidate_cache();
+
+public:
+	~Piece_table();
+	Piece_table();
+	Piece_table(const Piece_table& x);
+	Piece_table& operator=(const Piece_table& x);
+	Piece_table(Piece_table&& x) noexcept;
+	Piece_table& operator=(Piece_table&& x) noexcept;
+
+	explicit Piece_table(std::string text);
+
+	/*
+	 * Uses the `size` bytes at `original` as the original text without
+	 * copying them, the shared_ptr keeps whatever owns them alive, such as a
+	 * File_mapping.  Only edited text is stored on the heap.
+	 */
+	Piece_table(std::shared_ptr<const char> original, size_type size);
+
+	/*
+	 * Appends the `n` bytes of the original text that follow those used so
+	 * far, for an original that is longer than the `size` it was given, such
+	 * as a file being read in.
+	 */
+	void append_original(size_type n);
+
+	size_type size() const;
+
+	/*
+	 * Appends the pieces to `segments`, they stay as they are however the
+	 * table is edited for as long as the returned pointer is held, which
+	 * may be on another thread.
+	 */
+	std::shared_ptr<const void> share(std::vector<std::string_view>& segments);
+
+	reference operator[](size_type i) const;
+
+	/*
+	 * The contiguous run of text that starts at offset `i` and extends to
+	 * the end of the piece holding it, empty when i == size().
+	 */
+	std::string_view segment_from(size_type i) const;
+
+	/*
+	 * The contiguous run of text that ends at offset `i` and extends back
+	 * to the start of the piece holding i - 1, empty when i == 0.
+	 */
+	std::string_view segment_to(size_type i) const;
+
+	iterator begin();
+	iterator end();
+
+	void insert(iterator i, size_type n, char c);
+	void insert(iterator i, std::string_view text);
+	void insert(iterator i, const char* f, const char* l);
+
+	template <typename I, typename = typename std::iterator_traits<I>::iterator_category>
+	// requires InputIterator(I) && ValueType(I) == char
+	void insert(iterator i, I f, I l)
+	{
+		insert(i, std::string(f, l));
+	}
+
+	void erase(iterator i, size_type n);
+	iterator erase(iterator f, iterator l);
+	void replace(iterator f, iterator l, std::string_view text);
+};
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef RED_PLATFORM_H
+#define RED_PLATFORM_H
+
+/*
+ * The editor uses the Win32 names for error codes and virtual-key codes
+ * throughout.  Elsewhere the few that are needed are defined here, error
+ * codes map onto errno values and keys are decoded by the terminal backend
+ * into the same encoding Windows uses.
+ */
+#if defined(_WIN32)
+
+#include <Windows.h>
+
+#else
+
+#include <cerrno>
+
+typedef unsigned long DWORD;
+typedef short SHORT;
+
+#define INFINITE 0xFFFFFFFF
+
+#define ERROR_FILE_NOT_FOUND ENOENT
+#define ERROR_NOT_ENOUGH_MEMORY ENOMEM
+#define ERROR_BUSY EBUSY
+#define ERROR_CANCELLED ECANCELED
+
+#define VK_BACK 0x08
+#define VK_TAB 0x09
+#define VK_RETURN 0x0D
+#define VK_ESCAPE 0x1B
+#define VK_SPACE 0x20
+#define VK_PRIOR 0x21
+#define VK_NEXT 0x22
+#define VK_END 0x23
+#define VK_HOME 0x24
+#define VK_LEFT 0x25
+#define VK_UP 0x26
+#define VK_RIGHT 0x27
+#define VK_DOWN 0x28
+#define VK_INSERT 0x2D
+#define VK_DELETE 0x2E
+#define VK_F1 0x70
+#define VK_OEM_1 0xBA
+#define VK_OEM_PLUS 0xBB
+#define VK_OEM_COMMA 0xBC
+#define VK_OEM_MINUS 0xBD
+#define VK_OEM_PERIOD 0xBE
+#define VK_OEM_2 0xBF
+#define VK_OEM_3 0xC0
+#define VK_OEM_4 0xDB
+#define VK_OEM_5 0xDC
+#define VK_OEM_6 0xDD
+#define VK_OEM_7 0xDE
+
+/*
+ * VkKeyScanA for a US keyboard layout, the low-order byte is the virtual-key
+ * code and the high-order byte the shift state.  Returns -1 for characters
+ * the layout can't type.
+ */
+inline SHORT VkKeyScanA(char character)
+{
+	constexpr SHORT shift = 1 << 8;
+	constexpr SHORT control = 2 << 8;
+	auto c = static_cast<unsigned char>(character);
+	if (c >= 'a' && c <= 'z')
+		return c - 'a' + 'A';
+	if (c >= 'A' && c <= 'Z')
+		return shift | c;
+	if (c >= '0' && c <= '9')
+		return c;
+
+	switch (c) {
+	case '\b': return VK_BACK;
+	case '\t': return VK_TAB;
+	case '\r': return VK_RETURN;
+	case '\n': return control | VK_RETURN;
+	case 27: return VK_ESCAPE;
+	case ' ': return VK_SPACE;
+	case ')': return shift | '0';
+	case '!': return shift | '1';
+	case '@': return shift | '2';
+	case '#': return shift | '3';
+	case '$': return shift | '4';
+	case '%': return shift | '5';
+	case '^': return shift | '6';
+	case '&': return shift | '7';
+	case '*': return shift | '8';
+	case '(': return shift | '9';
+	case ';': return VK_OEM_1;
+	case ':': return shift | VK_OEM_1;
+	case '=': return VK_OEM_PLUS;
+	case '+': return shift | VK_OEM_PLUS;
+	case ',': return VK_OEM_COMMA;
+	case '<': return shift | VK_OEM_COMMA;
+	case '-': return VK_OEM_MINUS;
+	case '_': return shift | VK_OEM_MINUS;
+	case '.': return VK_OEM_PERIOD;
+	case '>': return shift | VK_OEM_PERIOD;
+	case '/': return VK_OEM_2;
+	case '?': return shift | VK_OEM_2;
+	case '`': return VK_OEM_3;
+	case '~': return shift | VK_OEM_3;
+	case '[': return VK_OEM_4;
+	case '{': return shift | VK_OEM_4;
+	case '\\': return VK_OEM_5;
+	case '|': return shift | VK_OEM_5;
+	case ']': return VK_OEM_6;
+	case '}': return shift | VK_OEM_6;
+	case '\'': return VK_OEM_7;
+	case '"': return shift | VK_OEM_7;
+	}
+	return -1;
+}
+
+#endif
+
+#endif
@@ -1,14 +1,38 @@
 #ifndef RED_PROMPT_H
 #define RED_PROMPT_H
 
+#include <string>
 #include <string_view>
+#include "editor.h"
+#include "input.h"
 
 enum class User_response {
 	yes, no, cancel
 };
 
-std::string prompt(std::string_view message);
+/*
+ * A prompt is a state of the editor rather than a loop of its own: asking
+ * shows the question on the status line and returns, the keys that follow
+ * go to prompt_key, and once it is answered `answered` is called with the
+ * answer and the count given to the command that asked.  A cancelled prompt
+ * answers with an empty string.
+ */
+typedef void (*Prompt_answered)(Editor_state& editor, const std::string& answer, bool& should_exit, int count);
+typedef void (*Yesno_answered)(Editor_state& editor, User_response answer, bool& should_exit);
 
-User_response prompt_yesno(std::string_view message);
+void prompt(std::string_view message, Prompt_answered answered, int count = 0);
+
+void prompt_yesno(std::string_view message, Yesno_answered answered);
+
+/*
+ * Hands a key to the prompt being shown
+ */
+void prompt_key(Editor_state& editor, const Key_input& input, bool& should_exit);
+
+/*
+ * True while a prompt is waiting for an answer on the status line, so work
+ * done in the background doesn't write over it.
+ */
+bool prompt_active();
 
 #endif
@@ -0,0 +1,418 @@
+#ifndef RED_REGULAR_EXPRESSION_H
+#define RED_REGULAR_EXPRESSION_H
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "byte_search.h"
+#include "segmented_algorithm.h"
+#include "text_search.h"
+
+/*
+ * A regular expression compiled to a Thompson NFA.  Byte instructions refer
+ * to a set of bytes, the assertions match at the beginning and end of a line.
+ */
+struct Regex_program {
+	enum class Op : unsigned char {
+		byte,		// x is the index of the set of bytes matched
+		split,		// continue at both x and y
+		jump,		// continue at x
+		line_begin,
+		line_end,
+		match
+	};
+
+	struct Instruction {
+		Op op;
+		int x;
+		int y;
+	};
+
+	std::vector<Instruction> code;
+	std::vector<std::bitset<256>> sets;
+};
+
+/*
+ * Lazy_dfa
+ *
+ * Runs a Regex_program as a DFA whose states are built the first time a
+ * transition needs them, so matching costs a table lookup a byte.  A state is
+ * the set of NFA threads alive before a byte, whether that byte follows a line
+ * break, and whether threads may still start.
+ *
+ * An unanchored DFA starts a thread at every byte.  A leftmost one keeps the
+ * threads in groups by the byte they started at and drops every group after
+ * the first one to match, so scanning to the dead state leaves the last match
+ * seen as the end of the leftmost-longest match.
+ *
+ * States are numbered by the offset of their row in the transition table.
+ * The states and transitions are cached up to cache_budget bytes.  When the
+ * cache fills it is emptied and built again from the current state, unless
+ * the text has been producing a new state every few bytes, in which case the
+ * search gives up rather than run for minutes on a pathological pattern.
+ */
+class Lazy_dfa {
+public:
+	static constexpr std::size_t cache_budget = 4 << 20;
+	static constexpr int dead = 0;
+	static constexpr int unknown = -1;
+	static constexpr int gave_up = -2;
+
+private:
+	Regex_program program;
+	bool unanchored = false;
+	bool leftmost = false;
+	std::array<std::uint8_t, 256> classes{};
+	std::vector<unsigned char> representatives;
+	int stride = 0;
+	// Whether the program has a line_begin, if not the states needn't
+	// remember whether they follow a line break
+	bool line_begins = false;
+	// A state that only leaves on accelerated_byte
+	int accelerated_state = -1;
+	char accelerated_byte = 0;
+
+	struct Key_hash {
+		std::size_t operator()(const std::vector<int>& key) const;
+	};
+
+	// Each key is the threads of a state, groups ending in -1, then the flags
+	std::vector<std::vector<int>> keys;
+	std::unordered_map<std::vector<int>, int, Key_hash> ids;
+	std::vector<int> table;
+	std::size_t memory = 0;
+
+	// Bytes scanned by the search in progress when the cache was last
+	// emptied, and the states built since
+	std::size_t scanned_at_reset = 0;
+	std::size_t states_at_reset = 0;
+
+	// Scratch for computing transitions
+	std::vector<unsigned> visited;
+	std::vector<unsigned> stepped;
+	unsigned stamp = 0;
+
+	int intern(std::vector<int> key);
+	void reset();
+	int compute(int state, int byte_class, std::size_t scanned);
+	void accelerate(int state);
+
+public:
+	Lazy_dfa() = default;
+	Lazy_dfa(Regex_program program, const std::array<std::uint8_t, 256>& classes, int class_count, bool unanchored, bool leftmost);
+
+	/*
+	 * Called before each search, `scanned` counts from zero again
+	 */
+	void begin_search();
+
+	/*
+	 * The state before the first byte, `line_start` if it follows a line
+	 * break or is the beginning of the text
+	 */
+	int start(bool line_start);
+
+	/*
+	 * The transition on `c`, encoded as (next state << 1) | matched where
+	 * matched is set if a match ends before `c`.  Returns gave_up if the
+	 * search should be abandoned.  `scanned` counts the bytes scanned so far.
+	 */
+	int next(int state, unsigned char c, std::size_t scanned)
+	{
+		int t = table[state + classes[c]];
+		return t != unknown ? t : compute(state, classes[c], scanned);
+	}
+
+	/*
+	 * Follows cached transitions for the bytes from `first` to `last` and
+	 * returns the first byte whose transition isn't cached, reports a match
+	 * or leads to the dead state, or last.  `state` is updated to the state
+	 * before that byte.
+	 */
+	const char* run(int& state, const char* first, const char* last) const
+	{
+		const int* t = table.data();
+		int s = state;
+		for (; first != last; ++first) {
+			if (s == accelerated_state) {
+				first = find_byte(first, last, accelerated_byte);
+				if (first == last)
+					break;
+			}
+			int x = t[s + classes[static_cast<unsigned char>(*first)]];
+			if (x <= 1 || (x & 1))
+				break;
+			s = x >> 1;
+		}
+		state = s;
+		return first;
+	}
+
+	/*
+	 * The same running back from `last` to `first`, returns the position
+	 * after the byte that stopped it, or first
+	 */
+	const char* run_backward(int& state, const char* first, const char* last) const
+	{
+		const int* t = table.data();
+		int s = state;
+		for (; last != first; --last) {
+			if (s == accelerated_state) {
+				last = find_byte_backward(first, last, accelerated_byte);
+				if (last == first)
+					break;
+			}
+			int x = t[s + classes[static_cast<unsigned char>(last[-1])]];
+			if (x <= 1 || (x & 1))
+				break;
+			s = x >> 1;
+		}
+		state = s;
+		return last;
+	}
+
+	/*
+	 * The transition at the end of the text scanned, `line_end` if the text
+	 * is followed by a line break or ends there
+	 */
+	int next_end(int state, bool line_end, std::size_t scanned)
+	{
+		int byte_class = stride - (line_end ? 2 : 1);
+		int t = table[state + byte_class];
+		return t != unknown ? t : compute(state, byte_class, scanned);
+	}
+};
+
+/*
+ * Regex
+ *
+ * A search pattern compiled by compile_regex.  Patterns without operators
+ * are searched as literals, the others with a forward DFA to find where the
+ * leftmost match ends and reverse DFAs to find where it starts, or the last
+ * match before a position.  The DFAs keep their states between searches so
+ * repeating a search doesn't build them again.
+ *
+ * Syntax: . [abc] [^a-z] \d \w \s \D \W \S \n \t ^ $ ( ) | * + ? {m} {m,}
+ * {m,n}, a backslash before anything else matches it literally.  Only \n and
+ * sets naming it match a line break, so other matches stay within a line.
+ */
+class Regex {
+	friend bool compile_regex(std::string_view pattern, Regex& regex, std::string& error);
+
+	std::string text;
+	bool is_literal = true;
+	bool newline = false;
+	Literal_pattern literal;
+	Lazy_dfa forward;
+	Lazy_dfa reverse_anchored;
+	Lazy_dfa reverse_unanchored;
+
+public:
+	std::string_view pattern() const
+	{
+		return text;
+	}
+
+	bool empty() const
+	{
+		return text.empty();
+	}
+
+	bool is_literal_pattern() const
+	{
+		return is_literal;
+	}
+
+	const Literal_pattern& literal_pattern() const
+	{
+		return literal;
+	}
+
+	bool matches_newline() const
+	{
+		return newline;
+	}
+
+	Lazy_dfa& forward_dfa()
+	{
+		return forward;
+	}
+
+	Lazy_dfa& reverse_anchored_dfa()
+	{
+		return reverse_anchored;
+	}
+
+	Lazy_dfa& reverse_unanchored_dfa()
+	{
+		return reverse_unanchored;
+	}
+};
+
+/*
+ * Compiles `pattern` into `regex`.  Returns false and describes the problem in
+ * `error` if the pattern is malformed or too large.
+ */
+bool compile_regex(std::string_view pattern, Regex& regex, std::string& error);
+
+enum class Regex_status {
+	match,
+	no_match,
+	too_complex
+};
+
+/*
+ * find_regex
+ *
+ * Finds the leftmost match starting at or after `from` in the text [first,
+ * last) and sets `match` to its start.  The text around `from` decides
+ * whether ^ matches there.
+ */
+template <typename I>
+// requires SegmentedIterator(I)
+Regex_status find_regex(Regex& regex, I first, I from, I last, I& match)
+{
+	if (regex.is_literal_pattern()) {
+		match = find_pattern(regex.literal_pattern(), from, last);
+		return match != last || regex.literal_pattern().empty() ? Regex_status::match : Regex_status::no_match;
+	}
+
+	Lazy_dfa& dfa = regex.forward_dfa();
+	dfa.begin_search();
+	bool line_start = from == first || *(from - 1) == '\n';
+	int state = dfa.start(line_start);
+	std::size_t offset = 0;
+	std::size_t end = 0;
+	bool found = false;
+	auto c = Segmented_iterator_traits<I>::cursor(from, last);
+	for (std::string_view s = c.span(); !s.empty() && state != Lazy_dfa::dead; s = c.span()) {
+		const char* p = s.data();
+		const char* l = p + s.size();
+		while ((p = dfa.run(state, p, l)) != l) {
+			std::size_t i = offset + (p - s.data());
+			int t = dfa.next(state, *p, i);
+			if (t == Lazy_dfa::gave_up)
+				return Regex_status::too_complex;
+			if (t & 1) {
+				end = i;
+				found = true;
+			}
+			state = t >> 1;
+			++p;
+			if (state == Lazy_dfa::dead)
+				break;
+		}
+		offset += p - s.data();
+		c.skip(p - s.data());
+	}
+	if (state != Lazy_dfa::dead) {
+		int t = dfa.next_end(state, true, offset);
+		if (t == Lazy_dfa::gave_up)
+			return Regex_status::too_complex;
+		if (t & 1) {
+			end = offset;
+			found = true;
+		}
+	}
+	if (!found)
+		return Regex_status::no_match;
+
+	// The longest match ending there starts at the leftmost match
+	Lazy_dfa& reverse = regex.reverse_anchored_dfa();
+	reverse.begin_search();
+	I match_end = from + end;
+	state = reverse.start(match_end == last || *match_end == '\n');
+	std::size_t start = end;
+	std::size_t position = end;
+	auto r = Segmented_iterator_traits<I>::reverse_cursor(from, match_end);
+	for (std::string_view s = r.span(); !s.empty() && state != Lazy_dfa::dead; s = r.span()) {
+		const char* f = s.data();
+		const char* p = f + s.size();
+		while ((p = reverse.run_backward(state, f, p)) != f) {
+			std::size_t at = position - (f + s.size() - p);
+			int t = reverse.next(state, p[-1], end - at);
+			if (t == Lazy_dfa::gave_up)
+				return Regex_status::too_complex;
+			if (t & 1)
+				start = at;
+			state = t >> 1;
+			--p;
+			if (state == Lazy_dfa::dead)
+				break;
+		}
+		std::size_t consumed = f + s.size() - p;
+		position -= consumed;
+		r.skip(consumed);
+	}
+	if (state != Lazy_dfa::dead) {
+		int t = reverse.next_end(state, line_start, end);
+		if (t == Lazy_dfa::gave_up)
+			return Regex_status::too_complex;
+		if (t & 1)
+			start = 0;
+	}
+	match = from + start;
+	return Regex_status::match;
+}
+
+/*
+ * find_regex_backward
+ *
+ * Finds the last match starting before `before` in the text [first, last) and
+ * sets `match` to its start.
+ */
+template <typename I>
+// requires SegmentedIterator(I)
+Regex_status find_regex_backward(Regex& regex, I first, I before, I last, I& match)
+{
+	if (regex.is_literal_pattern()) {
+		auto m = static_cast<std::ptrdiff_t>(regex.literal_pattern().size());
+		I l = last - before > m - 1 ? before + (m - 1) : last;
+		match = find_pattern_backward(regex.literal_pattern(), first, l);
+		return match != l ? Regex_status::match : Regex_status::no_match;
+	}
+
+	// Matches starting before `before` end by the end of its line, unless
+	// the pattern can match a line break
+	I scan_from = regex.matches_newline() ? last : segmented_find(before, last, '\n');
+	Lazy_dfa& dfa = regex.reverse_unanchored_dfa();
+	dfa.begin_search();
+	int state = dfa.start(true);
+	std::size_t size = scan_from - first;
+	std::size_t position = size;
+	std::size_t limit = before - first;
+	auto r = Segmented_iterator_traits<I>::reverse_cursor(first, scan_from);
+	for (std::string_view s = r.span(); !s.empty(); s = r.span()) {
+		const char* f = s.data();
+		const char* p = f + s.size();
+		while ((p = dfa.run_backward(state, f, p)) != f) {
+			std::size_t at = position - (f + s.size() - p);
+			int t = dfa.next(state, p[-1], size - at);
+			if (t == Lazy_dfa::gave_up)
+				return Regex_status::too_complex;
+			if ((t & 1) && at < limit) {
+				match = first + at;
+				return Regex_status::match;
+			}
+			state = t >> 1;
+			--p;
+		}
+		position -= s.size();
+		r.skip(s.size());
+	}
+	int t = dfa.next_end(state, true, size);
+	if (t == Lazy_dfa::gave_up)
+		return Regex_status::too_complex;
+	if ((t & 1) && limit > 0) {
+		match = first;
+		return Regex_status::match;
+	}
+	return Regex_status::no_match;
+}
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef RED_REPLAY_H
+#define RED_REPLAY_H
+
+/*
+ * replay
+ *
+ * Runs the editor on `filename` with the keys in `trace_filename`, written in
+ * key notation, as input and an in-memory screen as output.  The commands
+ * run and the display is refreshed just as when editing, as fast as they
+ * can.  Reports the total time, the time spent in each command and a hash of
+ * the buffer's text on stdout.  Returns the process exit code.
+ */
+int replay(const char* trace_filename, const char* filename);
+
+#endif
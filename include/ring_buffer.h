@@ -0,0 +1,92 @@
+#ifndef RED_RING_BUFFER_H
+#define RED_RING_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+
+/*
+ * Ring_buffer
+ *
+ * A first in, first out queue of at most N elements held in place, N a power
+ * of two.  One thread may push while another pops without locking and
+ * without either ever waiting on the other: the read and write counts only
+ * ever increase, each is stored by one side and loaded by the other, their
+ * difference is the number queued and their low bits the slots.  A full ring
+ * needs no slot left empty to tell it from an empty one.
+ */
+template <typename T, std::size_t N>
+// requires Regular(T)
+class Ring_buffer {
+	static_assert(N > 0 && (N & (N - 1)) == 0, "the capacity must be a power of two");
+
+public:
+	using size_type = std::size_t;
+
+private:
+	// On lines of their own so the two sides don't contend for one
+	alignas(64) std::atomic<size_type> read{0};
+	alignas(64) std::atomic<size_type> written{0};
+	alignas(64) T elements[N];
+
+public:
+	static constexpr size_type capacity()
+	{
+		return N;
+	}
+
+	/*
+	 * Exact on a thread that both pushes and pops, otherwise as it was at
+	 * some point during the call.
+	 */
+	size_type size() const
+	{
+		size_type r = read.load(std::memory_order_acquire);
+		return written.load(std::memory_order_acquire) - r;
+	}
+
+	bool empty() const
+	{
+		return size() == 0;
+	}
+
+	bool full() const
+	{
+		return size() == N;
+	}
+
+	/*
+	 * Called by the producer, returns false if the ring is full
+	 */
+	bool push(const T& x)
+	{
+		size_type w = written.load(std::memory_order_relaxed);
+		if (w - read.load(std::memory_order_acquire) == N)
+			return false;
+		elements[w & (N - 1)] = x;
+		written.store(w + 1, std::memory_order_release);
+		return true;
+	}
+
+	/*
+	 * Called by the consumer, returns false if the ring is empty
+	 */
+	bool pop(T& x)
+	{
+		size_type r = read.load(std::memory_order_relaxed);
+		if (r == written.load(std::memory_order_acquire))
+			return false;
+		x = elements[r & (N - 1)];
+		read.store(r + 1, std::memory_order_release);
+		return true;
+	}
+
+	/*
+	 * Drops everything queued, only while nothing is being pushed
+	 */
+	void clear()
+	{
+		read.store(written.load(std::memory_order_acquire), std::memory_order_release);
+	}
+};
+
+#endif
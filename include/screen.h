@@ -1,7 +1,7 @@
 #ifndef RED_SCREEN_H
 #define RED_SCREEN_H
 
-#include <Windows.h>
+#include "platform.h"
 #include <string_view>
 
 struct Screen_dimension {
@@ -14,7 +14,32 @@ enum class Cursor_style {
 	underline
 };
 
+/*
+ * The screen functions draw through a backend, normally the terminal.
+ */
+struct Screen_backend {
+	DWORD (*initialize)();
+	void (*finalize)();
+	Screen_dimension (*dimension)();
+	void (*putstring)(std::string_view str);
+	void (*cursor)(int column, int row);
+	void (*column)(int column);
+	void (*clear_end_of_line)();
+	void (*cursor_style)(Cursor_style style);
+	void (*cursor_visible)(bool visible);
+	void (*flush)();
+};
+
+extern const Screen_backend terminal_screen;
+
+/*
+ * Selects the backend used by the functions below, call before
+ * screen_initialize.
+ */
+void screen_set_backend(const Screen_backend& backend);
+
 DWORD screen_initialize();
+void screen_finalize();
 
 /*
  * Returns the width and height of the screen. Units in characters
@@ -40,4 +65,10 @@ void screen_cursor_style(Cursor_style style);
 
 void screen_cursor_visible(bool visible);
 
+/*
+ * Output may be buffered until screen_flush, which writes everything since
+ * the last flush at once.  Call it once a frame is complete.
+ */
+void screen_flush();
+
 #endif
@@ -0,0 +1,499 @@
+#ifndef RED_SEGMENTED_ALGORITHM_H
+#define RED_SEGMENTED_ALGORITHM_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include "byte_search.h"
+#include "gap_buffer.h"
+#include "iterator.h"
+
+/*
+ * Segmented iterators
+ *
+ * The text in a Gap_buffer, Piece_table or Chunked_gap_buffer is stored in a
+ * number of contiguous segments.  Walking it one character at a time means
+ * checking for the end of a segment on every step, so instead the algorithms
+ * here walk a range one segment at a time and run a tight loop (or a SIMD
+ * kernel, or memcmp) over each contiguous span.
+ *
+ * A segment cursor walks [f, l) and provides
+ *	std::string_view span() const	the contiguous run at the cursor, only
+ *					empty once the range is exhausted
+ *	void skip(std::size_t n)	advance n characters, n <= span().size()
+ *
+ * Segmented_iterator_traits<I>::cursor(f, l) returns a cursor for a range of
+ * a segmented iterator type I.
+ *
+ * A reverse segment cursor walks [f, l) from the back, span() is the
+ * contiguous run ending at the cursor and skip(n) moves back n characters.
+ * Segmented_iterator_traits<I>::reverse_cursor(f, l) returns one.
+ */
+
+/*
+ * Cursor over a fixed list of spans, such as the two halves of a Gap_buffer
+ */
+template <std::size_t N>
+class Span_cursor {
+	std::array<std::string_view, N> spans;
+	std::size_t k = 0;
+
+	void skip_empty()
+	{
+		while (k < N && spans[k].empty())
+			++k;
+	}
+
+public:
+	explicit Span_cursor(const std::array<std::string_view, N>& spans) :
+		spans(spans)
+	{
+		skip_empty();
+	}
+
+	std::string_view span() const
+	{
+		return k < N ? spans[k] : std::string_view();
+	}
+
+	void skip(std::size_t n)
+	{
+		spans[k].remove_prefix(n);
+		skip_empty();
+	}
+};
+
+template <std::size_t N>
+class Reverse_span_cursor {
+	std::array<std::string_view, N> spans;
+	std::size_t k = N;
+
+	void skip_empty()
+	{
+		while (k > 0 && spans[k - 1].empty())
+			--k;
+	}
+
+public:
+	explicit Reverse_span_cursor(const std::array<std::string_view, N>& spans) :
+		spans(spans)
+	{
+		skip_empty();
+	}
+
+	std::string_view span() const
+	{
+		return k > 0 ? spans[k - 1] : std::string_view();
+	}
+
+	void skip(std::size_t n)
+	{
+		spans[k - 1].remove_suffix(n);
+		skip_empty();
+	}
+};
+
+/*
+ * Cursor over a range of a storage, asks the storage for each segment
+ */
+template <typename S>
+// requires Storage(S)
+class Storage_cursor {
+	const S* data;
+	typename S::size_type position;
+	typename S::size_type last;
+	std::string_view current;
+
+	void fetch()
+	{
+		if (current.empty() && position < last) {
+			current = data->segment_from(position);
+			if (current.size() > last - position)
+				current = current.substr(0, last - position);
+		}
+	}
+
+public:
+	Storage_cursor(const S& data, typename S::size_type first, typename S::size_type last) :
+		data(&data),
+		position(first),
+		last(last)
+	{
+		fetch();
+	}
+
+	std::string_view span() const
+	{
+		return current;
+	}
+
+	void skip(std::size_t n)
+	{
+		position += n;
+		current.remove_prefix(n);
+		fetch();
+	}
+};
+
+template <typename S>
+// requires Storage(S)
+class Reverse_storage_cursor {
+	const S* data;
+	typename S::size_type first;
+	typename S::size_type position;
+	std::string_view current;
+
+	void fetch()
+	{
+		if (current.empty() && position > first) {
+			current = data->segment_to(position);
+			if (current.size() > position - first)
+				current = current.substr(current.size() - (position - first));
+		}
+	}
+
+public:
+	Reverse_storage_cursor(const S& data, typename S::size_type first, typename S::size_type last) :
+		data(&data),
+		first(first),
+		position(last)
+	{
+		fetch();
+	}
+
+	std::string_view span() const
+	{
+		return current;
+	}
+
+	void skip(std::size_t n)
+	{
+		position -= n;
+		current.remove_suffix(n);
+		fetch();
+	}
+};
+
+template <typename I>
+struct Segmented_iterator_traits;
+
+template <typename S>
+struct Segmented_iterator_traits<Indexed_iterator<S>> {
+	using cursor_type = Storage_cursor<S>;
+	using reverse_cursor_type = Reverse_storage_cursor<S>;
+
+	static cursor_type cursor(Indexed_iterator<S> f, Indexed_iterator<S> l)
+	{
+		assert(f <= l);
+		return cursor_type(*f.data, f.index, l.index);
+	}
+
+	static reverse_cursor_type reverse_cursor(Indexed_iterator<S> f, Indexed_iterator<S> l)
+	{
+		assert(f <= l);
+		return reverse_cursor_type(*f.data, f.index, l.index);
+	}
+};
+
+template <>
+struct Segmented_iterator_traits<Gap_buffer::iterator> {
+	using cursor_type = Span_cursor<2>;
+	using reverse_cursor_type = Reverse_span_cursor<2>;
+
+	static std::array<std::string_view, 2> spans(Gap_buffer::iterator f, Gap_buffer::iterator l)
+	{
+		assert(f <= l);
+		const char* gap_begin = f.gap_begin;
+		const char* gap_end = f.gap_end;
+		std::string_view before;
+		std::string_view after;
+		if (f.ptr < gap_begin)
+			before = std::string_view(f.ptr, std::min<const char*>(l.ptr, gap_begin) - f.ptr);
+		if (l.ptr >= gap_end) {
+			const char* first = std::max<const char*>(f.ptr, gap_end);
+			after = std::string_view(first, l.ptr - first);
+		}
+		return { before, after };
+	}
+
+	static cursor_type cursor(Gap_buffer::iterator f, Gap_buffer::iterator l)
+	{
+		return cursor_type(spans(f, l));
+	}
+
+	static reverse_cursor_type reverse_cursor(Gap_buffer::iterator f, Gap_buffer::iterator l)
+	{
+		return reverse_cursor_type(spans(f, l));
+	}
+};
+
+/*
+ * Contiguous text is a single segment
+ */
+template <>
+struct Segmented_iterator_traits<const char*> {
+	using cursor_type = Span_cursor<1>;
+	using reverse_cursor_type = Reverse_span_cursor<1>;
+
+	static cursor_type cursor(const char* f, const char* l)
+	{
+		assert(f <= l);
+		return cursor_type({ std::string_view(f, l - f) });
+	}
+
+	static reverse_cursor_type reverse_cursor(const char* f, const char* l)
+	{
+		assert(f <= l);
+		return reverse_cursor_type({ std::string_view(f, l - f) });
+	}
+};
+
+/*
+ * The algorithms over cursors
+ */
+
+template <typename C>
+// requires SegmentCursor(C)
+std::size_t cursor_find(C c, char x)
+{
+	std::size_t n = 0;
+	for (std::string_view s = c.span(); !s.empty(); s = c.span()) {
+		const char* p = find_byte(s.data(), s.data() + s.size(), x);
+		n += p - s.data();
+		if (p != s.data() + s.size())
+			break;
+		c.skip(s.size());
+	}
+	return n;
+}
+
+template <typename C>
+// requires SegmentCursor(C)
+std::size_t cursor_count(C c, char x)
+{
+	std::size_t n = 0;
+	for (std::string_view s = c.span(); !s.empty(); s = c.span()) {
+		n += count_byte(s.data(), s.data() + s.size(), x);
+		c.skip(s.size());
+	}
+	return n;
+}
+
+/*
+ * Compares the first n characters of two cursors, 0 if they are equal,
+ * otherwise negative or positive by comparing the first mismatch as char.
+ */
+template <typename C0, typename C1>
+// requires SegmentCursor(C0) && SegmentCursor(C1)
+int cursor_compare(C0& c0, C1& c1, std::size_t n)
+{
+	while (n > 0) {
+		std::string_view s0 = c0.span();
+		std::string_view s1 = c1.span();
+		std::size_t m = std::min({n, s0.size(), s1.size()});
+		assert(m > 0);
+		if (std::memcmp(s0.data(), s1.data(), m) != 0) {
+			auto mismatch = std::mismatch(s0.data(), s0.data() + m, s1.data());
+			return *mismatch.first < *mismatch.second ? -1 : 1;
+		}
+		c0.skip(m);
+		c1.skip(m);
+		n -= m;
+	}
+	return 0;
+}
+
+template <typename C, typename O>
+// requires SegmentCursor(C) && OutputIterator(O, char)
+O cursor_copy(C c, O out)
+{
+	for (std::string_view s = c.span(); !s.empty(); s = c.span()) {
+		out = std::copy(s.begin(), s.end(), out);
+		c.skip(s.size());
+	}
+	return out;
+}
+
+/*
+ * Overloads of the standard algorithms for the segmented iterators
+ */
+
+template <typename I>
+// requires SegmentedIterator(I)
+I segmented_find(I f, I l, char x)
+{
+	return f + cursor_find(Segmented_iterator_traits<I>::cursor(f, l), x);
+}
+
+template <typename I>
+// requires SegmentedIterator(I)
+std::ptrdiff_t segmented_count(I f, I l, char x)
+{
+	return cursor_count(Segmented_iterator_traits<I>::cursor(f, l), x);
+}
+
+template <typename I>
+// requires SegmentedIterator(I)
+bool segmented_equal(I f0, I l0, const char* f1)
+{
+	auto c0 = Segmented_iterator_traits<I>::cursor(f0, l0);
+	auto c1 = Span_cursor<1>({ std::string_view(f1, l0 - f0) });
+	return cursor_compare(c0, c1, l0 - f0) == 0;
+}
+
+template <typename I>
+// requires SegmentedIterator(I)
+bool segmented_equal(I f0, I l0, I f1)
+{
+	auto c0 = Segmented_iterator_traits<I>::cursor(f0, l0);
+	auto c1 = Segmented_iterator_traits<I>::cursor(f1, f1 + (l0 - f0));
+	return cursor_compare(c0, c1, l0 - f0) == 0;
+}
+
+template <typename I>
+// requires SegmentedIterator(I)
+bool segmented_lexicographical_compare(I f0, I l0, I f1, I l1)
+{
+	std::size_t n0 = l0 - f0;
+	std::size_t n1 = l1 - f1;
+	auto c0 = Segmented_iterator_traits<I>::cursor(f0, l0);
+	auto c1 = Segmented_iterator_traits<I>::cursor(f1, l1);
+	int result = cursor_compare(c0, c1, std::min(n0, n1));
+	return result < 0 || (result == 0 && n0 < n1);
+}
+
+/*
+ * Anchors on the first character of the pattern with find_byte and checks the
+ * rest with memcmp.
+ */
+template <typename I>
+// requires SegmentedIterator(I)
+I segmented_search(I f, I l, const char* pattern_first, const char* pattern_last)
+{
+	std::ptrdiff_t m = pattern_last - pattern_first;
+	if (m == 0)
+		return f;
+	while (l - f >= m) {
+		f = segmented_find(f, l - (m - 1), *pattern_first);
+		if (l - f < m)
+			break;
+		if (segmented_equal(f + 1, f + m, pattern_first + 1))
+			return f;
+		++f;
+	}
+	return l;
+}
+
+template <typename I, typename O>
+// requires SegmentedIterator(I) && OutputIterator(O, char)
+O segmented_copy(I f, I l, O out)
+{
+	return cursor_copy(Segmented_iterator_traits<I>::cursor(f, l), out);
+}
+
+/*
+ * Indexed_iterator
+ */
+
+template <typename S>
+Indexed_iterator<S> find(Indexed_iterator<S> f, Indexed_iterator<S> l, const typename S::value_type& x)
+{
+	return segmented_find(f, l, x);
+}
+
+template <typename S>
+// requires Storage(S)
+Indexed_iterator<S> find_backward(Indexed_iterator<S> f, Indexed_iterator<S> l, const typename S::value_type& x)
+{
+	assert(f <= l);
+	while (l != f) {
+		std::string_view segment = l.data->segment_to(l.index);
+		const char* last = segment.data() + segment.size();
+		const char* first = last - std::min<std::size_t>(segment.size(), l.index - f.index);
+		const char* p = find_byte_backward(first, last, x);
+		l.index -= last - p;
+		if (p != first)
+			break;
+	}
+	return l;
+}
+
+template <typename S>
+std::ptrdiff_t count(Indexed_iterator<S> f, Indexed_iterator<S> l, const typename S::value_type& x)
+{
+	return segmented_count(f, l, x);
+}
+
+template <typename S>
+Indexed_iterator<S> search(Indexed_iterator<S> f, Indexed_iterator<S> l, const char* pattern_first, const char* pattern_last)
+{
+	return segmented_search(f, l, pattern_first, pattern_last);
+}
+
+template <typename S>
+bool equal(Indexed_iterator<S> f0, Indexed_iterator<S> l0, const char* f1)
+{
+	return segmented_equal(f0, l0, f1);
+}
+
+template <typename S>
+bool equal(Indexed_iterator<S> f0, Indexed_iterator<S> l0, Indexed_iterator<S> f1)
+{
+	return segmented_equal(f0, l0, f1);
+}
+
+template <typename S>
+bool lexicographical_compare(Indexed_iterator<S> f0, Indexed_iterator<S> l0, Indexed_iterator<S> f1, Indexed_iterator<S> l1)
+{
+	return segmented_lexicographical_compare(f0, l0, f1, l1);
+}
+
+template <typename S, typename O>
+O copy(Indexed_iterator<S> f, Indexed_iterator<S> l, O out)
+{
+	return segmented_copy(f, l, out);
+}
+
+/*
+ * Gap_buffer::iterator
+ */
+
+inline Gap_buffer::iterator find(Gap_buffer::iterator f, Gap_buffer::iterator l, char x)
+{
+	return segmented_find(f, l, x);
+}
+
+inline std::ptrdiff_t count(Gap_buffer::iterator f, Gap_buffer::iterator l, char x)
+{
+	return segmented_count(f, l, x);
+}
+
+inline Gap_buffer::iterator search(Gap_buffer::iterator f, Gap_buffer::iterator l, const char* pattern_first, const char* pattern_last)
+{
+	return segmented_search(f, l, pattern_first, pattern_last);
+}
+
+inline bool equal(Gap_buffer::iterator f0, Gap_buffer::iterator l0, const char* f1)
+{
+	return segmented_equal(f0, l0, f1);
+}
+
+inline bool equal(Gap_buffer::iterator f0, Gap_buffer::iterator l0, Gap_buffer::iterator f1)
+{
+	return segmented_equal(f0, l0, f1);
+}
+
+inline bool lexicographical_compare(Gap_buffer::iterator f0, Gap_buffer::iterator l0, Gap_buffer::iterator f1, Gap_buffer::iterator l1)
+{
+	return segmented_lexicographical_compare(f0, l0, f1, l1);
+}
+
+template <typename O>
+O copy(Gap_buffer::iterator f, Gap_buffer::iterator l, O out)
+{
+	return segmented_copy(f, l, out);
+}
+
+#endif
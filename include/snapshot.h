@@ -0,0 +1,46 @@
+#ifndef RED_SNAPSHOT_H
+#define RED_SNAPSHOT_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "storage.h"
+
+/*
+ * Snapshot
+ *
+ * A buffer's text as it was when the snapshot was taken.  It is taken on
+ * the editor thread and can then be read from any thread while the buffer
+ * carries on being edited.  No text is copied: the snapshot shares the
+ * storage's segments, which the storage leaves alone until the snapshot is
+ * dropped, see share() on each of them.
+ */
+class Snapshot {
+	std::shared_ptr<const void> owner;
+	std::vector<std::string_view> spans;
+	std::size_t length = 0;
+
+public:
+	Snapshot() = default;
+	explicit Snapshot(Text_storage& text);
+
+	std::size_t size() const;
+
+	/*
+	 * The text as a list of contiguous, non-empty spans, in order.
+	 */
+	const std::vector<std::string_view>& segments() const;
+};
+
+/*
+ * Writes the snapshot to a temporary file in the same directory as
+ * `filename` and renames it over `filename`, so the file is either the old
+ * or the new contents, never a mixture.  A symbolic link is followed, the
+ * file it points to is the one replaced.  Uses vectored writes over the
+ * segments on POSIX.  Returns 0 or the error code from the system.
+ */
+unsigned long write_snapshot(const Snapshot& snapshot, const std::string& filename);
+
+#endif
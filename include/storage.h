@@ -0,0 +1,20 @@
+#ifndef RED_STORAGE_H
+#define RED_STORAGE_H
+
+/*
+ * The container holding the text of a Buffer, chosen when red is built. All
+ * of them provide the same interface: size(), operator[], begin(), end(), insert,
+ * erase and the segment_from/segment_to access to contiguous runs of text.
+ */
+#if defined(RED_PIECE_TABLE)
+#include "piece_table.h"
+using Text_storage = Piece_table;
+#elif defined(RED_CHUNKED_GAP_BUFFER)
+#include "chunked_gap_buffer.h"
+using Text_storage = Chunked_gap_buffer;
+#else
+#include "gap_buffer.h"
+using Text_storage = Gap_buffer;
+#endif
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef RED_TERMINAL_KEYS_H
+#define RED_TERMINAL_KEYS_H
+
+#include <cstddef>
+#include <string_view>
+#include "input.h"
+
+/*
+ * decode_terminal_key
+ *
+ * Decodes the first key in the bytes read from a terminal into the Win32
+ * encoding used by Key_input: a virtual-key code with the SHIFT, CONTROL and
+ * ALT bits.  Handles control characters, ESC prefixed ALT keys and the CSI
+ * and SS3 sequences xterm compatible terminals send for cursor and editing
+ * keys, including their modifier parameters, and the bracketed paste
+ * markers.
+ *
+ * Returns the number of bytes used, or zero if `input` holds the start of an
+ * escape sequence and `more` says further bytes may be on their way.  When
+ * no more are coming an incomplete sequence is decoded as a plain ESC.
+ * Unrecognised sequences are consumed and produce a key of zero.
+ */
+std::size_t decode_terminal_key(std::string_view input, bool more, Key_input& key);
+
+#endif
@@ -0,0 +1,173 @@
+#ifndef RED_TEXT_SEARCH_H
+#define RED_TEXT_SEARCH_H
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include "segmented_algorithm.h"
+
+/*
+ * Literal_pattern
+ *
+ * A search string compiled once for searching repeatedly.  Contiguous text is
+ * scanned with find_byte for the byte of the pattern least likely to occur in
+ * text, each candidate is checked with memcmp.  If the anchor turns out to be
+ * common in the text being searched the scan switches to Horspool's algorithm,
+ * whose shifts don't depend on the anchor, for the rest of the range.
+ */
+class Literal_pattern {
+	std::string text;
+	// Horspool shifts keyed on the last byte of the window searching forward
+	// and on the first byte searching backward
+	std::array<unsigned, 256> forward_shift;
+	std::array<unsigned, 256> backward_shift;
+	std::size_t anchor_offset = 0;
+
+	const char* horspool(const char* first, const char* last) const;
+	const char* horspool_backward(const char* first, const char* last) const;
+
+public:
+	Literal_pattern();
+	explicit Literal_pattern(std::string_view pattern);
+
+	std::string_view pattern() const
+	{
+		return text;
+	}
+
+	std::size_t size() const
+	{
+		return text.size();
+	}
+
+	bool empty() const
+	{
+		return text.empty();
+	}
+
+	/*
+	 * Returns the start of the first match lying wholly in [first, last), or
+	 * last.  An empty pattern matches at first.
+	 */
+	const char* find(const char* first, const char* last) const;
+
+	/*
+	 * Returns the start of the last match lying wholly in [first, last), or
+	 * last.  An empty pattern matches at last.
+	 */
+	const char* find_backward(const char* first, const char* last) const;
+};
+
+/*
+ * find_pattern
+ *
+ * Returns the first match of `pattern` lying wholly in [f, l), or l.  Each
+ * segment is searched in place, a match straddling segments is found by
+ * searching the pattern size - 1 bytes either side of the boundary.
+ */
+template <typename I>
+// requires SegmentedIterator(I)
+I find_pattern(const Literal_pattern& pattern, I f, I l)
+{
+	std::size_t m = pattern.size();
+	if (m == 0)
+		return f;
+
+	auto c = Segmented_iterator_traits<I>::cursor(f, l);
+	// The last m - 1 bytes before the current span, and the bytes around the
+	// boundary with it
+	std::string carry;
+	std::string window;
+	std::size_t offset = 0;
+	for (std::string_view s = c.span(); !s.empty(); s = c.span()) {
+		if (!carry.empty()) {
+			window = carry;
+			auto peek = c;
+			for (std::string_view t = peek.span(); !t.empty() && window.size() < carry.size() + m - 1; t = peek.span()) {
+				std::size_t n = std::min(t.size(), carry.size() + m - 1 - window.size());
+				window.append(t.data(), n);
+				peek.skip(n);
+			}
+			const char* hit = pattern.find(window.data(), window.data() + window.size());
+			if (hit != window.data() + window.size() && static_cast<std::size_t>(hit - window.data()) < carry.size())
+				return f + (offset - carry.size() + (hit - window.data()));
+		}
+
+		const char* hit = pattern.find(s.data(), s.data() + s.size());
+		if (hit != s.data() + s.size())
+			return f + (offset + (hit - s.data()));
+
+		if (s.size() >= m - 1) {
+			carry.assign(s.data() + s.size() - (m - 1), m - 1);
+		} else {
+			carry.append(s.data(), s.size());
+			if (carry.size() > m - 1)
+				carry.erase(0, carry.size() - (m - 1));
+		}
+		offset += s.size();
+		c.skip(s.size());
+	}
+	return l;
+}
+
+/*
+ * find_pattern_backward
+ *
+ * Returns the start of the last match of `pattern` lying wholly in [f, l), or
+ * l.  The segments are searched from the back in the same way.
+ */
+template <typename I>
+// requires SegmentedIterator(I)
+I find_pattern_backward(const Literal_pattern& pattern, I f, I l)
+{
+	std::size_t m = pattern.size();
+	if (m == 0)
+		return l;
+
+	auto c = Segmented_iterator_traits<I>::reverse_cursor(f, l);
+	// The first m - 1 bytes after the current span, and the bytes around the
+	// boundary with it
+	std::string carry;
+	std::string window;
+	// Distance from l back to the end of the current span
+	std::size_t offset = 0;
+	for (std::string_view s = c.span(); !s.empty(); s = c.span()) {
+		// A match straddling the boundary starts after any match inside s
+		if (!carry.empty()) {
+			window.clear();
+			auto peek = c;
+			for (std::string_view t = peek.span(); !t.empty() && window.size() < m - 1; t = peek.span()) {
+				std::size_t n = std::min(t.size(), m - 1 - window.size());
+				window.insert(0, t.data() + t.size() - n, n);
+				peek.skip(n);
+			}
+			std::size_t before = window.size();
+			window += carry;
+			// Only matches starting before the boundary, those after it
+			// have been searched already
+			const char* last = window.data() + std::min(window.size(), before - 1 + m);
+			const char* hit = pattern.find_backward(window.data(), last);
+			if (hit != last)
+				return l - (offset + (before - (hit - window.data())));
+		}
+
+		const char* last = s.data() + s.size();
+		const char* hit = pattern.find_backward(s.data(), last);
+		if (hit != last)
+			return l - (offset + (last - hit));
+
+		if (s.size() >= m - 1) {
+			carry.assign(s.data(), m - 1);
+		} else {
+			carry.insert(0, s.data(), s.size());
+			if (carry.size() > m - 1)
+				carry.resize(m - 1);
+		}
+		offset += s.size();
+		c.skip(s.size());
+	}
+	return l;
+}
+
+#endif
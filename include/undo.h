@@ -0,0 +1,142 @@
+#ifndef RED_UNDO_H
+#define RED_UNDO_H
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "storage.h"
+
+/*
+ * An edit to replay when undoing or redoing, the text is only valid until
+ * the journal is next modified.
+ */
+struct Undo_edit {
+	enum class Kind { insert, erase };
+
+	Kind kind;
+	std::size_t position;
+	std::string_view text;
+};
+
+/*
+ * Undo_journal
+ *
+ * Records the edits made to a buffer as groups, a group is everything done
+ * by one command, so a whole insert mode session is undone in one step.
+ * Within a group consecutive edits are coalesced: typing appends to one
+ * insert, backspacing and deleting forward extend one erase, and backspacing
+ * over text typed in the same group shortens the insert.  Each group stores
+ * its text in one arena, so a group costs a couple of allocations however
+ * many keys were pressed, and undoing an erase of any size is one insert.
+ *
+ * The memory used by the history is bounded by `limit`, the oldest groups are
+ * dropped once it is exceeded.  The group being recorded is always kept.
+ */
+class Undo_journal {
+public:
+	using size_type = std::size_t;
+
+	static constexpr size_type default_limit = 64 * 1024 * 1024;
+
+private:
+	struct Edit {
+		Undo_edit::Kind kind;
+		size_type position;
+		size_type length;
+		size_type offset; // of the text in the group's arena
+	};
+
+	struct Group {
+		size_type cursor_before;
+		size_type cursor_after;
+		std::vector<Edit> edits;
+		std::string arena;
+		size_type memory = 0;
+	};
+
+	std::deque<Group> groups;
+	// groups[0, current) can be undone, groups[current, size) redone
+	size_type current = 0;
+	size_type memory = 0;
+	size_type limit = default_limit;
+	bool open = false;
+	bool recording = false; // the open group has been added to groups
+	bool replaying = false;
+	size_type cursor_before = 0;
+
+	Group& recording_group(size_type position);
+	void account(Group& group);
+	void evict();
+
+public:
+	/*
+	 * Everything recorded between begin_group and end_group is undone
+	 * together, `cursor` is where to put the cursor after undoing or redoing
+	 * it.  Groups without any edits are dropped.  end_group does nothing if
+	 * no group is open.
+	 */
+	void begin_group(size_type cursor);
+	void end_group(size_type cursor);
+
+	/*
+	 * Called before the text is inserted or erased.
+	 */
+	void record_insert(size_type position, std::string_view text);
+	void record_erase(const Text_storage& text, size_type position, size_type n);
+
+	bool can_undo() const;
+	bool can_redo() const;
+
+	/*
+	 * Calls apply with each edit needed to undo or redo the last group, in
+	 * order, and sets `cursor` to where it was.  Edits made by `apply` are not
+	 * recorded.  Returns false if there was nothing to undo or redo.
+	 */
+	template <typename F>
+	// requires Procedure(F, const Undo_edit&)
+	bool undo(F apply, size_type& cursor);
+
+	template <typename F>
+	// requires Procedure(F, const Undo_edit&)
+	bool redo(F apply, size_type& cursor);
+
+	size_type memory_used() const;
+	void set_limit(size_type bytes);
+	void clear();
+};
+
+template <typename F>
+// requires Procedure(F, const Undo_edit&)
+bool Undo_journal::undo(F apply, size_type& cursor)
+{
+	if (!can_undo())
+		return false;
+	const Group& group = groups[--current];
+	replaying = true;
+	for (auto edit = group.edits.rbegin(); edit != group.edits.rend(); ++edit) {
+		Undo_edit::Kind kind = edit->kind == Undo_edit::Kind::insert ? Undo_edit::Kind::erase : Undo_edit::Kind::insert;
+		apply(Undo_edit{ kind, edit->position, std::string_view(group.arena).substr(edit->offset, edit->length) });
+	}
+	replaying = false;
+	cursor = group.cursor_before;
+	return true;
+}
+
+template <typename F>
+// requires Procedure(F, const Undo_edit&)
+bool Undo_journal::redo(F apply, size_type& cursor)
+{
+	if (!can_redo())
+		return false;
+	const Group& group = groups[current++];
+	replaying = true;
+	for (const Edit& edit : group.edits)
+		apply(Undo_edit{ edit.kind, edit.position, std::string_view(group.arena).substr(edit.offset, edit.length) });
+	replaying = false;
+	cursor = group.cursor_after;
+	return true;
+}
+
+#endif
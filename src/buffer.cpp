@@ -1,50 +1,132 @@
 #include "buffer.h"
+#include <algorithm>
+
+Buffer::Buffer()
+{
+	lines.assign(contents);
+}
+
+Buffer::Buffer(std::string name, Buffer_storage contents) :
+	name(std::move(name)),
+	contents(std::move(contents))
+{
+	lines.assign(this->contents);
+}
 
 Buffer::iterator Buffer::begin()
 {
-	return Indexed_iterator(contents, 0);
+	return iterator(contents, 0);
 }
 
 Buffer::iterator Buffer::end()
 {
-	return Indexed_iterator(contents, contents.size());
+	return iterator(contents, contents.size());
 }
 
-bool Buffer::write_file(HANDLE file_handle)
+void Buffer::insert(iterator i, char c)
 {
-	bool result = false;
-	const char* data = contents.begin0();
-	DWORD bytes = static_cast<DWORD>(contents.end0() - data);
-	DWORD bytes_written;
-	if (WriteFile(file_handle, data, bytes, &bytes_written, NULL) && bytes_written == bytes) {
-		data = contents.begin1();
-		bytes = static_cast<DWORD>(contents.end1() - data);
-		if (WriteFile(file_handle, data, bytes, &bytes_written, NULL) && bytes_written == bytes) {
-			modified = false;
-			result = true;
-		} else {
-		}
-	} else {
-	}
-	return result;
+	insert(i, std::string_view(&c, 1));
 }
 
-void Buffer::insert(iterator i, char c)
+void Buffer::insert(iterator i, std::string_view text)
 {
 	modified = true;
-	contents.insert(contents.begin() + i.index, 1, c);
+	history.record_insert(i.index, text);
+	contents.insert(contents.begin() + i.index, text);
+	lines.insert(contents, i.index, text.size());
+	columns.insert(i.index, text.size());
 }
 
 void Buffer::erase(iterator i)
 {
 	modified = true;
+	history.record_erase(contents, i.index, 1);
+	lines.erase(contents, i.index, 1);
+	columns.erase(i.index, 1);
 	contents.erase(contents.begin() + i.index, 1);
 }
 
 Buffer::iterator Buffer::erase(iterator f, iterator l)
 {
 	modified = true;
+	history.record_erase(contents, f.index, l.index - f.index);
+	lines.erase(contents, f.index, l.index - f.index);
+	columns.erase(f.index, l.index - f.index);
 	auto first = contents.begin();
 	auto last = contents.erase(first + f.index, first + l.index);
 	return iterator(contents, last - contents.begin());
 }
+
+Buffer::iterator Buffer::replace(iterator f, iterator l, std::string_view text)
+{
+	modified = true;
+	history.record_erase(contents, f.index, l.index - f.index);
+	history.record_insert(f.index, text);
+	lines.erase(contents, f.index, l.index - f.index);
+	columns.erase(f.index, l.index - f.index);
+	auto first = contents.begin();
+	contents.replace(first + f.index, first + l.index, text);
+	lines.insert(contents, f.index, text.size());
+	columns.insert(f.index, text.size());
+	return iterator(contents, f.index + text.size());
+}
+
+bool Buffer::undo(iterator& cursor)
+{
+	size_type position;
+	bool done = history.undo([this] (const Undo_edit& edit) {
+		if (edit.kind == Undo_edit::Kind::insert)
+			insert(begin() + edit.position, edit.text);
+		else
+			erase(begin() + edit.position, begin() + edit.position + edit.text.size());
+	}, position);
+	if (done)
+		cursor = begin() + std::min(position, contents.size());
+	return done;
+}
+
+bool Buffer::redo(iterator& cursor)
+{
+	size_type position;
+	bool done = history.redo([this] (const Undo_edit& edit) {
+		if (edit.kind == Undo_edit::Kind::insert)
+			insert(begin() + edit.position, edit.text);
+		else
+			erase(begin() + edit.position, begin() + edit.position + edit.text.size());
+	}, position);
+	if (done)
+		cursor = begin() + std::min(position, contents.size());
+	return done;
+}
+
+Buffer::size_type Buffer::line_count() const
+{
+	return lines.line_count();
+}
+
+Buffer::size_type Buffer::line_number(iterator i) const
+{
+	return lines.line_number(contents, i.index);
+}
+
+Buffer::iterator Buffer::line_begin(size_type line)
+{
+	return iterator(contents, lines.line_begin(contents, line));
+}
+
+int Buffer::column(iterator i)
+{
+	size_type line = lines.line_begin(contents, lines.line_number(contents, i.index));
+	return columns.column(contents, line, i.index);
+}
+
+Buffer::iterator Buffer::column_position(iterator line, int column)
+{
+	int reached;
+	return column_position(line, column, reached);
+}
+
+Buffer::iterator Buffer::column_position(iterator line, int column, int& reached)
+{
+	return iterator(contents, columns.position(contents, line.index, column, reached));
+}
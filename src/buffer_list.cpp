@@ -0,0 +1,147 @@
+#include "buffer_list.h"
+#include "file.h"
+#include <algorithm>
+#include <cassert>
+
+Buffer_list::Entry& Buffer_list::entry(const Buffer& buffer)
+{
+	auto iter = std::find_if(entries.begin(), entries.end(), [&buffer] (const Entry& x) {
+		return x.buffer.get() == &buffer;
+	});
+	assert(iter != entries.end());
+	return *iter;
+}
+
+const Buffer_list::Entry& Buffer_list::entry(const Buffer& buffer) const
+{
+	return const_cast<Buffer_list*>(this)->entry(buffer);
+}
+
+/*
+ * The text and its undo history, the rest of a buffer is small
+ */
+Buffer_list::size_type Buffer_list::memory_used(const Entry& x)
+{
+	return x.buffer->contents.size() + x.buffer->history.memory_used();
+}
+
+bool Buffer_list::releasable(const Entry& x, const Buffer* current) const
+{
+	return x.buffer.get() != current && !x.released && !x.buffer->modified && !x.buffer->name.empty() && !x.buffer->load;
+}
+
+Buffer& Buffer_list::add(Buffer buffer)
+{
+	entries.push_back(Entry{ std::make_unique<Buffer>(std::move(buffer)), Buffer_position{}, 0, false });
+	return *entries.back().buffer;
+}
+
+void Buffer_list::remove(Buffer& buffer)
+{
+	Entry& x = entry(buffer);
+	entries.erase(entries.begin() + (&x - entries.data()));
+}
+
+bool Buffer_list::contains(const Buffer* buffer) const
+{
+	return std::any_of(entries.begin(), entries.end(), [buffer] (const Entry& x) {
+		return x.buffer.get() == buffer;
+	});
+}
+
+Buffer* Buffer_list::find(std::string_view name)
+{
+	for (Entry& x : entries) {
+		if (x.buffer->name == name)
+			return x.buffer.get();
+	}
+	return nullptr;
+}
+
+Buffer* Buffer_list::alternate(const Buffer& buffer)
+{
+	Entry* result = nullptr;
+	for (Entry& x : entries) {
+		if (x.buffer.get() != &buffer && (!result || x.last_shown > result->last_shown))
+			result = &x;
+	}
+	return result ? result->buffer.get() : nullptr;
+}
+
+Buffer_list::size_type Buffer_list::size() const
+{
+	return entries.size();
+}
+
+Buffer_list::size_type Buffer_list::modified_count() const
+{
+	return std::count_if(entries.begin(), entries.end(), [] (const Entry& x) {
+		return x.buffer->modified;
+	});
+}
+
+DWORD Buffer_list::show(Buffer& buffer)
+{
+	Entry& x = entry(buffer);
+	if (x.released) {
+		DWORD last_error = file_open(buffer.name, buffer);
+		if (last_error != 0)
+			return last_error;
+		x.released = false;
+	}
+	x.last_shown = ++clock;
+	return 0;
+}
+
+bool Buffer_list::released(const Buffer& buffer) const
+{
+	return entry(buffer).released;
+}
+
+Buffer_position& Buffer_list::position(const Buffer& buffer)
+{
+	return entry(buffer).position;
+}
+
+void Buffer_list::trim(const Buffer* current)
+{
+	if (file_save_pending())
+		return;
+
+	size_type used = memory_used();
+	while (used > budget) {
+		Entry* oldest = nullptr;
+		for (Entry& x : entries) {
+			if (releasable(x, current) && (!oldest || x.last_shown < oldest->last_shown))
+				oldest = &x;
+		}
+		if (!oldest)
+			break;
+
+		used -= memory_used(*oldest);
+		Buffer& buffer = *oldest->buffer;
+		buffer.contents = Buffer::Buffer_storage{};
+		buffer.lines.assign(buffer.contents);
+		buffer.columns.clear();
+		buffer.history.clear();
+		oldest->released = true;
+	}
+}
+
+Buffer_list::size_type Buffer_list::memory_used() const
+{
+	size_type used = 0;
+	for (const Entry& x : entries)
+		used += memory_used(x);
+	return used;
+}
+
+Buffer_list::size_type Buffer_list::memory_budget() const
+{
+	return budget;
+}
+
+void Buffer_list::set_memory_budget(size_type bytes)
+{
+	budget = bytes;
+}
@@ -0,0 +1,98 @@
+#include "buffer_list.h"
+#include "file.h"
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+static void write_file(const std::string& filename, const std::string& text)
+{
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	file.write(text.data(), text.size());
+}
+
+static std::string contents(Buffer& buffer)
+{
+	return std::string(buffer.begin(), buffer.end());
+}
+
+static Buffer& open(Buffer_list& buffers, const std::string& filename)
+{
+	Buffer buffer;
+	assert(file_open(filename, buffer) == 0);
+	return buffers.add(std::move(buffer));
+}
+
+int main()
+{
+	const std::string names[] = { "buffer_list.test.1.txt", "buffer_list.test.2.txt", "buffer_list.test.3.txt" };
+	const std::string texts[] = { std::string(1000, 'a') + "\n", std::string(2000, 'b') + "\n", std::string(3000, 'c') + "\n" };
+	for (int i = 0; i < 3; ++i)
+		write_file(names[i], texts[i]);
+
+	Buffer_list buffers;
+	Buffer& scratch = buffers.add(Buffer());
+	Buffer& a = open(buffers, names[0]);
+	Buffer& b = open(buffers, names[1]);
+	Buffer& c = open(buffers, names[2]);
+	assert(buffers.size() == 4);
+	assert(buffers.find(names[1]) == &b);
+	assert(buffers.find("missing") == nullptr);
+	assert(buffers.contains(&c));
+	assert(buffers.memory_used() == 6003);
+
+	// Buffers keep their address as others are added
+	assert(buffers.show(a) == 0);
+	assert(buffers.show(b) == 0);
+	assert(buffers.alternate(b) == &a);
+	buffers.position(a).cursor = 500;
+	assert(buffers.position(a).cursor == 500);
+
+	// Under the budget nothing is released
+	buffers.trim(&b);
+	assert(!buffers.released(a) && !buffers.released(b) && !buffers.released(c));
+
+	// The least recently shown go first: c was never shown, then a
+	buffers.set_memory_budget(4000);
+	buffers.trim(&b);
+	assert(buffers.released(c) && !buffers.released(a));
+	assert(c.contents.size() == 0 && c.name == names[2]);
+	assert(buffers.memory_used() == 3002);
+
+	buffers.set_memory_budget(0);
+	a.insert(a.begin(), 'x');
+	buffers.trim(&b);
+	assert(!buffers.released(a) && !buffers.released(b));
+	assert(!buffers.released(scratch));
+
+	// Showing reads the text back, the position is kept
+	a.modified = false;
+	buffers.trim(&b);
+	assert(buffers.released(a));
+	assert(buffers.position(a).cursor == 500);
+	assert(buffers.show(c) == 0);
+	assert(!buffers.released(c));
+	assert(contents(c) == texts[2]);
+	assert(c.line_count() == 2);
+	assert(buffers.alternate(c) == &b);
+
+	// A file deleted since reads back as an empty buffer, as when creating one
+	buffers.set_memory_budget(Buffer_list::default_memory_budget);
+	std::remove(names[0].c_str());
+	assert(buffers.show(a) == 0);
+	assert(contents(a).empty());
+	write_file(names[0], texts[0]);
+
+	assert(buffers.modified_count() == 0);
+	b.insert(b.end(), 'y');
+	assert(buffers.modified_count() == 1);
+
+	buffers.remove(b);
+	assert(buffers.size() == 3);
+	assert(!buffers.contains(&b));
+	assert(buffers.find(names[1]) == nullptr);
+	assert(contents(c) == texts[2]);
+
+	for (const std::string& name : names)
+		std::remove(name.c_str());
+}
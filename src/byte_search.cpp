@@ -0,0 +1,239 @@
+#include "byte_search.h"
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define RED_BYTE_SEARCH_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define RED_TARGET_AVX2
+#else
+#define RED_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+static const char* find_byte_scalar(const char* first, const char* last, char c)
+{
+	return std::find(first, last, c);
+}
+
+static const char* find_byte_backward_scalar(const char* first, const char* last, char c)
+{
+	while (last != first) {
+		--last;
+		if (*last == c)
+			return last + 1;
+	}
+	return first;
+}
+
+static std::size_t count_byte_scalar(const char* first, const char* last, char c)
+{
+	return std::count(first, last, c);
+}
+
+#if defined(RED_BYTE_SEARCH_X86)
+
+static unsigned lowest_bit(std::uint32_t mask)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+static unsigned highest_bit(std::uint32_t mask)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse(&index, mask);
+	return index;
+#else
+	return 31 - __builtin_clz(mask);
+#endif
+}
+
+static bool cpu_supports_avx2()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	__cpuid(info, 1);
+	const int osxsave = 1 << 27;
+	const int avx = 1 << 28;
+	if ((info[2] & (osxsave | avx)) != (osxsave | avx))
+		return false;
+	// The OS must save the YMM registers on a context switch
+	if ((_xgetbv(0) & 6) != 6)
+		return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static const char* find_byte_sse2(const char* first, const char* last, char c)
+{
+	const __m128i needle = _mm_set1_epi8(c);
+	while (last - first >= 16) {
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+		std::uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+		if (mask)
+			return first + lowest_bit(mask);
+		first += 16;
+	}
+	return find_byte_scalar(first, last, c);
+}
+
+static const char* find_byte_backward_sse2(const char* first, const char* last, char c)
+{
+	const __m128i needle = _mm_set1_epi8(c);
+	while (last - first >= 16) {
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(last - 16));
+		std::uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+		if (mask)
+			return last - 16 + highest_bit(mask) + 1;
+		last -= 16;
+	}
+	return find_byte_backward_scalar(first, last, c);
+}
+
+static std::size_t count_byte_sse2(const char* first, const char* last, char c)
+{
+	const __m128i needle = _mm_set1_epi8(c);
+	std::size_t count = 0;
+	while (last - first >= 16) {
+		// Each byte lane counts up to 255 matches before we sum them
+		std::size_t blocks = std::min<std::size_t>((last - first) / 16, 255);
+		__m128i lanes = _mm_setzero_si128();
+		for (std::size_t i = 0; i < blocks; ++i) {
+			__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+			lanes = _mm_sub_epi8(lanes, _mm_cmpeq_epi8(chunk, needle));
+			first += 16;
+		}
+		__m128i sums = _mm_sad_epu8(lanes, _mm_setzero_si128());
+		count += _mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4);
+	}
+	return count + count_byte_scalar(first, last, c);
+}
+
+RED_TARGET_AVX2
+static const char* find_byte_avx2(const char* first, const char* last, char c)
+{
+	const __m256i needle = _mm256_set1_epi8(c);
+	while (last - first >= 32) {
+		__m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+		std::uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle));
+		if (mask)
+			return first + lowest_bit(mask);
+		first += 32;
+	}
+	return find_byte_sse2(first, last, c);
+}
+
+RED_TARGET_AVX2
+static const char* find_byte_backward_avx2(const char* first, const char* last, char c)
+{
+	const __m256i needle = _mm256_set1_epi8(c);
+	while (last - first >= 32) {
+		__m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(last - 32));
+		std::uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle));
+		if (mask)
+			return last - 32 + highest_bit(mask) + 1;
+		last -= 32;
+	}
+	return find_byte_backward_sse2(first, last, c);
+}
+
+RED_TARGET_AVX2
+static std::size_t count_byte_avx2(const char* first, const char* last, char c)
+{
+	const __m256i needle = _mm256_set1_epi8(c);
+	std::size_t count = 0;
+	while (last - first >= 32) {
+		std::size_t blocks = std::min<std::size_t>((last - first) / 32, 255);
+		__m256i lanes = _mm256_setzero_si256();
+		for (std::size_t i = 0; i < blocks; ++i) {
+			__m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+			lanes = _mm256_sub_epi8(lanes, _mm256_cmpeq_epi8(chunk, needle));
+			first += 32;
+		}
+		__m256i sums = _mm256_sad_epu8(lanes, _mm256_setzero_si256());
+		alignas(32) std::uint64_t parts[4];
+		_mm256_store_si256(reinterpret_cast<__m256i*>(parts), sums);
+		count += parts[0] + parts[1] + parts[2] + parts[3];
+	}
+	return count + count_byte_sse2(first, last, c);
+}
+
+#endif
+
+struct Byte_search_kernels {
+	Simd_level level;
+	const char* (*find)(const char*, const char*, char);
+	const char* (*find_backward)(const char*, const char*, char);
+	std::size_t (*count)(const char*, const char*, char);
+};
+
+static Byte_search_kernels make_kernels(Simd_level level)
+{
+	level = std::min(level, byte_search_supported());
+	switch (level) {
+#if defined(RED_BYTE_SEARCH_X86)
+	case Simd_level::avx2:
+		return { level, find_byte_avx2, find_byte_backward_avx2, count_byte_avx2 };
+	case Simd_level::sse2:
+		return { level, find_byte_sse2, find_byte_backward_sse2, count_byte_sse2 };
+#endif
+	default:
+		return { Simd_level::scalar, find_byte_scalar, find_byte_backward_scalar, count_byte_scalar };
+	}
+}
+
+static Byte_search_kernels& kernels()
+{
+	static Byte_search_kernels result = make_kernels(byte_search_supported());
+	return result;
+}
+
+const char* find_byte(const char* first, const char* last, char c)
+{
+	return kernels().find(first, last, c);
+}
+
+const char* find_byte_backward(const char* first, const char* last, char c)
+{
+	return kernels().find_backward(first, last, c);
+}
+
+std::size_t count_byte(const char* first, const char* last, char c)
+{
+	return kernels().count(first, last, c);
+}
+
+Simd_level byte_search_supported()
+{
+#if defined(RED_BYTE_SEARCH_X86)
+	static const Simd_level supported = cpu_supports_avx2() ? Simd_level::avx2 : Simd_level::sse2;
+	return supported;
+#else
+	return Simd_level::scalar;
+#endif
+}
+
+Simd_level byte_search_level()
+{
+	return kernels().level;
+}
+
+void byte_search_select(Simd_level level)
+{
+	kernels() = make_kernels(level);
+}
@@ -0,0 +1,74 @@
+#include "byte_search.h"
+#include "segmented_algorithm.h"
+#include "gap_buffer.h"
+#include <cassert>
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+static void check_kernels()
+{
+	std::string text(1000, 'a');
+	for (std::size_t i = 0; i < text.size(); ++i) {
+		if (std::rand() % 50 == 0)
+			text[i] = '\n';
+	}
+
+	// Every alignment and length, so we cover the vector loops and the tails
+	for (std::size_t first = 0; first < 70; ++first) {
+		for (std::size_t last = first; last < text.size(); last += 1 + std::rand() % 7) {
+			const char* f = text.data() + first;
+			const char* l = text.data() + last;
+			assert(find_byte(f, l, '\n') == std::find(f, l, '\n'));
+			assert(count_byte(f, l, '\n') == static_cast<std::size_t>(std::count(f, l, '\n')));
+			const char* p = l;
+			while (p != f && p[-1] != '\n')
+				--p;
+			assert(find_byte_backward(f, l, '\n') == p);
+		}
+	}
+
+	// More than 255 blocks in a row to overflow the byte counters
+	std::string newlines(100000, '\n');
+	assert(count_byte(newlines.data(), newlines.data() + newlines.size(), '\n') == newlines.size());
+	std::string empty(100000, 'x');
+	const char* end = empty.data() + empty.size();
+	assert(find_byte(empty.data(), end, '\n') == end);
+	assert(find_byte_backward(empty.data(), end, '\n') == empty.data());
+}
+
+static void check_segmented()
+{
+	Gap_buffer x;
+	x.insert(x.end(), 100, 'a');
+	x[10] = '\n';
+	x[60] = '\n';
+	x[90] = '\n';
+	// Move the gap into the middle
+	x.insert(x.begin() + 50, 1, 'b');
+
+	using I = Indexed_iterator<Gap_buffer>;
+	I first(x, 0);
+	I last(x, x.size());
+	assert(find(first, last, '\n').index == 10);
+	assert(find(I(x, 11), last, '\n').index == 61);
+	assert(find(I(x, 11), I(x, 61), '\n').index == 61);
+	assert(find_backward(first, last, '\n').index == 92);
+	assert(find_backward(first, I(x, 91), '\n').index == 62);
+	assert(find_backward(I(x, 11), I(x, 61), '\n').index == 11);
+	assert(count(first, last, '\n') == 3);
+	assert(count(I(x, 11), I(x, 91), '\n') == 1);
+}
+
+int main()
+{
+	Simd_level levels[] = { Simd_level::scalar, Simd_level::sse2, Simd_level::avx2 };
+	for (Simd_level level : levels) {
+		if (level > byte_search_supported())
+			continue;
+		byte_search_select(level);
+		assert(byte_search_level() == level);
+		check_kernels();
+		check_segmented();
+	}
+}
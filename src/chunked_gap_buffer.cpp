@@ -0,0 +1,221 @@
+#include "chunked_gap_buffer.h"
+#include "segmented_algorithm.h"
+#include <cassert>
+#include <algorithm>
+#include <string>
+
+/*
+ * Creates a block holding `text`, with room to grow to `block_size`
+ */
+static Gap_buffer make_block(std::string_view text)
+{
+	assert(text.size() <= Chunked_gap_buffer::block_size);
+	Gap_buffer block;
+	block.reserve(Chunked_gap_buffer::block_size);
+	block.insert(block.end(), text);
+	return block;
+}
+
+Chunked_gap_buffer::Chunked_gap_buffer(std::string_view text)
+{
+	for (size_type offset = 0; offset < text.size(); offset += block_size)
+		blocks.push_back(make_block(text.substr(offset, block_size)));
+	rebuild_sizes();
+}
+
+/*
+ * Returns the block containing `position` and replaces `position` with the
+ * offset into that block.  The end of the text belongs to the last block.
+ */
+Chunked_gap_buffer::size_type Chunked_gap_buffer::find_block(size_type& position) const
+{
+	assert(!blocks.empty());
+	size_type block = sizes.upper_bound(position);
+	if (block == blocks.size()) {
+		assert(position == 0);
+		--block;
+		position = blocks[block].size();
+	}
+	return block;
+}
+
+void Chunked_gap_buffer::rebuild_sizes()
+{
+	std::vector<size_type> counts;
+	counts.reserve(blocks.size());
+	for (const Gap_buffer& block : blocks)
+		counts.push_back(block.size());
+	sizes.assign(counts.begin(), counts.end());
+}
+
+/*
+ * Moves the text after `offset` in `block` into a new block following it,
+ * this moves at most `block_size` bytes.
+ */
+void Chunked_gap_buffer::split_block(size_type block, size_type offset)
+{
+	Gap_buffer& x = blocks[block];
+	if (offset == x.size())
+		return;
+
+	std::string tail(x.size() - offset, 0);
+	copy(x.begin() + offset, x.end(), tail.begin());
+	x.erase(x.begin() + offset, x.end());
+	blocks.insert(blocks.begin() + block + 1, make_block(tail));
+}
+
+void Chunked_gap_buffer::insert(iterator i, std::string_view text)
+{
+	size_type position = i.index;
+	assert(position <= size());
+	if (text.empty())
+		return;
+
+	cache_block = cache_begin = cache_end = 0;
+	if (blocks.empty()) {
+		blocks.push_back(make_block({}));
+		rebuild_sizes();
+	}
+
+	size_type offset = position;
+	size_type block = find_block(offset);
+	Gap_buffer& x = blocks[block];
+	if (x.size() + text.size() <= block_size) {
+		x.insert(x.begin() + offset, text);
+		sizes.add(block, text.size());
+		return;
+	}
+
+	// Split at the insertion point, top up the first half and put the rest
+	// of the text in new blocks
+	split_block(block, offset);
+	size_type room = std::min(block_size - blocks[block].size(), text.size());
+	Gap_buffer& head = blocks[block];
+	head.insert(head.end(), text.substr(0, room));
+	text.remove_prefix(room);
+
+	std::vector<Gap_buffer> new_blocks;
+	for (size_type i = 0; i < text.size(); i += block_size)
+		new_blocks.push_back(make_block(text.substr(i, block_size)));
+	blocks.insert(blocks.begin() + block + 1,
+		      std::make_move_iterator(new_blocks.begin()),
+		      std::make_move_iterator(new_blocks.end()));
+	rebuild_sizes();
+}
+
+Chunked_gap_buffer::size_type Chunked_gap_buffer::size() const
+{
+	return sizes.prefix_sum(sizes.size());
+}
+
+Chunked_gap_buffer::reference Chunked_gap_buffer::operator[](size_type i) const
+{
+	if (i < cache_begin || i >= cache_end) {
+		size_type offset = i;
+		cache_block = find_block(offset);
+		cache_begin = i - offset;
+		cache_end = cache_begin + blocks[cache_block].size();
+	}
+	return blocks[cache_block][i - cache_begin];
+}
+
+Chunked_gap_buffer::size_type Chunked_gap_buffer::segment_count() const
+{
+	return 2 * blocks.size();
+}
+
+std::string_view Chunked_gap_buffer::segment(size_type k) const
+{
+	const Gap_buffer& block = blocks[k / 2];
+	if (k % 2 == 0)
+		return std::string_view(block.begin0(), block.end0() - block.begin0());
+	return std::string_view(block.begin1(), block.end1() - block.begin1());
+}
+
+std::shared_ptr<const void> Chunked_gap_buffer::share(std::vector<std::string_view>& segments)
+{
+	auto shared = std::make_shared<std::vector<std::shared_ptr<const void>>>();
+	shared->reserve(blocks.size());
+	for (Gap_buffer& block : blocks)
+		shared->push_back(block.share(segments));
+	return shared;
+}
+
+std::string_view Chunked_gap_buffer::segment_from(size_type i) const
+{
+	if (i == size())
+		return {};
+	size_type offset = i;
+	size_type block = find_block(offset);
+	return blocks[block].segment_from(offset);
+}
+
+std::string_view Chunked_gap_buffer::segment_to(size_type i) const
+{
+	if (i == 0)
+		return {};
+	size_type offset = i - 1;
+	size_type block = find_block(offset);
+	return blocks[block].segment_to(offset + 1);
+}
+
+Chunked_gap_buffer::iterator Chunked_gap_buffer::begin()
+{
+	return iterator(*this, 0);
+}
+
+Chunked_gap_buffer::iterator Chunked_gap_buffer::end()
+{
+	return iterator(*this, size());
+}
+
+void Chunked_gap_buffer::insert(iterator i, size_type n, char c)
+{
+	insert(i, std::string(n, c));
+}
+
+void Chunked_gap_buffer::insert(iterator i, const char* f, const char* l)
+{
+	insert(i, std::string_view(f, l - f));
+}
+
+void Chunked_gap_buffer::erase(iterator i, size_type n)
+{
+	assert(i.index + n <= size());
+	if (n == 0)
+		return;
+
+	cache_block = cache_begin = cache_end = 0;
+	size_type offset = i.index;
+	size_type block = find_block(offset);
+	bool emptied = false;
+	while (n > 0) {
+		Gap_buffer& x = blocks[block];
+		size_type m = std::min(n, x.size() - offset);
+		x.erase(x.begin() + offset, m);
+		sizes.add(block, 0 - m);
+		emptied = emptied || x.size() == 0;
+		n -= m;
+		offset = 0;
+		++block;
+	}
+
+	if (emptied) {
+		blocks.erase(std::remove_if(blocks.begin(), blocks.end(), [] (const Gap_buffer& x) -> bool {
+			return x.size() == 0;
+		}), blocks.end());
+		rebuild_sizes();
+	}
+}
+
+Chunked_gap_buffer::iterator Chunked_gap_buffer::erase(iterator f, iterator l)
+{
+	erase(f, l.index - f.index);
+	return f;
+}
+
+void Chunked_gap_buffer::replace(iterator f, iterator l, std::string_view text)
+{
+	erase(f, l);
+	insert(f, text);
+}
@@ -0,0 +1,81 @@
+#include "chunked_gap_buffer.h"
+#include <cassert>
+#include <cstdlib>
+#include <string>
+
+/*
+ * Checks the buffer holds `expected` through operator[], the numbered
+ * segments and by walking segment_from/segment_to.
+ */
+static void check(const Chunked_gap_buffer& x, const std::string& expected)
+{
+	assert(x.size() == expected.size());
+	for (std::size_t i = 0; i < expected.size(); ++i)
+		assert(x[i] == expected[i]);
+
+	std::string segments;
+	for (std::size_t k = 0; k < x.segment_count(); ++k) {
+		std::string_view segment = x.segment(k);
+		assert(segment.size() <= Chunked_gap_buffer::block_size);
+		segments.append(segment.data(), segment.size());
+	}
+	assert(segments == expected);
+
+	std::string forward;
+	for (std::size_t i = 0; i < x.size();) {
+		std::string_view segment = x.segment_from(i);
+		assert(!segment.empty());
+		forward.append(segment.data(), segment.size());
+		i += segment.size();
+	}
+	assert(forward == expected);
+
+	std::string backward;
+	for (std::size_t i = x.size(); i > 0;) {
+		std::string_view segment = x.segment_to(i);
+		assert(!segment.empty());
+		backward.insert(0, segment.data(), segment.size());
+		i -= segment.size();
+	}
+	assert(backward == expected);
+}
+
+int main()
+{
+	std::string expected(3 * Chunked_gap_buffer::block_size + 17, 'x');
+	Chunked_gap_buffer x(expected);
+	check(x, expected);
+
+	std::srand(1);
+	for (int i = 0; i < 20000; ++i) {
+		std::size_t position = std::rand() % (expected.size() + 1);
+		int action = std::rand() % 100;
+		if (action < 30 && position < expected.size()) {
+			std::size_t n = std::min<std::size_t>(std::rand() % 64, expected.size() - position);
+			x.erase(x.begin() + position, n);
+			expected.erase(position, n);
+		} else if (action < 32) {
+			// Larger than a block, goes through the bulk path
+			std::size_t n = Chunked_gap_buffer::block_size + std::rand() % Chunked_gap_buffer::block_size;
+			x.insert(x.begin() + position, n, 'y');
+			expected.insert(position, n, 'y');
+		} else if (action < 33) {
+			std::size_t n = std::min<std::size_t>(std::rand() % (4 * Chunked_gap_buffer::block_size), expected.size() - position);
+			x.erase(x.begin() + position, x.begin() + position + n);
+			expected.erase(position, n);
+		} else {
+			std::size_t n = 1 + std::rand() % 4;
+			char c = static_cast<char>('a' + std::rand() % 26);
+			x.insert(x.begin() + position, n, c);
+			expected.insert(position, n, c);
+		}
+	}
+	check(x, expected);
+
+	x.erase(x.begin(), x.end());
+	expected.clear();
+	check(x, expected);
+	x.insert(x.end(), 3, 'z');
+	expected.insert(0, 3, 'z');
+	check(x, expected);
+}
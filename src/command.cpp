@@ -1,162 +1,655 @@
 #include <cassert>
 #include <algorithm>
+#include <chrono>
 #include "command.h"
 #include "prompt.h"
 #include "display.h"
+#include "event_loop.h"
 #include "file.h"
+#include "latency.h"
 #include "utility.h"
+#include "segmented_algorithm.h"
+#include "regular_expression.h"
 #include "screen.h"
 
 struct Bind {
 	SHORT key;
 	Command_function cmd;
+	const char* name;
 };
 
+#define BIND(key, command) { static_cast<SHORT>(key), command, #command }
+
+static void (*command_trace)(const char* name, bool done) = nullptr;
+
+void command_set_trace(void (*trace)(const char* name, bool done))
+{
+	command_trace = trace;
+}
+
+/*
+ * While a file is loading, commands wait for the text they need themselves,
+ * see load_line and friends below.
+ */
+static void run_command(const Bind& bind, Editor_state& editor, const Key_input& input, bool& should_exit, int count)
+{
+	if (command_trace)
+		command_trace(bind.name, false);
+	bind.cmd(editor, input, should_exit, count);
+	if (command_trace)
+		command_trace(bind.name, true);
+}
+
+/*
+ * While more keys are waiting, typed ahead or pasted, a frame would be out of
+ * date before it was seen.  The display is refreshed once they have all been
+ * handled, or once it has gone max_frame_age without one so a long burst
+ * still shows how it is getting on.
+ */
+static const auto max_frame_age = std::chrono::milliseconds(50);
+static bool frame_stale = false;
+static std::chrono::steady_clock::time_point stale_since;
+
+static void refresh(View& view)
+{
+	latency_command_done();
+	if (input_pending()) {
+		auto now = std::chrono::steady_clock::now();
+		if (!frame_stale) {
+			frame_stale = true;
+			stale_since = now;
+		}
+		if (now - stale_since < max_frame_age) {
+			latency_frame_deferred();
+			return;
+		}
+	}
+	frame_stale = false;
+	if (command_trace)
+		command_trace("display_refresh", false);
+	display_refresh(view);
+	if (command_trace)
+		command_trace("display_refresh", true);
+}
+
 static Bind normal_binds[] = {
-	{ VkKeyScanA('h'), backward_char },
-	{ VkKeyScanA('b'), backward_word },
-	{ VkKeyScanA('j'), forward_line },
-	{ VkKeyScanA('k'), backward_line },
-	{ VkKeyScanA('l'), forward_char },
-	{ VkKeyScanA('w'), forward_word },
-	{ VkKeyScanA('i'), insert_before_cursor },
-	{ VkKeyScanA('I'), insert_before_line },
-	{ VkKeyScanA('a'), insert_after_cursor },
-	{ VkKeyScanA('A'), insert_after_line },
-	{ VkKeyScanA('o'), open_line_after },
-	{ VkKeyScanA('O'), open_line_before },
-	{ VkKeyScanA('d'), start_delete_mode },
-	{ VkKeyScanA('D'), delete_to_end_of_line },
-	{ VkKeyScanA('/'), search_forward },
-	{ VK_HOME, goto_beginning_of_line },
-	{ CONTROL | VK_HOME, goto_beginning_of_file },
-	{ VK_END, goto_end_of_line },
-	{ CONTROL | VK_END, goto_end_of_file },
-	{ CONTROL | VkKeyScanA('x'), ctrlx_command },
-	{ VkKeyScanA('0'), goto_beginning_of_line },
-	{ VkKeyScanA('$'), goto_end_of_line },
-	{ VkKeyScanA('S'), replace_line },
-	{ CONTROL | VkKeyScanA('e'), scroll_down },
-	{ CONTROL | VkKeyScanA('y'), scroll_up },
+	BIND(VkKeyScanA('h'), backward_char),
+	BIND(VkKeyScanA('b'), backward_word),
+	BIND(VkKeyScanA('j'), forward_line),
+	BIND(VkKeyScanA('k'), backward_line),
+	BIND(VkKeyScanA('G'), goto_line),
+	BIND(VkKeyScanA('l'), forward_char),
+	BIND(VkKeyScanA('w'), forward_word),
+	BIND(VkKeyScanA('i'), insert_before_cursor),
+	BIND(VkKeyScanA('I'), insert_before_line),
+	BIND(VkKeyScanA('a'), insert_after_cursor),
+	BIND(VkKeyScanA('A'), insert_after_line),
+	BIND(VkKeyScanA('o'), open_line_after),
+	BIND(VkKeyScanA('O'), open_line_before),
+	BIND(VkKeyScanA('d'), start_delete_mode),
+	BIND(VkKeyScanA('D'), delete_to_end_of_line),
+	BIND(VkKeyScanA('/'), search_forward),
+	BIND(VkKeyScanA('?'), search_backward),
+	BIND(VkKeyScanA('n'), search_next),
+	BIND(VkKeyScanA('N'), search_previous),
+	BIND(VK_HOME, goto_beginning_of_line),
+	BIND(CONTROL | VK_HOME, goto_beginning_of_file),
+	BIND(VK_END, goto_end_of_line),
+	BIND(CONTROL | VK_END, goto_end_of_file),
+	BIND(CONTROL | VkKeyScanA('x'), ctrlx_command),
+	BIND(VkKeyScanA('0'), goto_beginning_of_line),
+	BIND(VkKeyScanA('$'), goto_end_of_line),
+	BIND(VkKeyScanA('S'), replace_line),
+	BIND(CONTROL | VkKeyScanA('e'), scroll_down),
+	BIND(CONTROL | VkKeyScanA('y'), scroll_up),
+	BIND(VkKeyScanA('u'), undo),
+	BIND(CONTROL | VkKeyScanA('r'), redo),
+	BIND(KEY_PASTE_START, insert_paste),
 };
 
 static Bind ctrlx_binds[] = {
-	{ CONTROL | VkKeyScanA('s'), write_file },
-	{ CONTROL | VkKeyScanA('c'), quit },
-	{ CONTROL | VkKeyScanA('f'), find_file },
+	BIND(CONTROL | VkKeyScanA('s'), write_file),
+	BIND(CONTROL | VkKeyScanA('c'), quit),
+	BIND(CONTROL | VkKeyScanA('f'), find_file),
+	BIND(VkKeyScanA('b'), switch_buffer),
+	BIND(VkKeyScanA('k'), kill_buffer),
+	BIND(CONTROL | VkKeyScanA('l'), show_latency),
 };
 
-COMMAND_FUNCTION(ctrlx_command)
-{
-	Key_input new_input = wait_for_key();
-	auto iter = std::find_if(std::begin(ctrlx_binds), std::end(ctrlx_binds), [&new_input] (const Bind& bind) -> bool {
-		return bind.key == new_input.key;
-	});
-	if (iter != std::end(ctrlx_binds))
-		iter->cmd(editor, new_input, should_exit, 0);
-}
-
 static Bind insert_binds[] = {
-	{ VK_ESCAPE, leave_insert_mode },
-	{ CONTROL | VkKeyScanA('['), leave_insert_mode },
-	{ VK_RETURN, insert_newline },
-	{ VK_TAB, insert_tab },
-	{ CONTROL | VkKeyScanA('i'), insert_tab },
-	{ VK_BACK, backspace },
-	{ CONTROL | VkKeyScanA('t'), indent_line },
-	{ CONTROL | VkKeyScanA('d'), deindent_line },
+	BIND(VK_ESCAPE, leave_insert_mode),
+	BIND(CONTROL | VkKeyScanA('['), leave_insert_mode),
+	BIND(VK_RETURN, insert_newline),
+	BIND(VK_TAB, insert_tab),
+	BIND(CONTROL | VkKeyScanA('i'), insert_tab),
+	BIND(VK_BACK, backspace),
+	BIND(CONTROL | VkKeyScanA('t'), indent_line),
+	BIND(CONTROL | VkKeyScanA('d'), deindent_line),
+	BIND(KEY_PASTE_START, insert_paste),
 };
 
 static Bind delete_binds[] = {
-	{ VkKeyScanA('d'), delete_line },
+	BIND(VkKeyScanA('d'), delete_line),
 };
 
-bool evaluate(Editor_state& editor, Key_input input)
+/*
+ * Modes
+ *
+ * evaluate is handed one key at a time and never waits for the next, so a
+ * command that needs more keys leaves the editor in a mode the next key
+ * resumes: the rest of a count, the key after ^X or d, insert mode or a
+ * paste.  Prompts are a state of their own, in prompt.cpp.  A command lasts
+ * from its first key until the editor is back in normal mode with no prompt
+ * up, and its edits are undone together.
+ */
+enum class Mode {
+	normal,
+	count,		// the digits of a count, the command follows
+	prefix,		// one of prefix_first to prefix_last follows ^X or d
+	insert,
+	paste,		// between the bracketed paste markers
+};
+
+static Mode mode = Mode::normal;
+static int count_typed = 0;
+static const Bind* prefix_first;
+static const Bind* prefix_last;
+// The buffer the running command's history group was opened in, it may
+// switch buffers
+static Buffer* command_buffer = nullptr;
+
+static const Bind* find_bind(const Bind* first, const Bind* last, const Key_input& input)
 {
-	int count = 0;
-	if (input.ascii >= '1' && input.ascii <= '9') {
-		count = (input.ascii - '0');
-		while (true) {
-			input = wait_for_key();
-			if (input.ascii >= '0' && input.ascii <= '9') {
-				// TODO: guard against overflow
-				count *= 10;
-				count += (input.ascii - '0');
-			} else {
-				break;
-			}
-		}
+	const Bind* bind = std::find_if(first, last, [&input] (const Bind& x) -> bool {
+		return x.key == input.key;
+	});
+	return bind == last ? nullptr : bind;
+}
+
+static void start_prefix(const Bind* first, const Bind* last)
+{
+	prefix_first = first;
+	prefix_last = last;
+	mode = Mode::prefix;
+}
+
+COMMAND_FUNCTION(ctrlx_command)
+{
+	start_prefix(std::begin(ctrlx_binds), std::end(ctrlx_binds));
+}
+
+COMMAND_FUNCTION(start_delete_mode)
+{
+	start_prefix(std::begin(delete_binds), std::end(delete_binds));
+}
+
+static void normal_key(Editor_state& editor, const Key_input& input, bool& should_exit)
+{
+	if (input.ascii >= (mode == Mode::count ? '0' : '1') && input.ascii <= '9') {
+		// TODO: guard against overflow
+		count_typed = count_typed * 10 + (input.ascii - '0');
+		mode = Mode::count;
+		return;
 	}
+	int count = count_typed;
+	count_typed = 0;
+	mode = Mode::normal;
 
-	auto iter = std::find_if(std::begin(normal_binds), std::end(normal_binds), [&input] (const Bind& bind) -> bool {
-		return bind.key == input.key;
-	});
+	const Bind* bind = find_bind(std::begin(normal_binds), std::end(normal_binds), input);
+	if (!bind)
+		return;
+	command_buffer = editor.view.buffer;
+	command_buffer->history.begin_group(editor.view.cursor.index);
+	run_command(*bind, editor, input, should_exit, count);
+}
+
+static void prefix_key(Editor_state& editor, const Key_input& input, bool& should_exit)
+{
+	mode = Mode::normal;
+	if (const Bind* bind = find_bind(prefix_first, prefix_last, input))
+		run_command(*bind, editor, input, should_exit, 0);
+}
+
+static void insert_key(Editor_state& editor, Key_input input, bool& should_exit);
+static void paste_key(Editor_state& editor, Key_input input);
+
+/*
+ * The history group is closed in the buffer it was opened in
+ */
+static void end_command(Editor_state& editor)
+{
+	Buffer* buffer = command_buffer;
+	command_buffer = nullptr;
+	if (editor.view.buffer == buffer)
+		buffer->history.end_group(editor.view.cursor.index);
+	else if (editor.buffers.contains(buffer))
+		buffer->history.end_group(editor.buffers.position(*buffer).cursor);
+}
+
+bool evaluate(Editor_state& editor, Key_input input)
+{
 	bool should_exit = false;
-	if (iter != std::end(normal_binds)) {
-		iter->cmd(editor, input, should_exit, count);
-		display_refresh(editor.view);
-	}
+	if (prompt_active())
+		prompt_key(editor, input, should_exit);
+	else if (mode == Mode::insert)
+		insert_key(editor, input, should_exit);
+	else if (mode == Mode::paste)
+		paste_key(editor, input);
+	else if (mode == Mode::prefix)
+		prefix_key(editor, input, should_exit);
+	else
+		normal_key(editor, input, should_exit);
+
+	if (command_buffer && !command_pending())
+		end_command(editor);
+	// Nothing changes on the screen until a count or prefix is complete,
+	// and a prompt draws itself
+	if (mode != Mode::count && mode != Mode::prefix && !prompt_active())
+		refresh(editor.view);
 	return should_exit;
 }
 
+bool command_pending()
+{
+	return mode != Mode::normal || prompt_active();
+}
+
 COMMAND_FUNCTION(none)
 {
 }
 
+static void save_buffer(Editor_state& editor);
+
+static void save_buffer_as(Editor_state& editor, const std::string& filename, bool&, int)
+{
+	if (filename.empty())
+		return;
+	editor.view.buffer->name = filename;
+	save_buffer(editor);
+}
+
 static void save_buffer(Editor_state& editor)
 {
-	if (editor.buffer.name.empty()) {
-		std::string filename = prompt("Write file: ");
-		if (filename.empty())
-			return;
-		editor.buffer.name = std::move(filename);
+	Buffer& buffer = *editor.view.buffer;
+	if (buffer.name.empty()) {
+		prompt("Write file: ", save_buffer_as);
+		return;
 	}
 
-	DWORD last_error = file_save(editor.buffer);
+	DWORD last_error = file_save(buffer, input_cancel_requested);
 	if (last_error == 0) {
-		set_status_line("Wrote file");
+		set_status_line("Writing file...");
+	} else if (last_error == ERROR_CANCELLED) {
+		set_status_line("Interrupted");
+	} else if (last_error == ERROR_BUSY) {
+		set_status_line("Still writing the previous file");
 	} else {
 		set_status_line("Error writing file");
 	}
 }
 
+bool report_saves(Editor_state& editor)
+{
+	std::string filename;
+	DWORD last_error;
+	if (!file_save_finished(filename, last_error))
+		return false;
+
+	if (last_error == 0) {
+		set_status_line("Wrote " + filename);
+	} else {
+		set_status_line("Error writing " + filename);
+		if (Buffer* buffer = editor.buffers.find(filename))
+			buffer->modified = true;
+	}
+	return true;
+}
+
+/*
+ * The buffer whose progress is on the status line, to say when it is done
+ */
+static const Buffer* load_reported = nullptr;
+
+bool report_loads(Editor_state& editor)
+{
+	Buffer& buffer = *editor.view.buffer;
+	bool grew = file_load_poll(buffer);
+	std::size_t loaded;
+	std::size_t size;
+	if (file_loading(buffer, loaded, size)) {
+		if (grew) {
+			set_status_line("Reading " + buffer.name + " " + std::to_string(loaded * 100 / size) + "%");
+			load_reported = &buffer;
+		}
+	} else if (load_reported == &buffer) {
+		set_status_line("Read " + buffer.name + ", " + std::to_string(buffer.line_count()) + " lines");
+		load_reported = nullptr;
+	}
+	return grew;
+}
+
 COMMAND_FUNCTION(write_file)
 {
 	save_buffer(editor);
 }
 
-COMMAND_FUNCTION(find_file)
+COMMAND_FUNCTION(undo)
+{
+	View& view = editor.view;
+	int n = std::max(count, 1);
+	while (n-- > 0) {
+		if (!view.buffer->undo(view.cursor)) {
+			set_status_line("Already at oldest change");
+			break;
+		}
+	}
+	view.column_desired = -1;
+}
+
+COMMAND_FUNCTION(redo)
+{
+	View& view = editor.view;
+	int n = std::max(count, 1);
+	while (n-- > 0) {
+		if (!view.buffer->redo(view.cursor)) {
+			set_status_line("Already at newest change");
+			break;
+		}
+	}
+	view.column_desired = -1;
+}
+
+COMMAND_FUNCTION(show_latency)
+{
+	set_status_line(latency_status());
+}
+
+/*
+ * Taking in the rest of a buffer still loading resumes once the keys waiting
+ * have been handled, its reader may have finished while it was hidden
+ */
+static void show_buffer(Editor_state& editor, Buffer& buffer)
+{
+	if (editor_show_buffer(editor, buffer) != 0)
+		set_status_line("Error reading " + buffer.name);
+	else if (buffer.load)
+		event_loop_background_ready();
+}
+
+/*
+ * A buffer already open is switched to as it was left, otherwise the file is
+ * read into a new buffer.  The empty buffer red starts with is replaced.
+ */
+static void find_file_named(Editor_state& editor, const std::string& filename, bool&, int)
 {
-	std::string filename = prompt("Find file: ");
 	if (filename.empty())
 		return;
 
-	if (editor.buffer.modified) {
-		User_response answer = prompt_yesno("Buffer modified. Leave anyway (y/n)? ");
-		if (answer != User_response::yes)
-			return;
+	if (Buffer* buffer = editor.buffers.find(filename)) {
+		show_buffer(editor, *buffer);
+		return;
 	}
 
-	DWORD last_error = file_open(filename.c_str(), editor.buffer);
+	Buffer opened;
+	DWORD last_error = file_open(filename, opened);
 	if (last_error != 0) {
 		set_status_line("Error reading file");
 		return;
 	}
 
-	assert(editor.view.buffer == &editor.buffer);
-	editor.view.cursor = editor.buffer.begin();
-	editor.view.top_line = editor.buffer.begin();
-	editor.view.first_column = 0;
-	editor.view.column_desired = 0;
+	Buffer* scratch = editor.view.buffer;
+	Buffer& buffer = editor.buffers.add(std::move(opened));
+	show_buffer(editor, buffer);
+	if (scratch->name.empty() && !scratch->modified && scratch->contents.size() == 0)
+		editor.buffers.remove(*scratch);
+}
+
+COMMAND_FUNCTION(find_file)
+{
+	prompt("Find file: ", find_file_named);
+}
+
+/*
+ * Switches to a buffer by name, an empty name switches back to the buffer
+ * shown before this one
+ */
+static void switch_buffer_named(Editor_state& editor, const std::string& name, bool&, int)
+{
+	Buffer* buffer = name.empty() ? editor.buffers.alternate(*editor.view.buffer) : editor.buffers.find(name);
+	if (!buffer) {
+		set_status_line(name.empty() ? "No other buffer" : "No buffer named " + name);
+		return;
+	}
+	show_buffer(editor, *buffer);
+}
+
+COMMAND_FUNCTION(switch_buffer)
+{
+	Buffer* alternate = editor.buffers.alternate(*editor.view.buffer);
+	std::string message = "Switch to buffer";
+	if (alternate)
+		message += " (default " + (alternate->name.empty() ? std::string("*scratch*") : alternate->name) + ")";
+	prompt(message + ": ", switch_buffer_named);
+}
+
+/*
+ * Closes the buffer being shown and switches to the one shown before it, the
+ * last buffer is replaced with an empty one
+ */
+static void kill_shown_buffer(Editor_state& editor)
+{
+	Buffer* buffer = editor.view.buffer;
+	Buffer* alternate = editor.buffers.alternate(*buffer);
+	if (!alternate)
+		alternate = &editor.buffers.add(Buffer());
+	show_buffer(editor, *alternate);
+	if (editor.view.buffer == alternate)
+		editor.buffers.remove(*buffer);
+}
+
+static void kill_buffer_answered(Editor_state& editor, User_response answer, bool&)
+{
+	if (answer == User_response::yes)
+		kill_shown_buffer(editor);
+}
+
+COMMAND_FUNCTION(kill_buffer)
+{
+	if (editor.view.buffer->modified)
+		prompt_yesno("Buffer modified. Kill anyway (y/n)? ", kill_buffer_answered);
+	else
+		kill_shown_buffer(editor);
+}
+
+/*
+ * Wait for the rest of the file, for `count` lines or for the end of the
+ * line holding the cursor unless ^G is pressed, then say so.  A command
+ * only waits for the text it reaches: one working at or past the end of the
+ * cursor's line waits for that, motions that stay within what has been read
+ * don't wait at all.
+ */
+static bool interrupted()
+{
+	set_status_line("Interrupted");
+	return false;
+}
+
+static bool load_all(Buffer& buffer)
+{
+	return file_load_finish(buffer, input_cancel_requested) || interrupted();
+}
+
+static bool load_lines(Buffer& buffer, Buffer::size_type count)
+{
+	return file_load_lines(buffer, count, input_cancel_requested) || interrupted();
+}
+
+static bool load_line(View& view)
+{
+	return file_load_line_end(*view.buffer, view.cursor.index, input_cancel_requested) || interrupted();
+}
+
+/*
+ * The last search, compiled once and repeated by n and N
+ */
+static Regex last_search;
+static bool last_search_forward = true;
+
+/*
+ * How much text is searched between checks for ^G
+ */
+static const Buffer::size_type search_window = 16 * 1024 * 1024;
+
+/*
+ * find_regex from `from` to the end of the buffer, a window at a time so ^G
+ * can cancel it, which sets `cancelled`.  The matches of a pattern that
+ * can't match a line break lie within lines, so windows ending at a line
+ * break find the same ones.  Other patterns are searched in one go.
+ */
+static Regex_status find_regex_cancellable(Buffer& buffer, Buffer::iterator from, Buffer::iterator& match, bool& cancelled)
+{
+	cancelled = false;
+	Buffer::iterator last = buffer.end();
+	if (last_search.matches_newline())
+		return find_regex(last_search, buffer.begin(), from, last, match);
+	while (true) {
+		Buffer::iterator window_end = last;
+		if (static_cast<Buffer::size_type>(last - from) > search_window)
+			window_end = find(from + search_window, last, '\n');
+		Regex_status status = find_regex(last_search, buffer.begin(), from, window_end, match);
+		if (status != Regex_status::no_match || window_end == last)
+			return status;
+		if (input_cancel_requested()) {
+			cancelled = true;
+			return Regex_status::no_match;
+		}
+		from = window_end;
+	}
+}
+
+/*
+ * find_regex_backward from `before` back to the start of the buffer, a window
+ * at a time like find_regex_cancellable.  Windows start at a line start, so
+ * the last match in one is the last before `before` unless there is none.
+ */
+static Regex_status find_regex_backward_cancellable(Buffer& buffer, Buffer::iterator before, Buffer::iterator& match, bool& cancelled)
+{
+	cancelled = false;
+	Buffer::iterator first = buffer.begin();
+	if (last_search.matches_newline())
+		return find_regex_backward(last_search, first, before, buffer.end(), match);
+	while (true) {
+		Buffer::iterator window_begin = first;
+		if (static_cast<Buffer::size_type>(before - first) > search_window)
+			window_begin = find_backward(first, before - search_window, '\n');
+		Regex_status status = find_regex_backward(last_search, window_begin, before, buffer.end(), match);
+		if (status != Regex_status::no_match || window_begin == first)
+			return status;
+		if (input_cancel_requested()) {
+			cancelled = true;
+			return Regex_status::no_match;
+		}
+		before = window_begin;
+	}
+}
+
+/*
+ * search_again
+ *
+ * Moves the cursor to the next match of the last search after it, or before
+ * it when `forward` is false, wrapping around the ends of the buffer.
+ */
+static void search_again(View& view, bool forward, int count)
+{
+	if (last_search.empty()) {
+		set_status_line("No previous search");
+		return;
+	}
+
+	Buffer& buffer = *view.buffer;
+	if (!load_all(buffer))
+		return;
+	bool wrapped = false;
+	for (int n = std::max(count, 1); n > 0; --n) {
+		Buffer::iterator cursor = view.cursor;
+		Buffer::iterator match;
+		Regex_status status;
+		bool cancelled = false;
+		if (forward) {
+			Buffer::iterator from = cursor == buffer.end() ? cursor : cursor + 1;
+			status = find_regex_cancellable(buffer, from, match, cancelled);
+			if (status == Regex_status::no_match && !cancelled) {
+				status = find_regex_cancellable(buffer, buffer.begin(), match, cancelled);
+				wrapped = true;
+			}
+		} else {
+			status = find_regex_backward_cancellable(buffer, cursor, match, cancelled);
+			if (status == Regex_status::no_match && !cancelled) {
+				status = find_regex_backward_cancellable(buffer, buffer.end(), match, cancelled);
+				wrapped = true;
+			}
+		}
+
+		if (cancelled) {
+			set_status_line("Interrupted");
+			return;
+		}
+		if (status == Regex_status::too_complex) {
+			set_status_line("Search abandoned, the pattern is too complex for this text");
+			return;
+		}
+		if (status == Regex_status::no_match) {
+			set_status_line("Pattern not found: " + std::string(last_search.pattern()));
+			return;
+		}
+		view.cursor = match;
+	}
+	view.column_desired = -1;
+	if (wrapped)
+		set_status_line(forward ? "search hit BOTTOM, continuing at TOP" : "search hit TOP, continuing at BOTTOM");
+}
+
+static void search_for(View& view, const std::string& query, bool forward, int count)
+{
+	if (query.empty())
+		return;
+	std::string error;
+	if (!compile_regex(query, last_search, error)) {
+		set_status_line("Invalid pattern: " + error);
+		return;
+	}
+	last_search_forward = forward;
+	search_again(view, forward, count);
+}
+
+static void search_forward_for(Editor_state& editor, const std::string& query, bool&, int count)
+{
+	search_for(editor.view, query, true, count);
+}
+
+static void search_backward_for(Editor_state& editor, const std::string& query, bool&, int count)
+{
+	search_for(editor.view, query, false, count);
 }
 
 COMMAND_FUNCTION(search_forward)
 {
-	std::string query = prompt("Search forward: ");
-	View& view = editor.view;
-	auto iter = std::search(view.cursor, view.buffer->end(), query.begin(), query.end());
-	if (iter != view.buffer->end())
-		view.cursor = iter;
+	prompt("Search forward: ", search_forward_for, count);
+}
+
+COMMAND_FUNCTION(search_backward)
+{
+	prompt("Search backward: ", search_backward_for, count);
+}
+
+COMMAND_FUNCTION(search_next)
+{
+	search_again(editor.view, last_search_forward, count);
+}
+
+COMMAND_FUNCTION(search_previous)
+{
+	search_again(editor.view, !last_search_forward, count);
 }
 
 COMMAND_FUNCTION(forward_char)
@@ -226,71 +719,47 @@ COMMAND_FUNCTION(backward_word)
 	view.column_desired = -1;
 }
 
-/*
- * get_column
- *
- * Finds the 0-based value of the column of the line that `last` points to.
- * `first` could point to the beginning of the buffer to prevent going out of
- * range.  When counting the column we take into consideration tabs, a tab
- * character rounds the column to the next multiple of 8. Other characters in
- * the buffer are considered to have a width of 1.
- */
-static int get_column(Buffer::iterator first, Buffer::iterator last)
-{
-	first = find_backward(first, last, '\n');
-	int column = 0;
-	while (first != last) {
-		if (*first == '\t')
-			column += 8 - (column & 0x7);
-		else
-			++column;
-		++first;
-	}
-	return column;
-}
-
-/*
- * set_column
- *
- * Returns the iterator that would point to the desired `column` on the given
- * line starting at `first`. We need want to make sure that we find the column
- * for the current line and that we don't go out bounds. Similar to
- * `get_column` tabs round to the next multiple of 8, and other characters have
- * a width of 1.
- */
-static Buffer::iterator set_column(Buffer::iterator first, Buffer::iterator last, int column)
-{
-	int current = 0;
-	while (first != last && *first != '\n' && current < column) {
-		if (*first == '\t')
-			current += 8 - (current & 0x7);
-		else
-			++current;
-		++first;
-	}
-	return first;
-}
-
 COMMAND_FUNCTION(forward_line)
 {
 	View& view = editor.view;
 	if (view.column_desired == -1)
-		view.column_desired = get_column(view.buffer->begin(), view.cursor);
-	Buffer::iterator end_of_line = std::find(view.cursor, view.buffer->end(), '\n');
-	if (end_of_line != view.buffer->end())
-		view.cursor = set_column(std::next(end_of_line), view.buffer->end(), view.column_desired);
+		view.column_desired = view.buffer->column(view.cursor);
+	Buffer::size_type line = view.buffer->line_number(view.cursor);
+	if (!load_lines(*view.buffer, line + 2))
+		return;
+	if (line + 1 < view.buffer->line_count())
+		view.cursor = view.buffer->column_position(view.buffer->line_begin(line + 1), view.column_desired);
 }
 
 COMMAND_FUNCTION(backward_line)
 {
 	View& view = editor.view;
 	if (view.column_desired == -1)
-		view.column_desired = get_column(view.buffer->begin(), view.cursor);
-	view.cursor = find_backward(view.buffer->begin(), view.cursor, '\n');
-	if (view.cursor != view.buffer->begin()) {
-		Buffer::iterator start_of_line = find_backward(view.buffer->begin(), std::prev(view.cursor), '\n');
-		view.cursor = set_column(start_of_line, view.buffer->end(), view.column_desired);
-	}
+		view.column_desired = view.buffer->column(view.cursor);
+	Buffer::size_type line = view.buffer->line_number(view.cursor);
+	if (line == 0)
+		view.cursor = view.buffer->begin();
+	else
+		view.cursor = view.buffer->column_position(view.buffer->line_begin(line - 1), view.column_desired);
+}
+
+/*
+ * goto_line (similar to Vim's G command)
+ *
+ * Moves the cursor to the beginning of the line given by the count, lines are
+ * numbered from 1. Without a count, or with a count past the end of the
+ * buffer, we move to the last line.
+ */
+COMMAND_FUNCTION(goto_line)
+{
+	View& view = editor.view;
+	if (count > 0 ? !load_lines(*view.buffer, count) : !load_all(*view.buffer))
+		return;
+	Buffer::size_type line = view.buffer->line_count();
+	if (count > 0 && static_cast<Buffer::size_type>(count) < line)
+		line = count;
+	view.cursor = view.buffer->line_begin(line - 1);
+	view.column_desired = 0;
 }
 
 COMMAND_FUNCTION(goto_beginning_of_line)
@@ -310,22 +779,34 @@ COMMAND_FUNCTION(goto_beginning_of_file)
 COMMAND_FUNCTION(goto_end_of_line)
 {
 	View& view = editor.view;
-	view.cursor = std::find(view.cursor, view.buffer->end(), '\n');
-	view.column_desired = get_column(view.buffer->begin(), view.cursor);
+	if (!load_line(view))
+		return;
+	view.cursor = find(view.cursor, view.buffer->end(), '\n');
+	view.column_desired = view.buffer->column(view.cursor);
 }
 
 COMMAND_FUNCTION(goto_end_of_file)
 {
 	View& view = editor.view;
+	if (!load_all(*view.buffer))
+		return;
 	view.cursor = view.buffer->end();
-	view.column_desired = get_column(view.buffer->begin(), view.cursor);
+	view.column_desired = view.buffer->column(view.cursor);
+}
+
+static void quit_answered(Editor_state&, User_response answer, bool& should_exit)
+{
+	should_exit = answer == User_response::yes;
 }
 
 COMMAND_FUNCTION(quit)
 {
-	if (editor.buffer.modified) {
-		User_response answer = prompt_yesno("Buffer modified. Leave anyway (y/n)? ");
-		should_exit = answer == User_response::yes;
+	Buffer_list::size_type modified = editor.buffers.modified_count();
+	if (modified == 1 && editor.view.buffer->modified) {
+		prompt_yesno("Buffer modified. Leave anyway (y/n)? ", quit_answered);
+	} else if (modified > 0) {
+		std::string message = std::to_string(modified) + (modified == 1 ? " buffer" : " buffers");
+		prompt_yesno(message + " modified. Leave anyway (y/n)? ", quit_answered);
 	} else {
 		should_exit = true;
 	}
@@ -335,7 +816,7 @@ COMMAND_FUNCTION(insert_self)
 {
 	char character = input.ascii;
 	if (is_print(character)) {
-		editor.buffer.insert(editor.view.cursor, character);
+		editor.view.buffer->insert(editor.view.cursor, character);
 		++editor.view.cursor;
 	}
 }
@@ -344,20 +825,14 @@ COMMAND_FUNCTION(insert_newline)
 {
 	View& view = editor.view;
 	Buffer::iterator start_of_line = ::find_backward(view.buffer->begin(), view.cursor, '\n');
-	int tab_count = 0;
+	std::string text = "\n";
 	while (start_of_line != view.buffer->end() && *start_of_line == '\t') {
-		++tab_count;
+		text += '\t';
 		++start_of_line;
 	}
 
-	view.buffer->insert(view.cursor, '\n');
-	++editor.view.cursor;
-
-	while (tab_count) {
-		view.buffer->insert(view.cursor, '\t');
-		++view.cursor;
-		--tab_count;
-	}
+	view.buffer->insert(view.cursor, text);
+	view.cursor += text.size();
 }
 
 COMMAND_FUNCTION(backspace)
@@ -371,43 +846,150 @@ COMMAND_FUNCTION(backspace)
 
 COMMAND_FUNCTION(insert_tab)
 {
-	editor.buffer.insert(editor.view.cursor, '\t');
+	editor.view.buffer->insert(editor.view.cursor, '\t');
 	++editor.view.cursor;
 }
 
-static void insert_mode(Editor_state& editor, bool& should_exit)
+/*
+ * Text typed ahead or pasted is staged and inserted in one go, one edit and
+ * one move of the gap rather than one for every key
+ */
+static void insert_text(View& view, std::string_view text)
 {
-	set_status_line("--INSERT--");
-	screen_cursor_style(Cursor_style::underline);
-	display_refresh(editor.view);
+	if (text.empty())
+		return;
+	view.buffer->insert(view.cursor, text);
+	view.cursor += text.size();
+}
 
-	while (true) {
-		Key_input input = wait_for_key();
-		auto iter = std::find_if(std::begin(insert_binds), std::end(insert_binds), [&input] (const Bind& bind) -> bool {
-			return bind.key == input.key;
-		});
-		if (iter == std::end(insert_binds)) {
-			insert_self(editor, input, should_exit, 0);
-		} else if (iter->cmd == leave_insert_mode) {
-			iter->cmd(editor, input, should_exit, 0);
-			break;
-		} else {
-			iter->cmd(editor, input, should_exit, 0);
+/*
+ * Inserts the printable key `input` and the printable keys waiting after it.
+ * Returns true with the key that ended the run in `input`, or false if the
+ * run took every key waiting.
+ */
+static bool insert_run(Editor_state& editor, Key_input& input)
+{
+	std::string text(1, input.ascii);
+	Key_input key;
+	while (read_key(key)) {
+		if (!is_print(key.ascii)) {
+			insert_text(editor.view, text);
+			input = key;
+			return true;
+		}
+		text += key.ascii;
+	}
+	insert_text(editor.view, text);
+	return false;
+}
+
+/*
+ * Text between the bracketed paste markers goes in as it is: line breaks
+ * without the indent insert_newline adds, and control characters dropped
+ * rather than run.  It is staged as it arrives and while the rest is on its
+ * way what has arrived is inserted every max_frame_age, so a paste over a
+ * slow link shows as it comes.  ESC or ^G ends a paste whose end marker
+ * never comes, keeping what arrived.
+ */
+static std::string pasted;
+static bool pasted_carriage_return;
+static std::chrono::steady_clock::time_point paste_shown;
+// A paste may be made in normal or insert mode, and returns to it
+static Mode paste_from;
+// For show_paste, which runs from a timer
+static Editor_state* paste_editor = nullptr;
+
+COMMAND_FUNCTION(insert_paste)
+{
+	pasted.clear();
+	pasted_carriage_return = false;
+	paste_shown = std::chrono::steady_clock::now();
+	paste_from = mode;
+	paste_editor = &editor;
+	mode = Mode::paste;
+}
+
+static void insert_pasted(View& view)
+{
+	insert_text(view, pasted);
+	pasted.clear();
+	paste_shown = std::chrono::steady_clock::now();
+}
+
+/*
+ * Inserts what has been staged when no more has arrived for max_frame_age
+ */
+static void show_paste()
+{
+	if (mode != Mode::paste || pasted.empty())
+		return;
+	insert_pasted(paste_editor->view);
+	display_refresh(paste_editor->view);
+}
+
+static void paste_key(Editor_state& editor, Key_input input)
+{
+	View& view = editor.view;
+	do {
+		if (input.key == KEY_PASTE_END || input.key == VK_ESCAPE || is_cancel_key(input)) {
+			insert_pasted(view);
+			mode = paste_from;
+			return;
 		}
-		display_refresh(editor.view);
+		char c = input.ascii;
+		// A CR LF line break is one
+		if (c == '\r' || (c == '\n' && !pasted_carriage_return))
+			pasted += '\n';
+		else if (is_print(c) || c == '\t')
+			pasted += c;
+		pasted_carriage_return = c == '\r';
+	} while (read_key(input));
+
+	auto age = std::chrono::steady_clock::now() - paste_shown;
+	if (pasted.empty())
+		return;
+	if (age >= max_frame_age)
+		insert_pasted(view);
+	else
+		event_loop_set_timer(show_paste, static_cast<DWORD>(std::chrono::ceil<std::chrono::milliseconds>(max_frame_age - age).count()));
+}
+
+static const Bind insert_self_bind = BIND(0, insert_self);
+
+static void insert_mode(Editor_state&)
+{
+	set_status_line("--INSERT--");
+	display_cursor_style(Cursor_style::underline);
+	mode = Mode::insert;
+}
+
+static void insert_key(Editor_state& editor, Key_input input, bool& should_exit)
+{
+	// The end of what has been read isn't the end of the line, the text
+	// typed there goes after the rest of it
+	View& view = editor.view;
+	if (view.buffer->load && view.cursor == view.buffer->end() && !load_line(view))
+		return;
+	// A run of printable keys ends with the key read after it, which is
+	// handled in turn
+	while (is_print(input.ascii) && input_pending()) {
+		if (!insert_run(editor, input))
+			return;
 	}
+	const Bind* bind = find_bind(std::begin(insert_binds), std::end(insert_binds), input);
+	run_command(bind ? *bind : insert_self_bind, editor, input, should_exit, 0);
 }
 
 COMMAND_FUNCTION(insert_before_cursor)
 {
-	insert_mode(editor, should_exit);
+	insert_mode(editor);
 }
 
 COMMAND_FUNCTION(insert_before_line)
 {
 	View& view = editor.view;
 	view.cursor = find_backward(view.buffer->begin(), view.cursor, '\n');
-	insert_mode(editor, should_exit);
+	insert_mode(editor);
 }
 
 COMMAND_FUNCTION(insert_after_cursor)
@@ -415,54 +997,64 @@ COMMAND_FUNCTION(insert_after_cursor)
 	View& view = editor.view;
 	if (view.cursor != view.buffer->end())
 		++view.cursor;
-	insert_mode(editor, should_exit);
+	insert_mode(editor);
 }
 
 COMMAND_FUNCTION(insert_after_line)
 {
 	View& view = editor.view;
-	view.cursor = std::find(view.cursor, view.buffer->end(), '\n');
-	insert_mode(editor, should_exit);
+	if (!load_line(view))
+		return;
+	view.cursor = find(view.cursor, view.buffer->end(), '\n');
+	insert_mode(editor);
 }
 
 COMMAND_FUNCTION(leave_insert_mode)
 {
 	set_status_line("");
-	screen_cursor_style(Cursor_style::block);
+	display_cursor_style(Cursor_style::block);
 	editor.view.column_desired = -1;
+	mode = Mode::normal;
 }
 
 COMMAND_FUNCTION(open_line_after)
 {
 	View& view = editor.view;
-	view.cursor = std::find(view.cursor, view.buffer->end(), '\n');
-	editor.buffer.insert(view.cursor, '\n');
+	if (!load_line(view))
+		return;
+	view.cursor = find(view.cursor, view.buffer->end(), '\n');
+	view.buffer->insert(view.cursor, '\n');
 	++view.cursor;
-	insert_mode(editor, should_exit);
+	insert_mode(editor);
 }
 
 COMMAND_FUNCTION(open_line_before)
 {
 	View& view = editor.view;
 	view.cursor = find_backward(view.buffer->begin(), view.cursor, '\n');
-	editor.buffer.insert(view.cursor, '\n');
-	insert_mode(editor, should_exit);
+	view.buffer->insert(view.cursor, '\n');
+	insert_mode(editor);
 }
 
 COMMAND_FUNCTION(delete_to_end_of_line)
 {
 	View& view = editor.view;
-	Buffer::iterator line_end = std::find(view.cursor, view.buffer->end(), '\n');
+	if (!load_line(view))
+		return;
+	Buffer::iterator line_end = find(view.cursor, view.buffer->end(), '\n');
 	view.buffer->erase(view.cursor, line_end);
 }
 
 COMMAND_FUNCTION(delete_line)
 {
 	View& view = editor.view;
-	Buffer::iterator line_begin = find_backward(view.buffer->begin(), view.cursor, '\n');
-	Buffer::iterator line_end = std::find(view.cursor, view.buffer->end(), '\n');
-	if (line_end != view.buffer->end())
-		++line_end;
+	if (!load_line(view))
+		return;
+	Buffer::size_type line = view.buffer->line_number(view.cursor);
+	Buffer::iterator line_begin = view.buffer->line_begin(line);
+	Buffer::iterator line_end = view.buffer->end();
+	if (line + 1 < view.buffer->line_count())
+		line_end = view.buffer->line_begin(line + 1);
 	view.cursor = view.buffer->erase(line_begin, line_end);
 	assert(view.cursor == view.buffer->begin() || *(std::prev(view.cursor)) == '\n');
 	view.column_desired = 0;
@@ -471,11 +1063,13 @@ COMMAND_FUNCTION(delete_line)
 COMMAND_FUNCTION(replace_line)
 {
 	View& view = editor.view;
+	if (!load_line(view))
+		return;
 	Buffer::iterator line_begin = find_backward(view.buffer->begin(), view.cursor, '\n');
-	Buffer::iterator line_end = std::find(view.cursor, view.buffer->end(), '\n');
+	Buffer::iterator line_end = find(view.cursor, view.buffer->end(), '\n');
 	view.buffer->erase(line_begin, line_end);
 	view.cursor = line_begin;
-	insert_mode(editor, should_exit);
+	insert_mode(editor);
 }
 
 COMMAND_FUNCTION(indent_line)
@@ -498,82 +1092,50 @@ COMMAND_FUNCTION(deindent_line)
 	}
 }
 
-static void delete_mode(Editor_state& editor, bool& should_exit)
-{
-	Key_input input = wait_for_key();
-	auto iter = std::find_if(std::begin(delete_binds), std::end(delete_binds), [&input] (const Bind& bind) -> bool {
-		return bind.key == input.key;
-	});
-
-	if (iter != std::end(delete_binds)) {
-		iter->cmd(editor, input, should_exit, 0);
-	}
-}
-
-COMMAND_FUNCTION(start_delete_mode)
-{
-	delete_mode(editor, should_exit);
-}
-
 /*
  * scroll_down (similar to Vim command)
  *
- * We first count the number of lines between the line at the top of the screen
- * and the cursor position. We then attempt to move the top line forward by one
- * line, this might not be possible if we are on the last line of the file in
- * which case we don't need to do anything. Once we've advanced the top line we
- * then try to keep the cursor in the same position by moving n - 1 lines where
- * n is the number of lines we counted before.
+ * We attempt to move the top line forward by one line, this might not be
+ * possible if we are on the last line of the file in which case we don't need
+ * to do anything. Once we've advanced the top line the cursor stays on the
+ * same line, unless that line has scrolled off the screen in which case it
+ * moves to the new top line.
  */
 COMMAND_FUNCTION(scroll_down)
 {
-	using N = typename std::iterator_traits<Buffer::iterator>::difference_type;
-
 	View& view = editor.view;
-	N lines = std::count(view.top_line, view.cursor, '\n');
-	view.top_line = std::find(view.top_line, view.buffer->end(), '\n');
-	if (view.top_line == view.buffer->end())
+	Buffer::size_type top = view.buffer->line_number(view.top_line);
+	if (!load_lines(*view.buffer, top + 2))
 		return;
-	++view.top_line;
-	view.cursor = view.top_line;
-
-	for (N i = 0; i < lines - 1; ++i) {
-		view.cursor = std::find(view.cursor, view.buffer->end(), '\n');
-		if (view.cursor == view.buffer->end())
-			break;
-		++view.cursor;
-	}
+	if (top + 1 >= view.buffer->line_count())
+		return;
+	++top;
+	view.top_line = view.buffer->line_begin(top);
+	Buffer::size_type line = view.buffer->line_number(view.cursor);
+	view.cursor = view.buffer->line_begin(std::max(top, line));
 }
 
 /*
  * scroll_up (similar to Vim command)
  *
- * We count the number of lines between the line at the top of screen and the
- * cursor position. We then move the top line to the previous line, (might not
- * be possible if we are on the first line of the file). Once we've moved the
- * top line, we want to maintain the cursor position so we we'll try to move
- * the cursor n + 1 lines where n is the number of lines we counted earlier.
+ * We move the top line to the previous line, (might not be possible if we are
+ * on the first line of the file). Once we've moved the top line, we want to
+ * maintain the cursor position unless that would move the cursor off the
+ * bottom of the screen.
  */
 COMMAND_FUNCTION(scroll_up)
 {
-	using N = typename std::iterator_traits<Buffer::iterator>::difference_type;
+	using N = Buffer::size_type;
 
 	View& view = editor.view;
-	N lines = std::count(view.top_line, view.cursor, '\n');
-	view.top_line = ::find_backward(view.buffer->begin(), view.top_line, '\n');
-	if (view.top_line == view.buffer->begin())
+	N top = view.buffer->line_number(view.top_line);
+	if (top == 0)
 		return;
-	--view.top_line;
-	view.top_line = ::find_backward(view.buffer->begin(), view.top_line, '\n');
-	view.cursor = view.top_line;
+	--top;
+	view.top_line = view.buffer->line_begin(top);
 
 	// Make sure we stay on the screen
-	lines = std::min(static_cast<N>(view.height - 1), lines + 1);
-
-	for (N i = 0; i < lines; ++i) {
-		view.cursor = std::find(view.cursor, view.buffer->end(), '\n');
-		if (view.cursor == view.buffer->end())
-			break;
-		++view.cursor;
-	}
+	N lines = view.buffer->line_number(view.cursor) - top;
+	lines = std::min(static_cast<N>(view.height - 1), lines);
+	view.cursor = view.buffer->line_begin(top + lines);
 }
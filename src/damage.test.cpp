@@ -0,0 +1,77 @@
+#include "damage.h"
+#include <cassert>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+struct Span {
+	int row;
+	int column;
+	std::string text;
+};
+
+static std::vector<Span> damage(std::string_view previous, std::string_view next, int width)
+{
+	std::vector<Span> spans;
+	int n = for_each_damaged_span(previous, next, width, [&spans] (int row, int column, std::string_view text) {
+		spans.push_back({ row, column, std::string(text) });
+	});
+	assert(n == static_cast<int>(spans.size()));
+	return spans;
+}
+
+/*
+ * Applies the spans to previous, which must then equal next
+ */
+static void check_applies(std::string previous, std::string_view next, int width)
+{
+	for (const Span& span : damage(previous, next, width)) {
+		assert(span.column + static_cast<int>(span.text.size()) <= width);
+		previous.replace(span.row * width + span.column, span.text.size(), span.text);
+	}
+	assert(previous == next);
+}
+
+int main()
+{
+	const int width = 40;
+	std::string frame(width * 10, ' ');
+
+	// Nothing changed, only the cursor needs moving
+	assert(damage(frame, frame, width).empty());
+
+	// Typing a character sends one cell
+	std::string next = frame;
+	next[3 * width + 5] = 'a';
+	std::vector<Span> spans = damage(frame, next, width);
+	assert(spans.size() == 1);
+	assert(spans[0].row == 3 && spans[0].column == 5 && spans[0].text == "a");
+
+	// Nearby changes on a row are merged, distant ones are not
+	next = frame;
+	next[2] = 'x';
+	next[5] = 'y';
+	next[30] = 'z';
+	spans = damage(frame, next, width);
+	assert(spans.size() == 2);
+	assert(spans[0].column == 2 && spans[0].text == "x  y");
+	assert(spans[1].column == 30 && spans[1].text == "z");
+
+	// Changes at the ends of rows
+	next = frame;
+	next[0] = 'a';
+	next[width - 1] = 'b';
+	next[width] = 'c';
+	spans = damage(frame, next, width);
+	assert(spans.size() == 3);
+	assert(spans[1].row == 0 && spans[1].column == width - 1);
+	assert(spans[2].row == 1 && spans[2].column == 0);
+
+	for (int i = 0; i < 1000; ++i) {
+		next = frame;
+		for (int j = std::rand() % 20; j > 0; --j)
+			next[std::rand() % next.size()] = 'a' + std::rand() % 26;
+		check_applies(frame, next, width);
+		frame = next;
+	}
+}
@@ -1,85 +1,258 @@
 #include "display.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "damage.h"
+#include "display_width.h"
+#include "latency.h"
 #include "utility.h"
+#include "segmented_algorithm.h"
 #include "screen.h"
 
 static void reframe(View& view)
 {
-	Buffer::iterator cursor_line = find_backward(view.buffer->begin(), view.cursor, '\n');
-	if (cursor_line <= view.top_line) {
-		view.top_line = cursor_line;
-	} else {
-		int rows = 1;
-		Buffer::iterator line = cursor_line;
-		while (rows < view.height) {
-			line = find_backward(view.buffer->begin(), std::prev(line), '\n');
-			if (line == view.top_line)
-				goto done;
-			++rows;
+	Buffer::size_type line = view.buffer->line_number(view.cursor);
+	Buffer::size_type top = view.buffer->line_number(view.top_line);
+	if (line < top) {
+		top = line;
+	} else if (line - top >= static_cast<Buffer::size_type>(view.height)) {
+		top = line - view.height + 1;
+	}
+	view.top_line = view.buffer->line_begin(top);
+
+	int column = view.buffer->column(view.cursor);
+	if (column < view.first_column) {
+		view.first_column = column;
+	} else if (view.first_column + view.width <= column) {
+		view.first_column = column - view.width + 1;
+	}
+}
+
+/*
+ * The beginning of the line after `line`, which `i` is on.  The rest of a
+ * short line is stepped over, a long one is looked up in the line index.
+ */
+static Buffer::iterator next_line(Buffer& buffer, Buffer::iterator i, Buffer::size_type line)
+{
+	Buffer::iterator limit = buffer.end();
+	if (static_cast<Buffer::size_type>(limit - i) > Column_index::checkpoint_interval)
+		limit = i + Column_index::checkpoint_interval;
+	Buffer::iterator newline = find(i, limit, '\n');
+	if (newline != limit)
+		return std::next(newline);
+	return buffer.line_begin(line + 1);
+}
+
+/*
+ * Frame
+ *
+ * Everything on the screen: the rows of the view, the status line, where the
+ * cursor is and how it looks.  The editing thread builds one and publishes
+ * it, it is drawn by writing what changed since the frame drawn before.
+ */
+struct Frame {
+	int width = 0;
+	// The rows of the view one after another, width cells each
+	std::string cells;
+	int cursor_column = 0;
+	int cursor_row = 0;
+	std::string status;
+	int status_row = 0;
+	// A message or prompt leaves the cursor on the status line
+	bool cursor_on_status = false;
+	int status_column = 0;
+	Cursor_style cursor_style = Cursor_style::block;
+	// Everything is written, not only what changed
+	bool redraw = false;
+	// Set if the frame shows keys, the first of which arrived at `arrived`
+	bool timed = false;
+	Latency_mark arrived;
+};
+
+/*
+ * Frames are drawn at most this often on the drawing thread, those published
+ * in between are replaced by the newest
+ */
+static const auto frame_interval = std::chrono::microseconds(1000000 / 120);
+
+// The frame being built on the editing thread
+static Frame frame;
+
+// Handed from the editing thread to the drawing thread
+static std::mutex frame_mutex;
+static std::condition_variable frame_published;
+static Frame published;
+static bool frame_waiting = false;
+static bool stopping = false;
+static std::thread drawing_thread;
+
+// What is on the screen, only touched by whichever thread draws
+static std::string previous_cells;
+static int previous_width = -1;
+static std::string previous_status;
+static int previous_style = -1;
+
+static void draw(const Frame& f)
+{
+	Latency_mark start = latency_mark();
+	bool redraw = f.redraw || previous_width != f.width || previous_cells.size() != f.cells.size();
+	bool hidden = false;
+	auto hide_cursor = [&hidden] {
+		if (!hidden) {
+			screen_cursor_visible(false);
+			hidden = true;
 		}
+	};
 
-		do {
-			view.top_line  = std::find(view.top_line, view.buffer->end(), '\n');
-			++view.top_line;
-			if (view.top_line == line)
-				goto done;
-			--rows;
-		} while (rows > 0);
+	if (redraw) {
+		hide_cursor();
+		screen_cursor(0, 0);
+		screen_putstring(f.cells);
+	} else {
+		for_each_damaged_span(previous_cells, f.cells, f.width, [&hide_cursor] (int row, int column, std::string_view text) {
+			hide_cursor();
+			screen_cursor(column, row);
+			screen_putstring(text);
+		});
+	}
+	if (redraw || f.status != previous_status) {
+		hide_cursor();
+		screen_cursor(0, f.status_row);
+		screen_putstring(f.status);
+		screen_clear_end_of_line();
+	}
+	if (static_cast<int>(f.cursor_style) != previous_style)
+		screen_cursor_style(f.cursor_style);
+
+	// When only the cursor moved this is all that is written, it is always
+	// placed as writing leaves it elsewhere
+	if (f.cursor_on_status)
+		screen_cursor(f.status_column, f.status_row);
+	else
+		screen_cursor(f.cursor_column, f.cursor_row);
+	if (hidden)
+		screen_cursor_visible(true);
+
+	screen_flush();
+	latency_record(Latency_phase::output, start);
+	if (f.timed)
+		latency_frame_painted(f.arrived);
 
-		view.top_line = cursor_line;
+	previous_cells = f.cells;
+	previous_width = f.width;
+	previous_status = f.status;
+	previous_style = static_cast<int>(f.cursor_style);
+}
+
+static void draw_frames()
+{
+	Frame drawing;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(frame_mutex);
+			frame_published.wait(lock, [] { return frame_waiting || stopping; });
+			if (stopping)
+				return;
+			std::swap(drawing, published);
+			frame_waiting = false;
+		}
+		auto start = std::chrono::steady_clock::now();
+		draw(drawing);
+		std::this_thread::sleep_until(start + frame_interval);
 	}
+}
 
-done:
-	int column = 0;
-	while (cursor_line != view.cursor) {
-		if (*view.cursor == '\t') {
-			column += 8 - (column & 0x7);
-		} else {
-			++column;
+/*
+ * Hands the frame to the drawing thread, or draws it here without one.  The
+ * editing thread only waits for the frame to be copied.
+ */
+static void publish()
+{
+	if (!drawing_thread.joinable()) {
+		draw(frame);
+	} else {
+		{
+			std::lock_guard<std::mutex> lock(frame_mutex);
+			// A frame replacing one not yet drawn also shows what that
+			// one did
+			bool timed = frame.timed;
+			Latency_mark arrived = frame.arrived;
+			bool redraw = frame.redraw;
+			if (frame_waiting) {
+				if (published.timed) {
+					timed = true;
+					arrived = published.arrived;
+				}
+				redraw = redraw || published.redraw;
+			}
+			published = frame;
+			published.timed = timed;
+			published.arrived = arrived;
+			published.redraw = redraw;
+			frame_waiting = true;
 		}
-		++cursor_line;
+		frame_published.notify_one();
 	}
-	if (column < view.first_column) {
-		view.first_column = column;
-	} else if (view.first_column + view.width <= column) {
-		view.first_column = column - view.width + 1;
+	frame.timed = false;
+	frame.redraw = false;
+}
+
+void display_start_thread()
+{
+	stopping = false;
+	drawing_thread = std::thread(draw_frames);
+}
+
+void display_stop_thread()
+{
+	if (!drawing_thread.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(frame_mutex);
+		stopping = true;
 	}
+	frame_published.notify_one();
+	drawing_thread.join();
 }
 
-static std::string display_state;
+void display_invalidate()
+{
+	frame.redraw = true;
+}
 
 void display_refresh(View& view)
 {
+	Latency_mark start = latency_mark();
 	reframe(view);
+	latency_record(Latency_phase::reframe, start);
 
-	display_state.clear();
-	display_state.resize(view.width * view.height, ' ');
+	start = latency_mark();
+	frame.width = view.width;
+	frame.cells.assign(view.width * view.height, ' ');
+	frame.cursor_on_status = false;
 
 	int cursor_row = 0;
 	int cursor_column = 0;
+	// Each row starts from its line, so long lines above aren't walked over,
+	// and at the first column shown, found from the nearest checkpoint
+	Buffer& buffer = *view.buffer;
+	Buffer::size_type line = buffer.line_number(view.top_line);
+	Buffer::size_type line_count = buffer.line_count();
+	Buffer::iterator begin = view.top_line;
+	for (int row = 0; row < view.height && line < line_count; ++row, ++line) {
+		int column;
+		Buffer::iterator cursor = buffer.column_position(begin, view.first_column, column);
 
-	Buffer::iterator cursor = view.top_line;
-	for (int row = 0; row < view.height; ++row) {
-		// advance to the correct column
-		int column = 0;
-		while (column < view.first_column) {
-			if (cursor == view.buffer->end())
-				break;
-			if (*cursor == '\n')
-				break;
-			if (*cursor == '\t')
-				column += 8 - (column & 0x7);
-			else
-				++column;
-			++cursor;
-		}
-
-		for (int width = 0; width < view.width;) {
+		// A tab straddling the first column shows as the spaces after it
+		for (int width = column - view.first_column; column >= view.first_column && width < view.width;) {
 			if (cursor == view.cursor) {
 				cursor_row = row;
 				cursor_column = width;
 			}
 
-			if (cursor == view.buffer->end())
+			if (cursor == buffer.end())
 				goto done;
 
 			char ch = *cursor;
@@ -87,39 +260,49 @@ void display_refresh(View& view)
 				break;
 
 			if (ch == '\t') {
-				int nspaces = 8 - (column & 0x7);
+				int nspaces = next_tab_stop(column) - column;
 				while (nspaces && width < view.width) {
-					display_state[row * view.width + width] = ' ';
+					frame.cells[row * view.width + width] = ' ';
 					--nspaces;
 					++width;
 					++column;
 				}
 			} else {
-				display_state[row * view.width + width] = ch;
+				frame.cells[row * view.width + width] = ch;
 				++column;
 				++width;
 			}
 			++cursor;
 		}
 
-		cursor = std::find(cursor, view.buffer->end(), '\n');
-		if (cursor != view.buffer->end())
-			++cursor;
+		if (line + 1 < line_count)
+			begin = next_line(buffer, cursor, line);
 	}
 
 done:
-	screen_cursor_visible(false);
-	screen_cursor(0, 0);
-	screen_putstring(display_state);
-	screen_cursor(cursor_column, cursor_row);
-	screen_cursor_visible(true);
+	latency_record(Latency_phase::frame, start);
+
+	frame.cursor_column = cursor_column;
+	frame.cursor_row = cursor_row;
+	frame.timed = latency_frame_built(frame.arrived);
+	publish();
 }
 
 void set_status_line(std::string_view str)
 {
-	Screen_dimension dimension = screen_dimension();
-	screen_cursor(0, dimension.height - 1);
-	screen_putstring(str);
-	screen_clear_end_of_line();
+	set_status_prompt(str, static_cast<int>(str.size()));
 }
 
+void set_status_prompt(std::string_view str, int column)
+{
+	frame.status.assign(str.data(), str.size());
+	frame.status_row = screen_dimension().height - 1;
+	frame.cursor_on_status = true;
+	frame.status_column = column;
+	publish();
+}
+
+void display_cursor_style(Cursor_style style)
+{
+	frame.cursor_style = style;
+}
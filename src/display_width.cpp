@@ -0,0 +1,193 @@
+#include "display_width.h"
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include "byte_search.h"
+
+using size_type = Column_index::size_type;
+
+static int current_tab_width = 8;
+
+int tab_width()
+{
+	return current_tab_width;
+}
+
+void set_tab_width(int width)
+{
+	assert(width > 0);
+	current_tab_width = width;
+}
+
+int advance_column(int column, std::string_view text)
+{
+	const char* first = text.data();
+	const char* last = first + text.size();
+	while (true) {
+		const char* tab = find_byte(first, last, '\t');
+		column += static_cast<int>(tab - first);
+		if (tab == last)
+			return column;
+		column = next_tab_stop(column);
+		first = tab + 1;
+	}
+}
+
+/*
+ * The column after [first, last) starting from `column`, the range must not
+ * hold a newline.
+ */
+static int measure(const Text_storage& text, size_type first, size_type last, int column)
+{
+	while (first < last) {
+		std::string_view segment = text.segment_from(first);
+		size_type n = std::min(segment.size(), last - first);
+		column = advance_column(column, segment.substr(0, n));
+		first += n;
+	}
+	return column;
+}
+
+/*
+ * Moves `position` along its line until `column` reaches `target`, the line
+ * ends or `limit` is reached, and returns where it stopped.  Every byte is
+ * at least one column, so no more than target - column bytes are looked at.
+ */
+static size_type scan(const Text_storage& text, size_type position, size_type limit, int& column, int target)
+{
+	while (position < limit && column < target) {
+		std::string_view segment = text.segment_from(position);
+		size_type n = std::min({ segment.size(), limit - position, static_cast<size_type>(target - column) });
+		const char* first = segment.data();
+		const char* last = first + n;
+		const char* line_end = find_byte(first, last, '\n');
+		while (first != line_end && column < target) {
+			const char* tab = find_byte(first, line_end, '\t');
+			if (tab - first >= target - column) {
+				first += target - column;
+				column = target;
+				break;
+			}
+			column += static_cast<int>(tab - first);
+			first = tab;
+			if (first != line_end) {
+				column = next_tab_stop(column);
+				++first;
+			}
+		}
+		position += first - segment.data();
+		if (first == line_end && line_end != last)
+			break;
+	}
+	return position;
+}
+
+Column_index::Line& Column_index::find_line(size_type begin)
+{
+	auto line = std::find_if(lines.begin(), lines.end(), [begin] (const Line& x) {
+		return x.begin == begin;
+	});
+	if (line == lines.end()) {
+		if (lines.size() == max_lines)
+			lines.erase(lines.begin());
+		lines.push_back(Line{ begin, tab_width(), {}, false });
+		return lines.back();
+	}
+	if (line->tab_width != tab_width()) {
+		line->tab_width = tab_width();
+		line->checkpoints.clear();
+		line->complete = false;
+	}
+	// The most recently used go last, the first is evicted
+	std::rotate(line, line + 1, lines.end());
+	return lines.back();
+}
+
+/*
+ * Adds the next checkpoint to `line`, returns false if it ends before then
+ */
+bool Column_index::extend(const Text_storage& text, Line& line)
+{
+	if (line.complete)
+		return false;
+	size_type from = line.begin + line.checkpoints.size() * checkpoint_interval;
+	size_type to = from + checkpoint_interval;
+	int column = line.checkpoints.empty() ? 0 : line.checkpoints.back();
+	if (to > text.size() || scan(text, from, to, column, INT_MAX) != to) {
+		line.complete = true;
+		return false;
+	}
+	line.checkpoints.push_back(column);
+	return true;
+}
+
+void Column_index::truncate(Line& line, size_type position)
+{
+	size_type keep = (position - line.begin) / checkpoint_interval;
+	if (keep < line.checkpoints.size())
+		line.checkpoints.resize(keep);
+	line.complete = false;
+}
+
+int Column_index::column(const Text_storage& text, size_type line, size_type position)
+{
+	size_type k = (position - line) / checkpoint_interval;
+	if (k == 0)
+		return measure(text, line, position, 0);
+
+	Line& x = find_line(line);
+	while (x.checkpoints.size() < k && extend(text, x)) {
+	}
+	k = std::min(k, x.checkpoints.size());
+	int column = k > 0 ? x.checkpoints[k - 1] : 0;
+	return measure(text, line + k * checkpoint_interval, position, column);
+}
+
+size_type Column_index::position(const Text_storage& text, size_type line, int column, int& reached)
+{
+	size_type from = line;
+	reached = 0;
+	// A column within the first interval is reached before the first checkpoint
+	if (column > static_cast<int>(checkpoint_interval)) {
+		Line& x = find_line(line);
+		while ((x.checkpoints.empty() || x.checkpoints.back() < column) && extend(text, x)) {
+		}
+		// The last checkpoint at or before the column
+		size_type k = std::upper_bound(x.checkpoints.begin(), x.checkpoints.end(), column) - x.checkpoints.begin();
+		if (k > 0) {
+			from = line + k * checkpoint_interval;
+			reached = x.checkpoints[k - 1];
+		}
+	}
+	return scan(text, from, text.size(), reached, column);
+}
+
+void Column_index::insert(size_type position, size_type n)
+{
+	for (Line& line : lines) {
+		if (line.begin > position)
+			line.begin += n;
+		else
+			truncate(line, position);
+	}
+}
+
+void Column_index::erase(size_type position, size_type n)
+{
+	// A line starting in or just after the erased text may now be part of
+	// the line before
+	lines.erase(std::remove_if(lines.begin(), lines.end(), [position, n] (const Line& line) {
+		return line.begin > position && line.begin <= position + n;
+	}), lines.end());
+	for (Line& line : lines) {
+		if (line.begin > position)
+			line.begin -= n;
+		else
+			truncate(line, position);
+	}
+}
+
+void Column_index::clear()
+{
+	lines.clear();
+}
@@ -0,0 +1,119 @@
+#include "display_width.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <string>
+
+static int expected_column(const std::string& text, std::size_t line, std::size_t position)
+{
+	int column = 0;
+	for (std::size_t i = line; i < position; ++i)
+		column = text[i] == '\t' ? next_tab_stop(column) : column + 1;
+	return column;
+}
+
+static std::size_t expected_position(const std::string& text, std::size_t line, int column, int& reached)
+{
+	std::size_t i = line;
+	reached = 0;
+	while (i < text.size() && text[i] != '\n' && reached < column) {
+		reached = text[i] == '\t' ? next_tab_stop(reached) : reached + 1;
+		++i;
+	}
+	return i;
+}
+
+/*
+ * Lines of up to a few checkpoints long, with runs of tabs and none
+ */
+static std::string random_text(std::size_t n)
+{
+	std::string text(n, 'x');
+	for (char& c : text) {
+		int r = std::rand() % 1000;
+		if (r < 3)
+			c = '\n';
+		else if (r < 60)
+			c = '\t';
+	}
+	return text;
+}
+
+static std::size_t line_begin(const std::string& text, std::size_t position)
+{
+	std::size_t newline = position == 0 ? std::string::npos : text.rfind('\n', position - 1);
+	return newline == std::string::npos ? 0 : newline + 1;
+}
+
+static void check(Column_index& index, const Text_storage& storage, const std::string& text)
+{
+	for (int k = 0; k < 50; ++k) {
+		std::size_t position = std::rand() % (text.size() + 1);
+		std::size_t line = line_begin(text, position);
+		assert(index.column(storage, line, position) == expected_column(text, line, position));
+
+		int column = std::rand() % 2 ? std::rand() % 100 : std::rand() % 40000;
+		int reached;
+		int expected_reached;
+		std::size_t found = index.position(storage, line, column, reached);
+		assert(found == expected_position(text, line, column, expected_reached));
+		assert(reached == expected_reached);
+	}
+}
+
+int main()
+{
+	assert(tab_width() == 8);
+	assert(advance_column(0, "ab\tc") == 9);
+	assert(advance_column(7, "\t") == 8);
+	assert(advance_column(8, "\t") == 16);
+	assert(advance_column(3, "") == 3);
+
+	std::string text = random_text(200000);
+	Text_storage storage;
+	storage.insert(storage.end(), std::string_view(text));
+	Column_index index;
+	check(index, storage, text);
+
+	// The checkpoints follow edits, before, within and across lines
+	for (int k = 0; k < 300; ++k) {
+		std::size_t position = std::rand() % (text.size() + 1);
+		if (std::rand() % 2 && position < text.size()) {
+			std::size_t n = std::min<std::size_t>(1 + std::rand() % 5000, text.size() - position);
+			storage.erase(storage.begin() + position, storage.begin() + position + n);
+			text.erase(position, n);
+			index.erase(position, n);
+		} else {
+			std::string inserted = random_text(1 + std::rand() % 5000);
+			storage.insert(storage.begin() + position, std::string_view(inserted));
+			text.insert(position, inserted);
+			index.insert(position, inserted.size());
+		}
+		check(index, storage, text);
+	}
+
+	// Changing the tab width drops the checkpoints measured with the old one
+	set_tab_width(4);
+	check(index, storage, text);
+	set_tab_width(8);
+	check(index, storage, text);
+
+	// One line many checkpoints long
+	std::string line = random_text(1 << 20);
+	for (char& c : line) {
+		if (c == '\n')
+			c = 'y';
+	}
+	Text_storage long_line;
+	long_line.insert(long_line.end(), std::string_view(line));
+	Column_index long_index;
+	for (int k = 0; k < 100; ++k) {
+		std::size_t position = std::rand() % (line.size() + 1);
+		assert(long_index.column(long_line, 0, position) == expected_column(line, 0, position));
+		int column = std::rand() % (2 << 20);
+		int reached;
+		int expected_reached;
+		assert(long_index.position(long_line, 0, column, reached) == expected_position(line, 0, column, expected_reached));
+		assert(reached == expected_reached);
+	}
+}
@@ -0,0 +1,47 @@
+#include "editor.h"
+#include "file.h"
+#include "screen.h"
+#include <algorithm>
+
+void editor_initialize(Editor_state& editor)
+{
+	Buffer& buffer = editor.buffers.add(Buffer());
+	editor.buffers.show(buffer);
+	editor.view.buffer = &buffer;
+	Screen_dimension size = screen_dimension();
+	editor.view.width = size.width;
+	editor.view.height = size.height - 1;
+	editor.view.cursor = buffer.begin();
+	editor.view.top_line = buffer.begin();
+	editor.view.first_column = 0;
+	editor.view.column_desired = 0;
+}
+
+DWORD editor_show_buffer(Editor_state& editor, Buffer& buffer)
+{
+	View& view = editor.view;
+	if (view.buffer != &buffer) {
+		Buffer_position& left = editor.buffers.position(*view.buffer);
+		left.cursor = view.cursor.index;
+		left.top_line = view.top_line.index;
+		left.first_column = view.first_column;
+		left.column_desired = view.column_desired;
+	}
+
+	DWORD last_error = editor.buffers.show(buffer);
+	if (last_error != 0)
+		return last_error;
+
+	// A file read back in is only partly there yet, and it may have changed
+	// on disk since the text was released
+	const Buffer_position& position = editor.buffers.position(buffer);
+	file_load_position(buffer, std::max(position.cursor, position.top_line));
+	Buffer::size_type size = buffer.contents.size();
+	view.buffer = &buffer;
+	view.cursor = buffer.begin() + std::min(position.cursor, size);
+	view.top_line = buffer.line_begin(buffer.line_number(buffer.begin() + std::min(position.top_line, size)));
+	view.first_column = position.first_column;
+	view.column_desired = position.column_desired;
+	editor.buffers.trim(&buffer);
+	return 0;
+}
@@ -0,0 +1,168 @@
+#include "event_loop.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+#include "command.h"
+#include "input.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <cassert>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+struct Timer {
+	void (*handler)();
+	Clock::time_point due;
+};
+
+/*
+ * The most keys handled before the background handler and timers get a
+ * turn, so a steady stream of keys doesn't hold them off
+ */
+static const int keys_per_turn = 256;
+
+static std::vector<Timer> timers;
+static void (*background_handler)() = nullptr;
+static std::atomic<bool> background_pending{false};
+
+#if defined(_WIN32)
+
+static HANDLE wakeup = nullptr;
+
+DWORD event_loop_initialize()
+{
+	// Auto-reset, a wait takes the wake-up it returns for
+	wakeup = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+	return wakeup ? 0 : GetLastError();
+}
+
+void event_loop_wake()
+{
+	if (wakeup)
+		SetEvent(wakeup);
+}
+
+bool event_loop_wait(DWORD timeout)
+{
+	return WaitForSingleObject(wakeup, timeout) == WAIT_OBJECT_0;
+}
+
+#else
+
+// Other threads write a byte to wakeup[1], the loop polls wakeup[0]
+static int wakeup[2] = { -1, -1 };
+
+DWORD event_loop_initialize()
+{
+	if (pipe(wakeup) != 0)
+		return errno;
+	// A full pipe already wakes the loop, and the loop drains it without
+	// waiting
+	fcntl(wakeup[0], F_SETFL, O_NONBLOCK);
+	fcntl(wakeup[1], F_SETFL, O_NONBLOCK);
+	return 0;
+}
+
+void event_loop_wake()
+{
+	if (wakeup[1] < 0)
+		return;
+	char byte = 0;
+	ssize_t written = write(wakeup[1], &byte, 1);
+	(void)written;
+}
+
+bool event_loop_wait(DWORD timeout)
+{
+	assert(wakeup[0] >= 0);
+	pollfd fd = { wakeup[0], POLLIN, 0 };
+	if (poll(&fd, 1, timeout == INFINITE ? -1 : static_cast<int>(timeout)) <= 0)
+		return false;
+	char drained[64];
+	while (read(wakeup[0], drained, sizeof(drained)) > 0) {
+	}
+	return true;
+}
+
+#endif
+
+void event_loop_set_background_handler(void (*handler)())
+{
+	background_handler = handler;
+}
+
+void event_loop_background_ready()
+{
+	background_pending = true;
+	event_loop_wake();
+}
+
+void event_loop_set_timer(void (*handler)(), DWORD delay)
+{
+	Clock::time_point due = Clock::now() + std::chrono::milliseconds(delay);
+	for (Timer& timer : timers) {
+		if (timer.handler == handler) {
+			timer.due = due;
+			return;
+		}
+	}
+	timers.push_back(Timer{ handler, due });
+}
+
+/*
+ * Runs the timers that are due, returns the milliseconds until the next
+ */
+static DWORD run_timers()
+{
+	// A handler may set timers, so the ones due are taken out first
+	Clock::time_point now = Clock::now();
+	std::vector<void (*)()> due;
+	for (std::size_t i = 0; i < timers.size();) {
+		if (timers[i].due <= now) {
+			due.push_back(timers[i].handler);
+			timers.erase(timers.begin() + i);
+		} else {
+			++i;
+		}
+	}
+	for (void (*handler)() : due)
+		handler();
+
+	if (timers.empty())
+		return INFINITE;
+	Clock::time_point next = timers[0].due;
+	for (const Timer& timer : timers)
+		next = std::min(next, timer.due);
+	auto wait = std::chrono::ceil<std::chrono::milliseconds>(next - Clock::now()).count();
+	return wait > 0 ? static_cast<DWORD>(wait) : 0;
+}
+
+void event_loop_run(Editor_state& editor)
+{
+	while (true) {
+		// Keys come first, but no more than keys_per_turn before the rest
+		Key_input key;
+		for (int n = 0; n < keys_per_turn && read_key(key); ++n) {
+			if (evaluate(editor, key))
+				return;
+		}
+		// The terminal has gone, and the keys it sent before have been
+		// handled
+		if (input_hung_up() && !input_pending())
+			return;
+		if (background_pending.exchange(false) && background_handler)
+			background_handler();
+		DWORD timeout = run_timers();
+		if (!input_pending() && !background_pending)
+			wait_for_input(timeout);
+	}
+}
@@ -1,85 +1,347 @@
 #include "file.h"
+#include "file_mapping.h"
+#include "segmented_algorithm.h"
+#include "snapshot.h"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
 
-DWORD file_open(std::string filename, Buffer& buffer)
+using size_type = File_mapping::size_type;
+
+/*
+ * Files up to this size are read before file_open returns, larger ones are
+ * read in chunks of load_chunk in the background.
+ */
+constexpr size_type load_threshold = 4 * 1024 * 1024;
+constexpr size_type load_chunk = 1024 * 1024;
+
+/*
+ * The most appended to a buffer in one poll, so keys are still handled
+ * promptly while a large file streams in.
+ */
+constexpr size_type append_limit = 32 * 1024 * 1024;
+
+/*
+ * File_load
+ *
+ * A file being read into a buffer.  The reader thread touches every page of
+ * the mapping, so the reads from disk happen off the main thread, and
+ * publishes how far it has got in `ready`.  The main thread appends the text
+ * that is ready to the buffer, which only it ever touches.
+ */
+struct File_load {
+	std::shared_ptr<const File_mapping> mapping;
+	size_type appended = 0;
+
+	std::mutex mutex;
+	std::condition_variable arrived;
+	size_type ready = 0;
+	bool cancelled = false;
+	std::thread reader;
+
+	~File_load();
+};
+
+File_load::~File_load()
 {
-	DWORD last_error = 0;
-	HANDLE file_handle = CreateFileA(filename.c_str(),
-					 GENERIC_READ | GENERIC_WRITE,
-					 FILE_SHARE_READ,
-					 NULL,
-					 OPEN_EXISTING,
-					 FILE_ATTRIBUTE_NORMAL,
-					 0);
-	if (file_handle != INVALID_HANDLE_VALUE) {
-		// TODO: Use GetFileSizeEx instead
-		DWORD file_size = GetFileSize(file_handle, NULL);
-		if (file_size != INVALID_FILE_SIZE) {
-			DWORD bytes_read;
-			Gap_buffer temp_buffer(std::size_t(file_size), 0);
-			// TODO: Check we read the correct number of bytes
-			if (ReadFile(file_handle, &temp_buffer[0], file_size, &bytes_read, NULL)) {
-				buffer = Buffer{std::move(filename), std::move(temp_buffer), false};
-			} else {
-				last_error = GetLastError();
-			}
-		} else {
-			last_error = GetLastError();
-		}
-		CloseHandle(file_handle);
-	} else {
-		last_error = GetLastError();
-		if (last_error == ERROR_FILE_NOT_FOUND) {
-			last_error = 0;
-			buffer = Buffer{std::move(filename), Gap_buffer{}, false};
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		cancelled = true;
+	}
+	if (reader.joinable())
+		reader.join();
+}
+
+// Called by the workers as they make progress, see file_set_notify
+static std::atomic<void (*)()> notify{nullptr};
+
+void file_set_notify(void (*f)())
+{
+	notify = f;
+}
+
+static void notify_editor()
+{
+	if (void (*f)() = notify.load())
+		f();
+}
+
+static void read_pages(File_load& load)
+{
+	const size_type page_size = 4096;
+	const char* data = load.mapping->data();
+	size_type size = load.mapping->size();
+	for (size_type offset = 0; offset < size;) {
+		size_type n = std::min(load_chunk, size - offset);
+		volatile char touched;
+		for (size_type i = 0; i < n; i += page_size)
+			touched = data[offset + i];
+		(void)touched;
+		offset += n;
+
+		{
+			std::lock_guard<std::mutex> lock(load.mutex);
+			if (load.cancelled)
+				return;
+			load.ready = offset;
+			load.arrived.notify_all();
 		}
+		notify_editor();
 	}
-	return last_error;
 }
 
 /*
- * Try to safely save the file by writing to a temporary file and if that succeeds
- * move the file.
+ * Prepares the storage used by Buffer to be appended the file to, and appends
+ * `n` bytes of it at `offset`.  Which storage that is is chosen the same way
+ * as Text_storage, see storage.h.
+ */
+#if defined(RED_PIECE_TABLE)
+
+static void start_contents(const std::shared_ptr<const File_mapping>& mapping, Piece_table& contents)
+{
+#if defined(_WIN32)
+	// Windows won't replace a file that is mapped, which file_save does, so
+	// the text is copied out and the mapping released once it is read
+	(void)mapping;
+	(void)contents;
+#else
+	// The original text stays in the mapping, only edits are copied
+	contents = Piece_table(std::shared_ptr<const char>(mapping, mapping->data()), 0);
+#endif
+}
+
+static void append_contents(const File_mapping& mapping, size_type offset, size_type n, Piece_table& contents)
+{
+#if defined(_WIN32)
+	contents.insert(contents.end(), std::string_view(mapping.data() + offset, n));
+#else
+	(void)mapping;
+	(void)offset;
+	contents.append_original(n);
+#endif
+}
+
+#elif defined(RED_CHUNKED_GAP_BUFFER)
+
+static void start_contents(const std::shared_ptr<const File_mapping>&, Chunked_gap_buffer&)
+{
+}
+
+static void append_contents(const File_mapping& mapping, size_type offset, size_type n, Chunked_gap_buffer& contents)
+{
+	contents.insert(contents.end(), std::string_view(mapping.data() + offset, n));
+}
+
+#else
+
+static void start_contents(const std::shared_ptr<const File_mapping>& mapping, Gap_buffer& contents)
+{
+	contents.reserve(mapping->size());
+}
+
+static void append_contents(const File_mapping& mapping, size_type offset, size_type n, Gap_buffer& contents)
+{
+	contents.insert(contents.end(), mapping.data() + offset, mapping.data() + offset + n);
+}
+
+#endif
+
+/*
+ * Appends the next `n` bytes of the file, they aren't an edit so they aren't
+ * recorded in the history and don't mark the buffer modified.  The load is
+ * dropped once the whole file is in.
  */
-DWORD file_save(Buffer& buffer)
+static void append(Buffer& buffer, size_type n)
 {
-	assert(!buffer.name.empty());
-	DWORD last_error = 0;
-	char temp_path[MAX_PATH];
-	DWORD length = GetTempPathA(MAX_PATH, temp_path);
-	if (length > 0 && length <= MAX_PATH) {
-		char temp_filename[MAX_PATH];
-		if (GetTempFileNameA(temp_path, "RED", 0, temp_filename) != 0) {
-			HANDLE temp_file_handle = CreateFileA(temp_filename,
-							      GENERIC_WRITE,
-							      0,
-							      NULL,
-							      CREATE_ALWAYS,
-							      FILE_ATTRIBUTE_NORMAL,
-							      NULL);
-			if (temp_file_handle != INVALID_HANDLE_VALUE) {
-				if (buffer.write_file(temp_file_handle)) {
-					CloseHandle(temp_file_handle);
-					if (MoveFileEx(temp_filename,
-						       buffer.name.c_str(),
-						       MOVEFILE_REPLACE_EXISTING | MOVEFILE_COPY_ALLOWED)) {
-					} else {
-						last_error = GetLastError();
-					}
-				} else {
-					last_error = GetLastError();
-					CloseHandle(temp_file_handle);
-				}
-			} else {
-				last_error = GetLastError();
-			}
-		} else {
-			last_error = GetLastError();
-		}
-	} else {
-		last_error = GetLastError();
+	File_load& load = *buffer.load;
+	size_type position = buffer.contents.size();
+	append_contents(*load.mapping, load.appended, n, buffer.contents);
+	buffer.lines.insert(buffer.contents, position, n);
+	buffer.columns.insert(position, n);
+	load.appended += n;
+	if (load.appended == load.mapping->size())
+		buffer.load.reset();
+}
+
+/*
+ * Appends everything the reader has ready, up to `limit` bytes, waiting for
+ * it if that is nothing
+ */
+static void load_more(Buffer& buffer, size_type limit = SIZE_MAX)
+{
+	File_load& load = *buffer.load;
+	size_type ready;
+	{
+		std::unique_lock<std::mutex> lock(load.mutex);
+		load.arrived.wait(lock, [&load] { return load.ready > load.appended; });
+		ready = load.ready;
+	}
+	append(buffer, std::min(ready - load.appended, limit));
+}
+
+DWORD file_open(std::string filename, Buffer& buffer)
+{
+	auto mapping = std::make_shared<File_mapping>();
+	DWORD last_error = mapping->open(filename);
+	if (last_error == ERROR_FILE_NOT_FOUND) {
+		buffer = Buffer{std::move(filename), Buffer::Buffer_storage{}};
+		return 0;
+	}
+	if (last_error != 0)
+		return last_error;
+
+	Buffer::Buffer_storage contents;
+	start_contents(mapping, contents);
+	buffer = Buffer{std::move(filename), std::move(contents)};
+	if (mapping->size() == 0)
+		return 0;
+
+	buffer.load = std::make_shared<File_load>();
+	File_load& load = *buffer.load;
+	load.mapping = std::move(mapping);
+	if (load.mapping->size() <= load_threshold) {
+		append(buffer, load.mapping->size());
+		return 0;
 	}
 
-	return last_error;
+	// Only the first chunk, however far the reader has got, the rest is
+	// taken in as the editor polls
+	load.reader = std::thread(read_pages, std::ref(load));
+	load_more(buffer, load_chunk);
+	return 0;
 }
 
+bool file_load_poll(Buffer& buffer)
+{
+	if (!buffer.load)
+		return false;
+	File_load& load = *buffer.load;
+	size_type ready;
+	{
+		std::lock_guard<std::mutex> lock(load.mutex);
+		ready = load.ready;
+	}
+	size_type n = std::min(ready - load.appended, append_limit);
+	if (n == 0)
+		return false;
+	append(buffer, n);
+	return true;
+}
+
+void file_load_finish(Buffer& buffer)
+{
+	while (buffer.load)
+		load_more(buffer);
+}
+
+void file_load_position(Buffer& buffer, Buffer::size_type position)
+{
+	while (buffer.load && buffer.contents.size() <= position)
+		load_more(buffer);
+}
+
+bool file_load_lines(Buffer& buffer, Buffer::size_type count, bool (*cancelled)())
+{
+	while (buffer.load && buffer.line_count() < count) {
+		if (cancelled())
+			return false;
+		load_more(buffer, append_limit);
+	}
+	return true;
+}
+
+bool file_load_line_end(Buffer& buffer, Buffer::size_type position, bool (*cancelled)())
+{
+	while (buffer.load) {
+		if (find(buffer.begin() + position, buffer.end(), '\n') != buffer.end())
+			return true;
+		if (cancelled())
+			return false;
+		position = buffer.contents.size();
+		load_more(buffer, append_limit);
+	}
+	return true;
+}
+
+bool file_load_finish(Buffer& buffer, bool (*cancelled)())
+{
+	while (buffer.load) {
+		if (cancelled())
+			return false;
+		load_more(buffer, append_limit);
+	}
+	return true;
+}
+
+bool file_loading(const Buffer& buffer, std::size_t& loaded, std::size_t& size)
+{
+	if (!buffer.load)
+		return false;
+	loaded = buffer.load->appended;
+	size = buffer.load->mapping->size();
+	return true;
+}
+
+// The result of the save running, and the worker writing it
+static std::future<unsigned long> pending_save;
+static std::future<void> save_worker;
+static std::string pending_filename;
+
+/*
+ * Takes a snapshot of the buffer, which shares its storage rather than
+ * copying it, and writes it out on a worker thread, the result is collected
+ * with file_save_finished.  Only one save runs at a time.
+ */
+DWORD file_save(Buffer& buffer, bool (*cancelled)())
+{
+	assert(!buffer.name.empty());
+	if (file_save_pending())
+		return ERROR_BUSY;
+
+	// Saving part of a file would truncate it
+	if (!file_load_finish(buffer, cancelled))
+		return ERROR_CANCELLED;
+
+	Snapshot snapshot(buffer.contents);
+	pending_filename = buffer.name;
+	// The result is ready before the editor is told, so it finds it
+	std::promise<unsigned long> result;
+	pending_save = result.get_future();
+	save_worker = std::async(std::launch::async, [snapshot = std::move(snapshot), filename = buffer.name, result = std::move(result)] () mutable {
+		unsigned long last_error = write_snapshot(snapshot, filename);
+		// Let go of the storage before the editor hears, so edits from then
+		// on don't copy it
+		snapshot = Snapshot();
+		result.set_value(last_error);
+		notify_editor();
+	});
+	buffer.modified = false;
+	return 0;
+}
+
+bool file_save_pending()
+{
+	return pending_save.valid() && pending_save.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+}
+
+bool file_save_finished(std::string& filename, DWORD& last_error)
+{
+	if (!pending_save.valid() || file_save_pending())
+		return false;
+	filename = std::move(pending_filename);
+	last_error = pending_save.get();
+	return true;
+}
+
+void file_save_wait()
+{
+	if (save_worker.valid())
+		save_worker.wait();
+}
@@ -0,0 +1,93 @@
+#include "file.h"
+#include "segmented_algorithm.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+static void write_file(const std::string& filename, const std::string& text)
+{
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	file.write(text.data(), text.size());
+}
+
+static std::string contents(Buffer& buffer)
+{
+	return std::string(buffer.begin(), buffer.end());
+}
+
+int main()
+{
+	const std::string filename = "file.test.txt";
+
+	Buffer buffer;
+	assert(file_open("file.test.missing", buffer) == 0);
+	assert(buffer.name == "file.test.missing" && buffer.contents.size() == 0 && !buffer.load);
+
+	// Small files are read before file_open returns
+	write_file(filename, "one\ntwo\n");
+	assert(file_open(filename, buffer) == 0);
+	assert(!buffer.load && contents(buffer) == "one\ntwo\n" && buffer.line_count() == 3);
+
+	std::string text;
+	for (int i = 0; text.size() < 24 * 1024 * 1024; ++i)
+		text += "line " + std::to_string(i) + "\n";
+	write_file(filename, text);
+
+	// The beginning is there at once, the rest streams in
+	assert(file_open(filename, buffer) == 0);
+	std::size_t loaded;
+	std::size_t size;
+	Buffer::size_type first = buffer.contents.size();
+	assert(first > 0 && first <= text.size());
+	if (file_loading(buffer, loaded, size))
+		assert(loaded == first && size == text.size());
+	assert(contents(buffer) == text.substr(0, first));
+	assert(buffer.load);
+	assert(!file_load_finish(buffer, [] { return true; }));
+	assert(!file_load_lines(buffer, 200000, [] { return true; }));
+	assert(!file_load_line_end(buffer, first, [] { return true; }));
+	assert(buffer.load && buffer.contents.size() == first);
+
+	// Edits made while loading stay where they were made
+	buffer.history.begin_group(0);
+	buffer.insert(buffer.begin(), std::string_view("edited\n"));
+	buffer.history.end_group(0);
+
+	assert(file_load_lines(buffer, 200000, [] { return false; }));
+	assert(buffer.line_count() >= 200000);
+	Buffer::size_type position = buffer.contents.size() - 1;
+	assert(file_load_line_end(buffer, position, [] { return false; }));
+	assert(find(buffer.begin() + position, buffer.end(), '\n') != buffer.end());
+	file_load_position(buffer, text.size() - 1);
+	assert(buffer.contents.size() > text.size() - 1);
+	file_load_finish(buffer);
+	assert(!buffer.load);
+	assert(!file_loading(buffer, loaded, size));
+	assert(contents(buffer) == "edited\n" + text);
+	assert(buffer.line_count() == 1 + 1 + static_cast<Buffer::size_type>(std::count(text.begin(), text.end(), '\n')));
+
+	// Loading isn't an edit
+	Buffer::iterator cursor = buffer.begin();
+	assert(buffer.undo(cursor));
+	assert(contents(buffer) == text);
+	assert(!buffer.undo(cursor));
+
+	// Closing a buffer stops the reader
+	assert(file_open(filename, buffer) == 0);
+	buffer = Buffer();
+	assert(!buffer.load);
+
+	// Polling appends what has been read without waiting
+	assert(file_open(filename, buffer) == 0);
+	while (buffer.load) {
+		if (!file_load_poll(buffer))
+			std::this_thread::yield();
+	}
+	assert(contents(buffer) == text);
+	assert(!buffer.modified);
+
+	std::remove(filename.c_str());
+}
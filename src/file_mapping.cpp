@@ -0,0 +1,129 @@
+#include "file_mapping.h"
+#include <utility>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+File_mapping::~File_mapping()
+{
+	unmap();
+}
+
+File_mapping::File_mapping(File_mapping&& x) noexcept :
+	view(std::exchange(x.view, nullptr)),
+	length(std::exchange(x.length, 0))
+{
+}
+
+File_mapping& File_mapping::operator=(File_mapping&& x) noexcept
+{
+	if (this != &x) {
+		unmap();
+		view = std::exchange(x.view, nullptr);
+		length = std::exchange(x.length, 0);
+	}
+	return *this;
+}
+
+const char* File_mapping::data() const
+{
+	return view;
+}
+
+File_mapping::size_type File_mapping::size() const
+{
+	return length;
+}
+
+#if defined(_WIN32)
+
+void File_mapping::unmap()
+{
+	if (view)
+		UnmapViewOfFile(view);
+	view = nullptr;
+	length = 0;
+}
+
+unsigned long File_mapping::open(const std::string& filename)
+{
+	unmap();
+	HANDLE file_handle = CreateFileA(filename.c_str(),
+					 GENERIC_READ,
+					 FILE_SHARE_READ,
+					 NULL,
+					 OPEN_EXISTING,
+					 FILE_ATTRIBUTE_NORMAL,
+					 0);
+	if (file_handle == INVALID_HANDLE_VALUE)
+		return GetLastError();
+
+	DWORD last_error = 0;
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file_handle, &file_size)) {
+		last_error = GetLastError();
+	} else if (static_cast<unsigned long long>(file_size.QuadPart) > static_cast<size_type>(-1)) {
+		last_error = ERROR_NOT_ENOUGH_MEMORY;
+	} else if (file_size.QuadPart > 0) {
+		// The view keeps the mapping alive once both handles are closed
+		HANDLE mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping_handle != NULL) {
+			view = static_cast<const char*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+			if (view)
+				length = static_cast<size_type>(file_size.QuadPart);
+			else
+				last_error = GetLastError();
+			CloseHandle(mapping_handle);
+		} else {
+			last_error = GetLastError();
+		}
+	}
+	CloseHandle(file_handle);
+	return last_error;
+}
+
+#else
+
+void File_mapping::unmap()
+{
+	if (view)
+		munmap(const_cast<char*>(view), length);
+	view = nullptr;
+	length = 0;
+}
+
+unsigned long File_mapping::open(const std::string& filename)
+{
+	unmap();
+	int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		return errno;
+
+	unsigned long last_error = 0;
+	struct stat status;
+	if (fstat(fd, &status) == -1) {
+		last_error = errno;
+	} else if (static_cast<unsigned long long>(status.st_size) > static_cast<size_type>(-1)) {
+		last_error = EFBIG;
+	} else if (status.st_size > 0) {
+		// The mapping holds its own reference to the file once fd is closed
+		void* address = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (address != MAP_FAILED) {
+			view = static_cast<const char*>(address);
+			length = static_cast<size_type>(status.st_size);
+		} else {
+			last_error = errno;
+		}
+	}
+	close(fd);
+	return last_error;
+}
+
+#endif
@@ -0,0 +1,61 @@
+#include "file_mapping.h"
+#include "piece_table.h"
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+
+static void write_file(const std::string& filename, const std::string& text)
+{
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	file.write(text.data(), text.size());
+}
+
+int main()
+{
+	const std::string filename = "file_mapping.test.txt";
+
+	File_mapping missing;
+	assert(missing.open("file_mapping.test.missing") != 0);
+	assert(missing.data() == nullptr && missing.size() == 0);
+
+	write_file(filename, "");
+	File_mapping empty;
+	assert(empty.open(filename) == 0);
+	assert(empty.size() == 0);
+
+	std::string text;
+	for (int i = 0; text.size() < 4 * 1024 * 1024; ++i)
+		text += "line " + std::to_string(i) + "\n";
+	write_file(filename, text);
+
+	auto mapping = std::make_shared<File_mapping>();
+	assert(mapping->open(filename) == 0);
+	assert(mapping->size() == text.size());
+	assert(std::string(mapping->data(), mapping->size()) == text);
+
+	// The piece table reads the original text straight from the mapping
+	const char* data = mapping->data();
+	Piece_table x(std::shared_ptr<const char>(mapping, data), mapping->size());
+	mapping.reset();
+	assert(x.segment_from(0).data() == data);
+	assert(x.segment_from(0).size() == text.size());
+
+	x.insert(x.begin() + 5, std::string_view("edited "));
+	x.erase(x.begin() + 100, 1000);
+	text.insert(5, "edited ");
+	text.erase(100, 1000);
+	std::string result;
+	for (std::size_t i = 0; i < x.size(); i += x.segment_from(i).size())
+		result += x.segment_from(i);
+	assert(result == text);
+
+	// Moving the mapping transfers the view
+	File_mapping y;
+	assert(y.open(filename) == 0);
+	File_mapping z = std::move(y);
+	assert(y.data() == nullptr && z.size() > 0);
+
+	std::remove(filename.c_str());
+}
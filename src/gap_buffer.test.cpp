@@ -1,5 +1,81 @@
 #include "gap_buffer.h"
 #include <cassert>
+#include <list>
+#include <memory>
+#include <string>
+
+static std::size_t allocations = 0;
+static std::size_t live_elements = 0;
+
+template <typename T>
+struct Counting_allocator {
+	using value_type = T;
+
+	Counting_allocator() = default;
+
+	template <typename U>
+	Counting_allocator(const Counting_allocator<U>&)
+	{
+	}
+
+	T* allocate(std::size_t n)
+	{
+		++allocations;
+		live_elements += n;
+		return std::allocator<T>().allocate(n);
+	}
+
+	void deallocate(T* p, std::size_t n)
+	{
+		live_elements -= n;
+		std::allocator<T>().deallocate(p, n);
+	}
+
+	friend bool operator==(const Counting_allocator&, const Counting_allocator&)
+	{
+		return true;
+	}
+
+	friend bool operator!=(const Counting_allocator&, const Counting_allocator&)
+	{
+		return false;
+	}
+};
+
+static void check_growth()
+{
+	using Counted_buffer = Basic_gap_buffer<char, Counting_allocator<char>>;
+	{
+		// Appending one byte at a time only reallocates O(log n) times
+		Counted_buffer x;
+		const std::size_t n = 4 * 1024 * 1024;
+		for (std::size_t i = 0; i < n; ++i)
+			x.insert(x.end(), 1, char('a' + i % 26));
+		assert(x.size() == n);
+		assert(allocations < 64);
+		assert(x[n - 1] == char('a' + (n - 1) % 26));
+
+		// A large erase gives the memory back
+		std::size_t capacity = x.capacity();
+		x.erase(x.begin() + 100, x.end());
+		assert(x.size() == 100 && x.capacity() < capacity / 4);
+		assert(x[99] == char('a' + 99 % 26));
+
+		x.shrink_to_fit();
+		assert(x.capacity() == x.size());
+		assert(live_elements == x.capacity());
+	}
+	assert(live_elements == 0);
+
+	Basic_gap_buffer<int> y;
+	int values[] = { 1, 2, 3, 5, 8 };
+	y.insert(y.end(), std::begin(values), std::end(values));
+	y.insert(y.begin() + 3, 1, 4);
+	Basic_gap_buffer<int> z = y;
+	assert(y == z && !(y < z));
+	z[5] = 7;
+	assert(z < y && y != z);
+}
 
 int main()
 {
@@ -97,4 +173,33 @@ int main()
 
 	assert((x.end() - 1) - (x.begin() + 1) == 6);
 	assert((x.begin() + 1) - (x.end() - 1) == -6);
+
+	// Range insert and replace
+	Gap_buffer y;
+	y.insert(y.end(), std::string_view("hello world"));
+	y.insert(y.begin() + 5, std::string_view(","));
+	std::list<char> chars = { '!', '!' };
+	y.insert(y.end(), chars.begin(), chars.end());
+	y.replace(y.begin() + 7, y.begin() + 12, std::string_view("there, a much longer replacement"));
+	y.replace(y.begin(), y.begin() + 5, std::string_view("oh"));
+	std::string result(y.begin(), y.end());
+	assert(result == "oh, there, a much longer replacement!!");
+	assert(y.size() == result.size());
+
+	// Typing at the gap of a shared buffer writes in place, editing
+	// anywhere else leaves the shared array to the snapshot
+	std::vector<std::string_view> segments;
+	std::shared_ptr<const void> snapshot = y.share(segments);
+	assert(segments.size() == 2 && std::string(segments[0]) + std::string(segments[1]) == result);
+	const char* shared = y.begin0();
+	y.insert(y.begin() + 2, std::string_view("h"));
+	y.erase(y.begin() + 3, 1);
+	assert(y.begin0() == shared);
+	y.insert(y.begin(), std::string_view("well, "));
+	assert(y.begin0() != shared);
+	assert(std::string(y.begin(), y.end()) == "well, ohh there, a much longer replacement!!");
+	assert(std::string(segments[0]) + std::string(segments[1]) == result);
+	snapshot.reset();
+
+	check_growth();
 }
@@ -0,0 +1,153 @@
+#include "headless.h"
+#include <algorithm>
+#include <string>
+
+static std::string cells;
+static Screen_dimension size;
+static int cursor_column;
+static int cursor_row;
+static std::size_t written;
+
+static DWORD cells_initialize()
+{
+	cells.assign(static_cast<std::size_t>(size.width) * size.height, ' ');
+	cursor_column = 0;
+	cursor_row = 0;
+	written = 0;
+	return 0;
+}
+
+static void cells_finalize()
+{
+}
+
+static Screen_dimension cells_dimension()
+{
+	return size;
+}
+
+/*
+ * Like the console, text wraps at the end of a row
+ */
+static void cells_putstring(std::string_view str)
+{
+	std::size_t position = static_cast<std::size_t>(cursor_row) * size.width + cursor_column;
+	if (position < cells.size()) {
+		std::size_t n = std::min(str.size(), cells.size() - position);
+		cells.replace(position, n, str.data(), n);
+		position += n;
+	}
+	position = std::min(position, cells.size() - 1);
+	cursor_row = static_cast<int>(position / size.width);
+	cursor_column = static_cast<int>(position % size.width);
+	written += str.size();
+}
+
+static void cells_cursor(int column, int row)
+{
+	cursor_column = std::clamp(column, 0, size.width - 1);
+	cursor_row = std::clamp(row, 0, size.height - 1);
+}
+
+static void cells_column(int column)
+{
+	cursor_column = std::clamp(column, 0, size.width - 1);
+}
+
+static void cells_clear_end_of_line()
+{
+	std::size_t position = static_cast<std::size_t>(cursor_row) * size.width + cursor_column;
+	cells.replace(position, size.width - cursor_column, size.width - cursor_column, ' ');
+}
+
+static void cells_cursor_style(Cursor_style)
+{
+}
+
+static void cells_cursor_visible(bool)
+{
+}
+
+static void cells_flush()
+{
+}
+
+static const Screen_backend headless_screen_backend = {
+	cells_initialize,
+	cells_finalize,
+	cells_dimension,
+	cells_putstring,
+	cells_cursor,
+	cells_column,
+	cells_clear_end_of_line,
+	cells_cursor_style,
+	cells_cursor_visible,
+	cells_flush,
+};
+
+const Screen_backend& headless_screen(int width, int height)
+{
+	size = Screen_dimension{ std::max(width, 1), std::max(height, 2) };
+	return headless_screen_backend;
+}
+
+std::string_view headless_screen_contents()
+{
+	return cells;
+}
+
+std::size_t headless_screen_written()
+{
+	return written;
+}
+
+static std::vector<Key_input> script;
+static std::size_t next_key;
+static bool script_typeahead;
+
+static DWORD script_initialize()
+{
+	return 0;
+}
+
+static void script_finalize()
+{
+}
+
+static std::size_t script_read_keys(Key_input* keys, std::size_t n, DWORD timeout)
+{
+	if (timeout == 0 && !script_typeahead)
+		return 0;
+	if (next_key == script.size()) {
+		if (timeout == 0)
+			return 0;
+		keys[0] = Key_input{ VK_ESCAPE, 27 };
+		return 1;
+	}
+	if (!script_typeahead)
+		n = 1;
+	n = std::min(n, script.size() - next_key);
+	std::copy_n(script.begin() + next_key, n, keys);
+	next_key += n;
+	return n;
+}
+
+static const Input_backend scripted_input_backend = {
+	script_initialize,
+	script_finalize,
+	script_read_keys,
+	false,
+};
+
+const Input_backend& scripted_input(std::vector<Key_input> keys, bool typeahead)
+{
+	script = std::move(keys);
+	next_key = 0;
+	script_typeahead = typeahead;
+	return scripted_input_backend;
+}
+
+bool scripted_input_finished()
+{
+	return next_key == script.size();
+}
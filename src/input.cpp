@@ -1,57 +1,166 @@
 #include "input.h"
-#include <Windows.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <thread>
+#include "event_loop.h"
+#include "latency.h"
+#include "ring_buffer.h"
 
-static HANDLE input_handle;
+struct Queued_key {
+	Key_input key;
+	// When it was read from the backend
+	Latency_mark arrived;
+};
 
-DWORD input_initialize()
+/*
+ * How often the reader thread checks whether it should stop
+ */
+static const DWORD reader_poll_interval = 100;
+
+static const Input_backend* backend = &terminal_input;
+
+// Keys read and not yet asked for, pushed by the reader thread, or by
+// the editing thread itself for a backend without one
+static Ring_buffer<Queued_key, 4096> keys;
+// How many of them are ^G
+static std::atomic<int> queued_cancels{0};
+
+static std::thread reader;
+static std::atomic<bool> stopping{false};
+// Set after the last keys have been queued
+static std::atomic<bool> hung_up{false};
+
+void input_set_backend(const Input_backend& input_backend)
+{
+	backend = &input_backend;
+	keys.clear();
+	queued_cancels = 0;
+	hung_up = false;
+}
+
+static void queue_keys(const Key_input* read, std::size_t n)
 {
-	DWORD last_error = 0;
-	input_handle = CreateFileA("CONIN$",
-				   GENERIC_READ | GENERIC_WRITE,
-				   FILE_SHARE_READ,
-				   NULL,
-				   OPEN_EXISTING,
-				   0,
-				   0);
-	if (input_handle != INVALID_HANDLE_VALUE) {
-		DWORD input_mode;
-		if (GetConsoleMode(input_handle, &input_mode)) {
-			DWORD cooked_flags = ENABLE_LINE_INPUT | ENABLE_ECHO_INPUT | ENABLE_PROCESSED_INPUT;
-			input_mode &= ~cooked_flags;
-			if (SetConsoleMode(input_handle, input_mode)) {
-			} else {
-				last_error = GetLastError();
-			}
-		} else {
-			last_error = GetLastError();
+	if (n == 0)
+		return;
+	Latency_mark arrived = latency_mark();
+	for (std::size_t i = 0; i < n; ++i) {
+		if (is_cancel_key(read[i]))
+			++queued_cancels;
+		// The editor is behind by a whole ring of keys, the terminal holds
+		// the rest until it catches up
+		while (!keys.push(Queued_key{ read[i], arrived })) {
+			if (stopping)
+				return;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
 		}
-	} else {
-		last_error = GetLastError();
 	}
+}
 
+static void read_on_thread()
+{
+	Key_input read[256];
+	while (!stopping) {
+		std::size_t n = backend->read_keys(read, std::size(read), reader_poll_interval);
+		if (n == input_closed) {
+			hung_up = true;
+			event_loop_wake();
+			return;
+		}
+		if (n > 0) {
+			queue_keys(read, n);
+			event_loop_wake();
+		}
+	}
+}
+
+DWORD input_initialize()
+{
+	DWORD last_error = backend->initialize();
+	if (last_error == 0 && backend->reader_thread) {
+		stopping = false;
+		reader = std::thread(read_on_thread);
+	}
 	return last_error;
 }
 
-Key_input wait_for_key()
+void input_finalize()
 {
-	INPUT_RECORD input;
-	DWORD read;
-	while (ReadConsoleInput(input_handle, &input, 1, &read)) {
-		if (input.EventType != KEY_EVENT)
-			continue;
-		const KEY_EVENT_RECORD& key_event = input.Event.KeyEvent;
-		if (!key_event.bKeyDown)
-			continue;
-
-		Key_input key_input;
-		key_input.key = key_event.wVirtualKeyCode;
-		key_input.key |= ((key_event.dwControlKeyState & SHIFT_PRESSED) != 0) << 8;
-		key_input.key |= ((key_event.dwControlKeyState & (LEFT_CTRL_PRESSED | RIGHT_CTRL_PRESSED)) != 0) << 9;
-		key_input.key |= ((key_event.dwControlKeyState & (LEFT_ALT_PRESSED | RIGHT_ALT_PRESSED)) != 0) << 10;
-		key_input.ascii = key_event.uChar.AsciiChar;
-		return key_input;
+	if (reader.joinable()) {
+		stopping = true;
+		reader.join();
 	}
-	// TODO: handle ReadConsoleInput failure
-	return {};
+	backend->finalize();
 }
 
+/*
+ * Waits up to `timeout` milliseconds for keys to be queued, returns false if
+ * none were.  Without a reader thread they are read from the backend here.
+ */
+static bool wait_for_keys(DWORD timeout)
+{
+	if (!backend->reader_thread) {
+		Key_input read[256];
+		std::size_t room = std::min(std::size(read), keys.capacity() - keys.size());
+		std::size_t n = room > 0 && !hung_up ? backend->read_keys(read, room, timeout) : 0;
+		if (n == input_closed) {
+			hung_up = true;
+			return false;
+		}
+		queue_keys(read, n);
+		return n > 0;
+	}
+	if (keys.empty())
+		event_loop_wait(timeout);
+	return !keys.empty();
+}
+
+bool input_pending()
+{
+	if (keys.empty() && !backend->reader_thread)
+		wait_for_keys(0);
+	return !keys.empty();
+}
+
+bool input_hung_up()
+{
+	return hung_up;
+}
+
+bool read_key(Key_input& key)
+{
+	Queued_key queued;
+	if (!input_pending() || !keys.pop(queued))
+		return false;
+	if (is_cancel_key(queued.key))
+		--queued_cancels;
+	latency_key_read(queued.arrived);
+	key = queued.key;
+	return true;
+}
+
+bool wait_for_input(DWORD timeout)
+{
+	return !keys.empty() || wait_for_keys(timeout);
+}
+
+Key_input wait_for_key()
+{
+	Key_input key;
+	while (!read_key(key))
+		wait_for_input(INFINITE);
+	return key;
+}
+
+bool is_cancel_key(const Key_input& key)
+{
+	return key.key == (CONTROL | VkKeyScanA('g'));
+}
+
+bool input_cancel_requested()
+{
+	if (!backend->reader_thread)
+		wait_for_keys(0);
+	return queued_cancels > 0;
+}
@@ -0,0 +1,138 @@
+#include "input.h"
+#include "terminal_keys.h"
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+/*
+ * How long to wait for the rest of an escape sequence before deciding the
+ * user pressed ESC on its own.
+ */
+static const int escape_timeout = 25;
+
+static termios original_mode;
+static bool raw_mode = false;
+// bytes read from the terminal that haven't been decoded yet
+static std::string pending;
+
+/*
+ * With bracketed paste on the terminal sends pasted text between ESC [ 200 ~
+ * and ESC [ 201 ~, so it can be told from typing and inserted as it is.
+ * Terminals without it ignore the request.
+ */
+static void set_bracketed_paste(bool on)
+{
+	const char* sequence = on ? "\x1b[?2004h" : "\x1b[?2004l";
+	ssize_t written = write(STDOUT_FILENO, sequence, std::strlen(sequence));
+	(void)written;
+}
+
+static DWORD initialize()
+{
+	if (tcgetattr(STDIN_FILENO, &original_mode) != 0)
+		return errno;
+
+	termios mode = original_mode;
+	mode.c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
+	mode.c_oflag &= ~OPOST;
+	mode.c_cflag |= CS8;
+	mode.c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);
+	mode.c_cc[VMIN] = 1;
+	mode.c_cc[VTIME] = 0;
+	if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &mode) != 0)
+		return errno;
+	raw_mode = true;
+	set_bracketed_paste(true);
+	return 0;
+}
+
+static void finalize()
+{
+	if (raw_mode) {
+		set_bracketed_paste(false);
+		tcsetattr(STDIN_FILENO, TCSAFLUSH, &original_mode);
+	}
+	raw_mode = false;
+}
+
+/*
+ * Reads whatever is available into pending, waiting up to `timeout`
+ * milliseconds.  Returns 1 if something was read, 0 on timeout and -1 if
+ * the terminal has gone.
+ */
+static int read_input(DWORD timeout)
+{
+	pollfd fd{ STDIN_FILENO, POLLIN, 0 };
+	int ready = poll(&fd, 1, timeout == INFINITE ? -1 : static_cast<int>(timeout));
+	if (ready < 0)
+		return errno == EINTR ? 0 : -1;
+	if (ready == 0)
+		return 0;
+
+	char buffer[4096];
+	ssize_t n = read(STDIN_FILENO, buffer, sizeof(buffer));
+	if (n < 0)
+		return errno == EINTR || errno == EAGAIN ? 0 : -1;
+	if (n == 0)
+		return -1;
+	pending.append(buffer, n);
+	return 1;
+}
+
+/*
+ * Decodes the keys at the start of pending into `keys`, up to `n`, and
+ * returns how many.  An escape sequence cut short is left for the rest of
+ * it to arrive unless `more` is false, then it decodes as ESC.
+ */
+static std::size_t decode_keys(Key_input* keys, std::size_t n, bool more)
+{
+	std::size_t count = 0;
+	std::size_t used = 0;
+	while (count < n && used < pending.size()) {
+		Key_input key;
+		std::size_t k = decode_terminal_key(std::string_view(pending).substr(used), more, key);
+		if (k == 0)
+			break;
+		used += k;
+		if (key.key != 0 || key.ascii != 0)
+			keys[count++] = key;
+	}
+	pending.erase(0, used);
+	return count;
+}
+
+static std::size_t read_keys(Key_input* keys, std::size_t n, DWORD timeout)
+{
+	while (true) {
+		std::size_t count = decode_keys(keys, n, true);
+		if (count > 0)
+			return count;
+
+		if (!pending.empty()) {
+			// The start of an escape sequence, or ESC on its own if no
+			// more of it comes
+			if (read_input(escape_timeout) > 0)
+				continue;
+			count = decode_keys(keys, n, false);
+			if (count > 0)
+				return count;
+			continue;
+		}
+
+		int status = read_input(timeout);
+		if (status == 0)
+			return 0;
+		if (status < 0)
+			return input_closed;
+	}
+}
+
+const Input_backend terminal_input = {
+	initialize,
+	finalize,
+	read_keys,
+	true,
+};
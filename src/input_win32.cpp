@@ -0,0 +1,81 @@
+#include "input.h"
+#include <Windows.h>
+#include <algorithm>
+#include <iterator>
+
+static HANDLE input_handle;
+
+static DWORD initialize()
+{
+	DWORD last_error = 0;
+	input_handle = CreateFileA("CONIN$",
+				   GENERIC_READ | GENERIC_WRITE,
+				   FILE_SHARE_READ,
+				   NULL,
+				   OPEN_EXISTING,
+				   0,
+				   0);
+	if (input_handle != INVALID_HANDLE_VALUE) {
+		DWORD input_mode;
+		if (GetConsoleMode(input_handle, &input_mode)) {
+			DWORD cooked_flags = ENABLE_LINE_INPUT | ENABLE_ECHO_INPUT | ENABLE_PROCESSED_INPUT;
+			input_mode &= ~cooked_flags;
+			if (SetConsoleMode(input_handle, input_mode)) {
+			} else {
+				last_error = GetLastError();
+			}
+		} else {
+			last_error = GetLastError();
+		}
+	} else {
+		last_error = GetLastError();
+	}
+
+	return last_error;
+}
+
+static void finalize()
+{
+	CloseHandle(input_handle);
+}
+
+static std::size_t read_keys(Key_input* keys, std::size_t n, DWORD timeout)
+{
+	INPUT_RECORD records[128];
+	DWORD read;
+	std::size_t count = 0;
+	while (count == 0) {
+		DWORD waited = WaitForSingleObject(input_handle, timeout);
+		if (waited == WAIT_TIMEOUT)
+			return 0;
+		// The console has gone, as a closed terminal is on POSIX
+		if (waited == WAIT_FAILED)
+			return input_closed;
+		// Every record is at most one key
+		DWORD size = static_cast<DWORD>(std::min<std::size_t>(n, std::size(records)));
+		if (!ReadConsoleInput(input_handle, records, size, &read))
+			return input_closed;
+		for (DWORD i = 0; i < read; ++i) {
+			if (records[i].EventType != KEY_EVENT)
+				continue;
+			const KEY_EVENT_RECORD& key_event = records[i].Event.KeyEvent;
+			if (!key_event.bKeyDown)
+				continue;
+
+			Key_input& key_input = keys[count++];
+			key_input.key = key_event.wVirtualKeyCode;
+			key_input.key |= ((key_event.dwControlKeyState & SHIFT_PRESSED) != 0) << 8;
+			key_input.key |= ((key_event.dwControlKeyState & (LEFT_CTRL_PRESSED | RIGHT_CTRL_PRESSED)) != 0) << 9;
+			key_input.key |= ((key_event.dwControlKeyState & (LEFT_ALT_PRESSED | RIGHT_ALT_PRESSED)) != 0) << 10;
+			key_input.ascii = key_event.uChar.AsciiChar;
+		}
+	}
+	return count;
+}
+
+const Input_backend terminal_input = {
+	initialize,
+	finalize,
+	read_keys,
+	true,
+};
@@ -0,0 +1,136 @@
+#include "key_notation.h"
+#include <cctype>
+
+struct Key_name {
+	const char* name;
+	SHORT key;
+	char ascii;
+};
+
+static const Key_name key_names[] = {
+	{ "esc", VK_ESCAPE, 27 },
+	{ "cr", VK_RETURN, '\r' },
+	{ "enter", VK_RETURN, '\r' },
+	{ "return", VK_RETURN, '\r' },
+	{ "tab", VK_TAB, '\t' },
+	{ "bs", VK_BACK, '\b' },
+	{ "space", VK_SPACE, ' ' },
+	{ "lt", static_cast<SHORT>(SHIFT | VK_OEM_COMMA), '<' },
+	{ "bar", static_cast<SHORT>(SHIFT | VK_OEM_5), '|' },
+	{ "bslash", VK_OEM_5, '\\' },
+	{ "del", VK_DELETE, 0 },
+	{ "insert", VK_INSERT, 0 },
+	{ "up", VK_UP, 0 },
+	{ "down", VK_DOWN, 0 },
+	{ "left", VK_LEFT, 0 },
+	{ "right", VK_RIGHT, 0 },
+	{ "home", VK_HOME, 0 },
+	{ "end", VK_END, 0 },
+	{ "pageup", VK_PRIOR, 0 },
+	{ "pagedown", VK_NEXT, 0 },
+	{ "pastestart", KEY_PASTE_START, 0 },
+	{ "pasteend", KEY_PASTE_END, 0 },
+};
+
+static bool equal_ignoring_case(std::string_view a, std::string_view b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (std::size_t i = 0; i < a.size(); ++i) {
+		if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i])))
+			return false;
+	}
+	return true;
+}
+
+static Key_input character_key(char c)
+{
+	SHORT scan = VkKeyScanA(c);
+	return Key_input{ static_cast<SHORT>(scan == -1 ? 0 : scan), c };
+}
+
+/*
+ * Parses the text between angle brackets
+ */
+static bool parse_named_key(std::string_view name, Key_input& key)
+{
+	SHORT modifiers = 0;
+	while (name.size() > 2 && name[1] == '-') {
+		switch (std::toupper(static_cast<unsigned char>(name[0]))) {
+		case 'S': modifiers |= SHIFT; break;
+		case 'C': modifiers |= CONTROL; break;
+		case 'A': case 'M': modifiers |= ALT; break;
+		default: return false;
+		}
+		name.remove_prefix(2);
+	}
+
+	if (name.size() == 1) {
+		char c = name[0];
+		if (modifiers & CONTROL) {
+			// <C-X> is <C-x>, as in Vim
+			c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+			key = character_key(c);
+			key.key |= modifiers;
+			auto upper = static_cast<unsigned char>(std::toupper(static_cast<unsigned char>(c)));
+			key.ascii = upper >= '@' && upper <= '_' ? static_cast<char>(upper & 0x1F) : 0;
+		} else {
+			key = character_key(c);
+			key.key |= modifiers;
+		}
+		return key.key != 0;
+	}
+
+	if (name.size() >= 2 && (name[0] == 'F' || name[0] == 'f')) {
+		int n = 0;
+		for (std::size_t i = 1; i < name.size(); ++i) {
+			if (!std::isdigit(static_cast<unsigned char>(name[i])))
+				return false;
+			n = n * 10 + (name[i] - '0');
+		}
+		if (n < 1 || n > 12)
+			return false;
+		key = Key_input{ static_cast<SHORT>((VK_F1 + n - 1) | modifiers), 0 };
+		return true;
+	}
+
+	for (const Key_name& key_name : key_names) {
+		if (equal_ignoring_case(name, key_name.name)) {
+			key = Key_input{ static_cast<SHORT>(key_name.key | modifiers), key_name.ascii };
+			return true;
+		}
+	}
+	return false;
+}
+
+bool parse_key_notation(std::string_view text, std::vector<Key_input>& keys, std::string& error)
+{
+	std::size_t i = 0;
+	while (i < text.size()) {
+		char c = text[i];
+		if (c == '\n' || c == '\r') {
+			++i;
+			continue;
+		}
+
+		std::size_t close = c == '<' ? text.find('>', i + 1) : std::string_view::npos;
+		std::string_view name;
+		if (close != std::string_view::npos)
+			name = text.substr(i + 1, close - i - 1);
+		// A '<' that doesn't start a key name is itself
+		if (name.empty() || name.find_first_of(" \t\r\n<") != std::string_view::npos) {
+			keys.push_back(character_key(c));
+			++i;
+			continue;
+		}
+
+		Key_input key;
+		if (!parse_named_key(name, key)) {
+			error = "unknown key <" + std::string(name) + ">";
+			return false;
+		}
+		keys.push_back(key);
+		i = close + 1;
+	}
+	return true;
+}
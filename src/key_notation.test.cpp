@@ -0,0 +1,49 @@
+#include "key_notation.h"
+#include <cassert>
+
+static std::vector<Key_input> parse(std::string_view text)
+{
+	std::vector<Key_input> keys;
+	std::string error;
+	bool parsed = parse_key_notation(text, keys, error);
+	assert(parsed && error.empty());
+	return keys;
+}
+
+int main()
+{
+	std::vector<Key_input> keys = parse("iHi<Esc>");
+	assert(keys.size() == 4);
+	assert(keys[0].key == VkKeyScanA('i') && keys[0].ascii == 'i');
+	assert(keys[1].key == VkKeyScanA('H') && keys[1].ascii == 'H');
+	assert(keys[3].key == VK_ESCAPE && keys[3].ascii == 27);
+
+	// Modifiers, names are case insensitive
+	keys = parse("<C-x><c-S><C-Home><S-Right><A-w><cr><Tab><BS><F5>");
+	assert(keys.size() == 9);
+	assert(keys[0].key == (CONTROL | VkKeyScanA('x')) && keys[0].ascii == 0x18);
+	assert(keys[1].key == (CONTROL | VkKeyScanA('s')) && keys[1].ascii == 0x13);
+	assert(keys[2].key == (CONTROL | VK_HOME));
+	assert(keys[3].key == (SHIFT | VK_RIGHT));
+	assert(keys[4].key == (ALT | VkKeyScanA('w')));
+	assert(keys[5].key == VK_RETURN && keys[5].ascii == '\r');
+	assert(keys[6].key == VK_TAB);
+	assert(keys[7].key == VK_BACK);
+	assert(keys[8].key == VK_F1 + 4);
+
+	// Line breaks are ignored, '<' is itself unless it starts a key name
+	keys = parse("a\n<lt>b\r\n<");
+	assert(keys.size() == 4);
+	assert(keys[1].ascii == '<' && keys[3].ascii == '<');
+	keys = parse("if (a < b && c > d)");
+	assert(keys.size() == 19 && keys[6].ascii == '<');
+
+	keys = parse("<PasteStart>x<PasteEnd>");
+	assert(keys.size() == 3);
+	assert(keys[0].key == KEY_PASTE_START && keys[2].key == KEY_PASTE_END);
+
+	std::vector<Key_input> unused;
+	std::string error;
+	assert(!parse_key_notation("<Nope>", unused, error) && !error.empty());
+	assert(!parse_key_notation("<X-a>", unused, error));
+}
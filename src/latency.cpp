@@ -0,0 +1,197 @@
+#include "latency.h"
+#include <algorithm>
+#include <cstdio>
+
+Latency_histogram::Latency_histogram()
+{
+	clear();
+}
+
+static int log2_floor(std::uint64_t x)
+{
+	int n = 0;
+	for (int shift = 32; shift > 0; shift /= 2) {
+		if (x >> shift) {
+			x >>= shift;
+			n += shift;
+		}
+	}
+	return n;
+}
+
+int Latency_histogram::bucket(std::uint64_t nanoseconds)
+{
+	if (nanoseconds < sub_buckets)
+		return static_cast<int>(nanoseconds);
+	int exponent = log2_floor(nanoseconds);
+	int shift = exponent - sub_bucket_bits;
+	return (shift + 1) * sub_buckets + static_cast<int>((nanoseconds >> shift) & (sub_buckets - 1));
+}
+
+std::uint64_t Latency_histogram::bucket_value(int bucket)
+{
+	int row = bucket / sub_buckets;
+	std::uint64_t position = bucket % sub_buckets;
+	if (row == 0)
+		return position;
+	return (sub_buckets + position) << (row - 1);
+}
+
+void Latency_histogram::record(std::uint64_t nanoseconds)
+{
+	buckets[bucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+	total_count.fetch_add(1, std::memory_order_relaxed);
+	std::uint64_t current = maximum.load(std::memory_order_relaxed);
+	while (nanoseconds > current && !maximum.compare_exchange_weak(current, nanoseconds, std::memory_order_relaxed)) {
+	}
+}
+
+void Latency_histogram::clear()
+{
+	for (auto& count : buckets)
+		count.store(0, std::memory_order_relaxed);
+	total_count.store(0, std::memory_order_relaxed);
+	maximum.store(0, std::memory_order_relaxed);
+}
+
+std::uint64_t Latency_histogram::count() const
+{
+	return total_count.load(std::memory_order_relaxed);
+}
+
+std::uint64_t Latency_histogram::max() const
+{
+	return maximum.load(std::memory_order_relaxed);
+}
+
+std::uint64_t Latency_histogram::percentile(double fraction) const
+{
+	std::uint64_t total = 0;
+	for (const auto& count : buckets)
+		total += count.load(std::memory_order_relaxed);
+	if (total == 0)
+		return 0;
+
+	// The rank of the duration wanted, counting from one
+	auto rank = static_cast<std::uint64_t>(fraction * total + 0.5);
+	if (rank < 1)
+		rank = 1;
+	std::uint64_t seen = 0;
+	for (int i = 0; i < bucket_count; ++i) {
+		seen += buckets[i].load(std::memory_order_relaxed);
+		if (seen >= rank)
+			return std::min(bucket_value(i), max());
+	}
+	return max();
+}
+
+#if defined(RED_LATENCY)
+
+static const char* const phase_names[] = {
+	"input",
+	"command",
+	"reframe",
+	"frame",
+	"output",
+	"key_to_paint",
+};
+
+static Latency_histogram histograms[static_cast<int>(Latency_phase::count)];
+
+// When the key being handled was read, and when read_key took it
+static Latency_mark key_read;
+// When the first key whose frame was deferred arrived, keys handled while
+// more were waiting share the frame painted after the last
+static Latency_mark unpainted;
+static bool frame_deferred = false;
+static bool key_pending = false;
+
+void latency_record(Latency_phase phase, Latency_mark start)
+{
+	auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(latency_mark() - start);
+	histograms[static_cast<int>(phase)].record(static_cast<std::uint64_t>(elapsed.count()));
+}
+
+void latency_key_read(Latency_mark arrived)
+{
+	latency_record(Latency_phase::input, arrived);
+	key_read = latency_mark();
+	if (!frame_deferred)
+		unpainted = arrived;
+	key_pending = true;
+}
+
+void latency_command_done()
+{
+	if (key_pending)
+		latency_record(Latency_phase::command, key_read);
+}
+
+void latency_frame_deferred()
+{
+	frame_deferred = key_pending;
+}
+
+bool latency_frame_built(Latency_mark& arrived)
+{
+	bool timed = key_pending;
+	arrived = unpainted;
+	key_pending = false;
+	frame_deferred = false;
+	return timed;
+}
+
+void latency_frame_painted(Latency_mark arrived)
+{
+	latency_record(Latency_phase::key_to_paint, arrived);
+}
+
+static double microseconds(std::uint64_t nanoseconds)
+{
+	return nanoseconds / 1000.0;
+}
+
+std::string latency_status()
+{
+	const Latency_histogram& keys = histograms[static_cast<int>(Latency_phase::key_to_paint)];
+	char line[256];
+	std::snprintf(line, sizeof(line), "key to paint p50 %.0fus p99 %.0fus max %.0fus (%llu keys), command p99 %.0fus, frame p99 %.0fus, output p99 %.0fus",
+		      microseconds(keys.percentile(0.5)),
+		      microseconds(keys.percentile(0.99)),
+		      microseconds(keys.max()),
+		      static_cast<unsigned long long>(keys.count()),
+		      microseconds(histograms[static_cast<int>(Latency_phase::command)].percentile(0.99)),
+		      microseconds(histograms[static_cast<int>(Latency_phase::frame)].percentile(0.99)),
+		      microseconds(histograms[static_cast<int>(Latency_phase::output)].percentile(0.99)));
+	return line;
+}
+
+std::string latency_report()
+{
+	std::string report;
+	char line[256];
+	std::snprintf(line, sizeof(line), "%-14s %10s %12s %12s %12s\n", "phase", "count", "p50 us", "p99 us", "max us");
+	report += line;
+	for (int i = 0; i < static_cast<int>(Latency_phase::count); ++i) {
+		const Latency_histogram& histogram = histograms[i];
+		std::snprintf(line, sizeof(line), "%-14s %10llu %12.1f %12.1f %12.1f\n", phase_names[i],
+			      static_cast<unsigned long long>(histogram.count()),
+			      microseconds(histogram.percentile(0.5)),
+			      microseconds(histogram.percentile(0.99)),
+			      microseconds(histogram.max()));
+		report += line;
+	}
+	return report;
+}
+
+bool latency_dump(const std::string& filename)
+{
+	std::FILE* file = std::fopen(filename.c_str(), "w");
+	if (!file)
+		return false;
+	std::string report = latency_report();
+	bool written = std::fwrite(report.data(), 1, report.size(), file) == report.size();
+	return std::fclose(file) == 0 && written;
+}
+
+#endif
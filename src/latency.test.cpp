@@ -0,0 +1,61 @@
+#include "latency.h"
+#include <cassert>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+static void check_buckets()
+{
+	// Buckets are ordered and each value falls in its own bucket
+	for (int i = 1; i < Latency_histogram::bucket_count; ++i)
+		assert(Latency_histogram::bucket_value(i - 1) < Latency_histogram::bucket_value(i));
+	for (std::uint64_t x : { 0ull, 1ull, 15ull, 16ull, 17ull, 1000ull, 123456789ull, ~0ull }) {
+		int bucket = Latency_histogram::bucket(x);
+		assert(bucket >= 0 && bucket < Latency_histogram::bucket_count);
+		assert(Latency_histogram::bucket_value(bucket) <= x);
+		if (bucket + 1 < Latency_histogram::bucket_count)
+			assert(x < Latency_histogram::bucket_value(bucket + 1));
+	}
+}
+
+static void check_percentiles()
+{
+	auto histogram = std::make_unique<Latency_histogram>();
+	assert(histogram->percentile(0.5) == 0);
+	for (std::uint64_t i = 1; i <= 100000; ++i)
+		histogram->record(i * 1000);
+	assert(histogram->count() == 100000);
+	assert(histogram->max() == 100000000);
+	// Within the precision of the buckets
+	std::uint64_t p50 = histogram->percentile(0.5);
+	std::uint64_t p99 = histogram->percentile(0.99);
+	assert(p50 > 50000000 * 0.93 && p50 <= 50000000);
+	assert(p99 > 99000000 * 0.93 && p99 <= 99000000);
+	assert(histogram->percentile(1.0) <= histogram->max());
+	histogram->clear();
+	assert(histogram->count() == 0 && histogram->max() == 0);
+}
+
+static void check_threads()
+{
+	auto histogram = std::make_unique<Latency_histogram>();
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t) {
+		threads.emplace_back([&histogram, t] () {
+			for (int i = 0; i < 100000; ++i)
+				histogram->record(t * 1000 + i % 100);
+		});
+	}
+	for (auto& thread : threads)
+		thread.join();
+	assert(histogram->count() == 400000);
+	assert(histogram->max() == 3099);
+}
+
+int main()
+{
+	check_buckets();
+	check_percentiles();
+	check_threads();
+}
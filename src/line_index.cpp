@@ -0,0 +1,203 @@
+#include "line_index.h"
+#include <cassert>
+#include <algorithm>
+#include "byte_search.h"
+
+/*
+ * Calls f(first, last) for each contiguous run of text making up
+ * [position, position + n).  Stops early if f returns false.
+ */
+template <typename F>
+// requires Function(F, const char*, const char*) && Codomain(F) == bool
+static void for_each_span(const Text_storage& text, Line_index::size_type position, Line_index::size_type n, F f)
+{
+	while (n > 0) {
+		std::string_view segment = text.segment_from(position);
+		Line_index::size_type m = std::min(n, segment.size());
+		if (!f(segment.data(), segment.data() + m))
+			return;
+		position += m;
+		n -= m;
+	}
+}
+
+static Line_index::size_type count_newlines(const Text_storage& text, Line_index::size_type position, Line_index::size_type n)
+{
+	Line_index::size_type count = 0;
+	for_each_span(text, position, n, [&count] (const char* first, const char* last) -> bool {
+		count += count_byte(first, last, '\n');
+		return true;
+	});
+	return count;
+}
+
+/*
+ * Returns the offset after the n-th newline at or after `position`, requires
+ * that there are at least n such newlines.
+ */
+static Line_index::size_type nth_newline(const Text_storage& text, Line_index::size_type position, Line_index::size_type n)
+{
+	assert(n > 0);
+	Line_index::size_type result = position;
+	for_each_span(text, position, text.size() - position, [&] (const char* first, const char* last) -> bool {
+		const char* start = first;
+		while (true) {
+			first = find_byte(first, last, '\n');
+			if (first == last)
+				break;
+			++first;
+			if (--n == 0)
+				break;
+		}
+		result += first - start;
+		return n != 0;
+	});
+	assert(n == 0);
+	return result;
+}
+
+/*
+ * Returns the block containing `position` and replaces `position` with the
+ * offset into that block.  The end of the text belongs to the last block.
+ */
+Line_index::size_type Line_index::find_block(size_type& position) const
+{
+	size_type block = bytes.upper_bound(position);
+	if (block == block_bytes.size()) {
+		assert(position == 0);
+		--block;
+		position = block_bytes[block];
+	}
+	return block;
+}
+
+void Line_index::rebuild_trees()
+{
+	bytes.assign(block_bytes.begin(), block_bytes.end());
+	newlines.assign(block_newlines.begin(), block_newlines.end());
+}
+
+void Line_index::split_block(const Text_storage& text, size_type block, size_type start)
+{
+	std::vector<size_type> new_bytes;
+	std::vector<size_type> new_newlines;
+	// Into equal parts, a block_size part and a sliver would leave the
+	// sliver to be merged again
+	size_type total = block_bytes[block];
+	size_type parts = (total + block_size - 1) / block_size;
+	for (size_type i = 0, offset = 0; i < parts; ++i) {
+		size_type n = total / parts + (i < total % parts);
+		new_bytes.push_back(n);
+		new_newlines.push_back(count_newlines(text, start + offset, n));
+		offset += n;
+	}
+
+	block_bytes.erase(block_bytes.begin() + block);
+	block_bytes.insert(block_bytes.begin() + block, new_bytes.begin(), new_bytes.end());
+	block_newlines.erase(block_newlines.begin() + block);
+	block_newlines.insert(block_newlines.begin() + block, new_newlines.begin(), new_newlines.end());
+	rebuild_trees();
+}
+
+/*
+ * Merges the blocks in [first, last) that are under low_water into the block
+ * before them, or the one after into them, as long as the result isn't due
+ * to be split.  The trees are only rebuilt if a block went.
+ */
+void Line_index::merge_blocks(size_type first, size_type last)
+{
+	size_type out = first + 1;
+	for (size_type block = first + 1; block < last; ++block) {
+		size_type& previous = block_bytes[out - 1];
+		if ((previous < low_water || block_bytes[block] < low_water) && previous + block_bytes[block] <= 2 * block_size) {
+			previous += block_bytes[block];
+			block_newlines[out - 1] += block_newlines[block];
+		} else {
+			block_bytes[out] = block_bytes[block];
+			block_newlines[out] = block_newlines[block];
+			++out;
+		}
+	}
+	if (out == last)
+		return;
+	block_bytes.erase(block_bytes.begin() + out, block_bytes.begin() + last);
+	block_newlines.erase(block_newlines.begin() + out, block_newlines.begin() + last);
+	rebuild_trees();
+}
+
+void Line_index::assign(const Text_storage& text)
+{
+	block_bytes.clear();
+	block_newlines.clear();
+	size_type size = text.size();
+	for (size_type offset = 0; offset < size; offset += block_size) {
+		size_type n = std::min(block_size, size - offset);
+		block_bytes.push_back(n);
+		block_newlines.push_back(count_newlines(text, offset, n));
+	}
+	// Always keep one block so there is somewhere to insert into
+	if (block_bytes.empty()) {
+		block_bytes.push_back(0);
+		block_newlines.push_back(0);
+	}
+	rebuild_trees();
+}
+
+void Line_index::insert(const Text_storage& text, size_type position, size_type n)
+{
+	size_type offset = position;
+	size_type block = find_block(offset);
+	size_type count = count_newlines(text, position, n);
+	block_bytes[block] += n;
+	block_newlines[block] += count;
+	bytes.add(block, n);
+	newlines.add(block, count);
+	if (block_bytes[block] > 2 * block_size)
+		split_block(text, block, position - offset);
+}
+
+void Line_index::erase(const Text_storage& text, size_type position, size_type n)
+{
+	size_type offset = position;
+	size_type block = find_block(offset);
+	size_type first = block;
+	while (n > 0) {
+		assert(block < block_bytes.size());
+		size_type m = std::min(n, block_bytes[block] - offset);
+		size_type count = count_newlines(text, position, m);
+		block_bytes[block] -= m;
+		block_newlines[block] -= count;
+		bytes.add(block, 0 - m);
+		newlines.add(block, 0 - count);
+		position += m;
+		n -= m;
+		offset = 0;
+		++block;
+	}
+	// The blocks either side of those touched are what they merge into
+	merge_blocks(first > 0 ? first - 1 : 0, std::min(block + 1, block_bytes.size()));
+}
+
+Line_index::size_type Line_index::line_count() const
+{
+	return newlines.prefix_sum(newlines.size()) + 1;
+}
+
+Line_index::size_type Line_index::line_number(const Text_storage& text, size_type position) const
+{
+	size_type offset = position;
+	size_type block = find_block(offset);
+	return newlines.prefix_sum(block) + count_newlines(text, position - offset, offset);
+}
+
+Line_index::size_type Line_index::line_begin(const Text_storage& text, size_type line) const
+{
+	assert(line < line_count());
+	if (line == 0)
+		return 0;
+
+	size_type n = line - 1;
+	size_type block = newlines.upper_bound(n);
+	assert(block < block_newlines.size());
+	return nth_newline(text, bytes.prefix_sum(block), n + 1);
+}
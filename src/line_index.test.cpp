@@ -0,0 +1,81 @@
+#include "line_index.h"
+#include <cassert>
+#include <cstdlib>
+#include <string>
+
+/*
+ * Checks a sample of offsets and lines against a brute force scan of the text
+ */
+static void check(const Text_storage& text, const std::string& expected, const Line_index& index)
+{
+	std::size_t lines = 1;
+	std::size_t line_start = 0;
+	for (std::size_t i = 0; i <= expected.size(); ++i) {
+		if (i % 101 == 0 || i == expected.size())
+			assert(index.line_number(text, i) == lines - 1);
+		if (i == line_start && lines % 13 == 0)
+			assert(index.line_begin(text, lines - 1) == line_start);
+		if (i < expected.size() && expected[i] == '\n') {
+			++lines;
+			line_start = i + 1;
+		}
+	}
+	assert(index.line_count() == lines);
+}
+
+int main()
+{
+	Text_storage text;
+	std::string expected;
+	Line_index index;
+	index.assign(text);
+	check(text, expected, index);
+
+	// Enough text to force several block splits
+	std::srand(1);
+	for (int i = 0; i < 100000; ++i) {
+		char c = (std::rand() % 8 == 0) ? '\n' : static_cast<char>('a' + std::rand() % 26);
+		std::size_t position = expected.empty() ? 0 : std::rand() % (expected.size() + 1);
+		// Keep inserting near the same place to grow a single block
+		if (i % 2)
+			position = expected.size() / 2;
+		text.insert(text.begin() + position, 1, c);
+		expected.insert(position, 1, c);
+		index.insert(text, position, 1);
+	}
+	check(text, expected, index);
+
+	// Erasing a little at a time empties blocks one by one, which are merged
+	// into their neighbours, then more goes in where they were
+	for (int i = 0; i < 2000; ++i) {
+		std::size_t n = std::min<std::size_t>(1 + std::rand() % 64, expected.size() / 3);
+		std::size_t position = expected.size() / 3 - n;
+		index.erase(text, position, n);
+		text.erase(text.begin() + position, n);
+		expected.erase(position, n);
+	}
+	check(text, expected, index);
+	for (int i = 0; i < 2000; ++i) {
+		std::size_t position = std::rand() % (expected.size() + 1);
+		char c = i % 3 == 0 ? '\n' : 'x';
+		text.insert(text.begin() + position, 1, c);
+		expected.insert(position, 1, c);
+		index.insert(text, position, 1);
+	}
+	check(text, expected, index);
+
+	for (int i = 0; i < 1000; ++i) {
+		std::size_t position = std::rand() % expected.size();
+		std::size_t n = std::min<std::size_t>(std::rand() % 100000, expected.size() - position);
+		index.erase(text, position, n);
+		text.erase(text.begin() + position, n);
+		expected.erase(position, n);
+		if (expected.empty())
+			break;
+	}
+	check(text, expected, index);
+
+	Line_index rebuilt;
+	rebuilt.assign(text);
+	check(text, expected, rebuilt);
+}
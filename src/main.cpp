@@ -1,17 +1,23 @@
-#include <Windows.h>
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
 #include <algorithm>
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "buffer.h"
 #include "screen.h"
 #include "input.h"
 #include "file.h"
 #include "display.h"
+#include "display_width.h"
+#include "event_loop.h"
 #include "utility.h"
 #include "prompt.h"
 #include "command.h"
+#include "latency.h"
+#include "replay.h"
 
 #if 0
 static void handle_window_buffer_size_event(Editor_state& editor, const WINDOW_BUFFER_SIZE_RECORD& size_event)
@@ -33,51 +39,132 @@ static void handle_window_buffer_size_event(Editor_state& editor, const WINDOW_B
 }
 #endif
 
-static void editor_initialize(Editor_state& editor)
+static Editor_state* running_editor;
+
+/*
+ * Run by the event loop when the workers have read more of a file or
+ * finished a save.  A prompt waiting for an answer isn't written over, the
+ * report is tried again a little later.
+ */
+static void report_background_work()
 {
-	editor.buffer.modified = false;
-	editor.view.buffer = &editor.buffer;
-	Screen_dimension size = screen_dimension();
-	editor.view.width = size.width;
-	editor.view.height = size.height - 1;
-	editor.view.cursor = editor.buffer.begin();
-	editor.view.top_line = editor.buffer.begin();
-	editor.view.first_column = 0;
-	editor.view.column_desired = 0;
+	if (prompt_active()) {
+		event_loop_set_timer(report_background_work, 100);
+		return;
+	}
+	bool saved = report_saves(*running_editor);
+	bool loaded = report_loads(*running_editor);
+	if (saved || loaded)
+		display_refresh(running_editor->view);
+	// A limited amount is taken in at a time, the rest once the keys
+	// waiting have been handled
+	if (loaded)
+		event_loop_background_ready();
+}
+
+/*
+ * When built with RED_LATENCY the latencies measured are written out on
+ * exit, to the file named by RED_LATENCY_FILE or red-latency.txt.
+ */
+static void dump_latency()
+{
+#if defined(RED_LATENCY)
+	const char* filename = std::getenv("RED_LATENCY_FILE");
+	latency_dump(filename ? filename : "red-latency.txt");
+#endif
+}
+
+/*
+ * The text unmodified buffers may hold before the least recently shown are
+ * released, in megabytes from RED_BUFFER_BUDGET.
+ */
+static void set_buffer_budget(Buffer_list& buffers)
+{
+	const char* budget = std::getenv("RED_BUFFER_BUDGET");
+	if (budget && *budget) {
+		char* end;
+		unsigned long long megabytes = std::strtoull(budget, &end, 10);
+		if (*end == '\0')
+			buffers.set_memory_budget(static_cast<Buffer_list::size_type>(megabytes) * 1024 * 1024);
+	}
+}
+
+/*
+ * Tab stops every RED_TABSTOP columns
+ */
+static void set_tab_stops()
+{
+	const char* tabstop = std::getenv("RED_TABSTOP");
+	if (tabstop && *tabstop) {
+		char* end;
+		long width = std::strtol(tabstop, &end, 10);
+		if (*end == '\0' && width > 0 && width <= 64)
+			set_tab_width(static_cast<int>(width));
+	}
+}
+
+/*
+ * Errors are reported once the screen has been restored, so they can be seen
+ */
+static void report_error(const char* message)
+{
+#if defined(_WIN32)
+	OutputDebugStringA(message);
+#else
+	std::fputs(message, stderr);
+#endif
 }
 
 int main(int argc, char **argv)
 {
+	if (argc == 4 && std::string_view(argv[1]) == "--replay")
+		return replay(argv[2], argv[3]);
+
+#if defined(_WIN32)
 	SetConsoleTitle("RED");
+#endif
 	DWORD last_error = screen_initialize();
 
 	Editor_state editor;
+	const char* error = nullptr;
 
 	if (last_error == 0) {
 		editor_initialize(editor);
-		screen_cursor_style(Cursor_style::block);
-		last_error = input_initialize();
+		set_buffer_budget(editor.buffers);
+		set_tab_stops();
+		display_cursor_style(Cursor_style::block);
+		last_error = event_loop_initialize();
+		if (last_error == 0)
+			last_error = input_initialize();
 		if (last_error == 0) {
+			running_editor = &editor;
+			event_loop_set_background_handler(report_background_work);
+			file_set_notify(event_loop_background_ready);
 			if (argc == 2)
-				last_error = file_open(argv[1], editor.buffer);
+				last_error = file_open(argv[1], *editor.view.buffer);
 			if (last_error == 0) {
+				display_start_thread();
 				display_refresh(editor.view);
-				while (true) {
-					Key_input input = wait_for_key();
-					if (evaluate(editor, input))
-						break;
-				}
+				event_loop_run(editor);
+				display_stop_thread();
+				file_save_wait();
+				dump_latency();
 			} else {
-				OutputDebugStringA("Failed to load file\n");
+				error = "Failed to load file\n";
 			}
+			file_set_notify(nullptr);
+			input_finalize();
 		} else {
-			OutputDebugStringA("Failed to initialize input\n");
+			error = "Failed to initialize input\n";
 		}
+		screen_finalize();
 	} else {
-		OutputDebugStringA("Failed to initialize screen buffer\n");
+		error = "Failed to initialize screen buffer\n";
 	}
+	if (error)
+		report_error(error);
 
-
+#if defined(_WIN32)
 	// Restore the original title
 	const DWORD title_size = 64 * 1024;
 	// Dynamically allocate string rather than using stack space, Error C6262
@@ -90,6 +177,7 @@ int main(int argc, char **argv)
 	 */
 	GetConsoleOriginalTitle(&console_title[0], title_size);
 	SetConsoleTitle(console_title.data());
+#endif
 
 	return last_error;
 }
@@ -0,0 +1,350 @@
+#include "piece_table.h"
+#include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+struct Piece_node {
+	std::unique_ptr<Piece_node> left;
+	std::unique_ptr<Piece_node> right;
+	unsigned priority;
+	bool added; // refers to the add buffer rather than the original
+	std::size_t start;
+	std::size_t length;
+	std::size_t total; // length of the text in this subtree
+};
+
+using Node_ptr = std::unique_ptr<Piece_node>;
+
+static Piece_table::size_type total(const Node_ptr& node)
+{
+	return node ? node->total : 0;
+}
+
+static void update(Piece_node& node)
+{
+	node.total = total(node.left) + node.length + total(node.right);
+}
+
+static Node_ptr clone(const Node_ptr& node)
+{
+	if (!node)
+		return nullptr;
+	Node_ptr result(new Piece_node{nullptr, nullptr, node->priority, node->added, node->start, node->length, node->total});
+	result->left = clone(node->left);
+	result->right = clone(node->right);
+	return result;
+}
+
+/*
+ * Joins two treaps, every piece in `x` comes before every piece in `y`
+ */
+static Node_ptr merge(Node_ptr x, Node_ptr y)
+{
+	if (!x)
+		return y;
+	if (!y)
+		return x;
+	if (x->priority > y->priority) {
+		x->right = merge(std::move(x->right), std::move(y));
+		update(*x);
+		return x;
+	}
+	y->left = merge(std::move(x), std::move(y->left));
+	update(*y);
+	return y;
+}
+
+/*
+ * Splits a treap so the first holds the first `position` bytes of the text and
+ * the second holds the rest.  A piece straddling `position` is cut in two, the
+ * second half is placed in `tail` which the caller must have allocated.
+ */
+static std::pair<Node_ptr, Node_ptr> split(Node_ptr node, Piece_table::size_type position, Node_ptr& tail)
+{
+	if (!node)
+		return {nullptr, nullptr};
+
+	Piece_table::size_type left = total(node->left);
+	if (position <= left) {
+		auto parts = split(std::move(node->left), position, tail);
+		node->left = std::move(parts.second);
+		update(*node);
+		return {std::move(parts.first), std::move(node)};
+	}
+
+	if (position >= left + node->length) {
+		auto parts = split(std::move(node->right), position - left - node->length, tail);
+		node->right = std::move(parts.first);
+		update(*node);
+		return {std::move(node), std::move(parts.second)};
+	}
+
+	Piece_table::size_type offset = position - left;
+	tail->added = node->added;
+	tail->start = node->start + offset;
+	tail->length = node->length - offset;
+	tail->total = tail->length;
+	node->length = offset;
+	Node_ptr right = std::move(node->right);
+	update(*node);
+	return {std::move(node), merge(std::move(tail), std::move(right))};
+}
+
+/*
+ * If the piece ending at `position` is the last thing appended to the add
+ * buffer grow it by n bytes. This means typing doesn't create a piece per
+ * character.
+ */
+static bool extend(Piece_node* node, Piece_table::size_type position, Piece_table::size_type n, Piece_table::size_type add_end)
+{
+	if (!node)
+		return false;
+
+	Piece_table::size_type left = total(node->left);
+	bool extended;
+	if (position <= left) {
+		extended = extend(node->left.get(), position, n, add_end);
+	} else if (position == left + node->length) {
+		extended = node->added && node->start + node->length == add_end;
+		if (extended)
+			node->length += n;
+	} else if (position < left + node->length) {
+		extended = false;
+	} else {
+		extended = extend(node->right.get(), position - left - node->length, n, add_end);
+	}
+
+	if (extended)
+		node->total += n;
+	return extended;
+}
+
+Piece_table::~Piece_table() = default;
+
+Piece_table::Piece_table() = default;
+
+Piece_table::Piece_table(const Piece_table& x) :
+	original(x.original),
+	original_size(x.original_size),
+	add(x.add ? std::make_shared<std::string>(*x.add) : nullptr),
+	root(clone(x.root)),
+	seed(x.seed)
+{
+}
+
+Piece_table& Piece_table::operator=(const Piece_table& x)
+{
+	Piece_table tmp = x;
+	std::swap(*this, tmp);
+	return *this;
+}
+
+Piece_table::Piece_table(Piece_table&& x) noexcept = default;
+
+Piece_table& Piece_table::operator=(Piece_table&& x) noexcept = default;
+
+Piece_table::Piece_table(std::string text)
+{
+	if (text.empty())
+		return;
+	auto owner = std::make_shared<const std::string>(std::move(text));
+	original = std::shared_ptr<const char>(owner, owner->data());
+	original_size = owner->size();
+	root = make_node(false, 0, owner->size());
+}
+
+Piece_table::Piece_table(std::shared_ptr<const char> original, size_type size) :
+	original(std::move(original)),
+	original_size(size)
+{
+	if (size != 0)
+		root = make_node(false, 0, size);
+}
+
+void Piece_table::append_original(size_type n)
+{
+	if (n == 0)
+		return;
+	root = merge(std::move(root), make_node(false, original_size, n));
+	original_size += n;
+	invalidate_cache();
+}
+
+const char* Piece_table::piece_data(const Node& node) const
+{
+	return (node.added ? add->data() : original.get()) + node.start;
+}
+
+/*
+ * Returns the piece holding offset `position` and sets `piece_begin` to the
+ * offset of its first byte, requires position < size().
+ */
+const Piece_node* Piece_table::find_piece(size_type position, size_type& piece_begin) const
+{
+	assert(position < size());
+	const Node* node = root.get();
+	piece_begin = 0;
+	while (true) {
+		size_type left = total(node->left);
+		if (position < left) {
+			node = node->left.get();
+		} else if (position < left + node->length) {
+			piece_begin += left;
+			return node;
+		} else {
+			piece_begin += left + node->length;
+			position -= left + node->length;
+			node = node->right.get();
+		}
+	}
+}
+
+std::unique_ptr<Piece_node> Piece_table::make_node(bool added, size_type start, size_type length)
+{
+	// xorshift32
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return Node_ptr(new Node{nullptr, nullptr, seed, added, start, length, length});
+}
+
+void Piece_table::invalidate_cache()
+{
+	cache_data = nullptr;
+	cache_begin = 0;
+	cache_end = 0;
+}
+
+void Piece_table::insert(iterator i, std::string_view text)
+{
+	size_type position = i.index;
+	assert(position <= size());
+	if (text.empty())
+		return;
+
+	invalidate_cache();
+	if (!add) {
+		add = std::make_shared<std::string>();
+	} else if (add.use_count() > 1 && add->capacity() - add->size() < text.size()) {
+		// Growing in place would free the text a snapshot reads
+		auto grown = std::make_shared<std::string>();
+		grown->reserve(2 * (add->size() + text.size()));
+		grown->append(*add);
+		add = std::move(grown);
+	} else if (add.use_count() == 1) {
+		// The snapshots have let go, their reads happened before
+		std::atomic_thread_fence(std::memory_order_acquire);
+	}
+	size_type start = add->size();
+	add->append(text.data(), text.size());
+	if (position > 0 && extend(root.get(), position, text.size(), start))
+		return;
+
+	Node_ptr tail = make_node(true, 0, 0);
+	auto parts = split(std::move(root), position, tail);
+	root = merge(std::move(parts.first), make_node(true, start, text.size()));
+	root = merge(std::move(root), std::move(parts.second));
+}
+
+Piece_table::size_type Piece_table::size() const
+{
+	return total(root);
+}
+
+/*
+ * Appends the text of the pieces under `node` to `segments` in order
+ */
+static void collect(const Piece_node* node, const char* original, const char* add, std::vector<std::string_view>& segments)
+{
+	for (; node; node = node->right.get()) {
+		collect(node->left.get(), original, add, segments);
+		segments.emplace_back((node->added ? add : original) + node->start, node->length);
+	}
+}
+
+std::shared_ptr<const void> Piece_table::share(std::vector<std::string_view>& segments)
+{
+	collect(root.get(), original.get(), add ? add->data() : nullptr, segments);
+	struct Buffers {
+		std::shared_ptr<const char> original;
+		std::shared_ptr<const std::string> add;
+	};
+	return std::make_shared<const Buffers>(Buffers{original, add});
+}
+
+Piece_table::reference Piece_table::operator[](size_type i) const
+{
+	if (i < cache_begin || i >= cache_end) {
+		const Node* node = find_piece(i, cache_begin);
+		cache_end = cache_begin + node->length;
+		cache_data = piece_data(*node);
+	}
+	return cache_data[i - cache_begin];
+}
+
+std::string_view Piece_table::segment_from(size_type i) const
+{
+	if (i == size())
+		return {};
+	size_type piece_begin;
+	const Node* node = find_piece(i, piece_begin);
+	size_type offset = i - piece_begin;
+	return std::string_view(piece_data(*node) + offset, node->length - offset);
+}
+
+std::string_view Piece_table::segment_to(size_type i) const
+{
+	if (i == 0)
+		return {};
+	size_type piece_begin;
+	const Node* node = find_piece(i - 1, piece_begin);
+	return std::string_view(piece_data(*node), i - piece_begin);
+}
+
+Piece_table::iterator Piece_table::begin()
+{
+	return iterator(*this, 0);
+}
+
+Piece_table::iterator Piece_table::end()
+{
+	return iterator(*this, size());
+}
+
+void Piece_table::insert(iterator i, size_type n, char c)
+{
+	insert(i, std::string(n, c));
+}
+
+void Piece_table::insert(iterator i, const char* f, const char* l)
+{
+	insert(i, std::string_view(f, l - f));
+}
+
+void Piece_table::erase(iterator i, size_type n)
+{
+	assert(i.index + n <= size());
+	if (n == 0)
+		return;
+
+	invalidate_cache();
+	Node_ptr tail = make_node(false, 0, 0);
+	auto parts = split(std::move(root), i.index, tail);
+	if (!tail)
+		tail = make_node(false, 0, 0);
+	auto rest = split(std::move(parts.second), n, tail);
+	root = merge(std::move(parts.first), std::move(rest.second));
+}
+
+Piece_table::iterator Piece_table::erase(iterator f, iterator l)
+{
+	erase(f, l.index - f.index);
+	return f;
+}
+
+void Piece_table::replace(iterator f, iterator l, std::string_view text)
+{
+	erase(f, l);
+	insert(f, text);
+}
@@ -0,0 +1,89 @@
+#include "piece_table.h"
+#include <cassert>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+/*
+ * Checks the table holds `expected`, both through operator[] and by walking
+ * the segments forwards and backwards.
+ */
+static void check(const Piece_table& x, const std::string& expected)
+{
+	assert(x.size() == expected.size());
+	for (std::size_t i = 0; i < expected.size(); ++i)
+		assert(x[i] == expected[i]);
+
+	std::string forward;
+	for (std::size_t i = 0; i < x.size();) {
+		std::string_view segment = x.segment_from(i);
+		assert(!segment.empty());
+		forward.append(segment.data(), segment.size());
+		i += segment.size();
+	}
+	assert(forward == expected);
+
+	std::string backward;
+	for (std::size_t i = x.size(); i > 0;) {
+		std::string_view segment = x.segment_to(i);
+		assert(!segment.empty());
+		backward.insert(0, segment.data(), segment.size());
+		i -= segment.size();
+	}
+	assert(backward == expected);
+}
+
+int main()
+{
+	Piece_table x(std::string("hello world"));
+	std::string expected = "hello world";
+	check(x, expected);
+
+	// Typing at one place extends a single piece
+	for (char c = 'a'; c <= 'z'; ++c) {
+		x.insert(x.begin() + 5, 1, c);
+		expected.insert(5, 1, c);
+	}
+	check(x, expected);
+
+	x.erase(x.begin(), x.end());
+	expected.clear();
+	check(x, expected);
+
+	std::srand(1);
+	for (int i = 0; i < 20000; ++i) {
+		std::size_t position = std::rand() % (expected.size() + 1);
+		if (std::rand() % 3 == 0 && position < expected.size()) {
+			std::size_t n = std::min<std::size_t>(std::rand() % 16, expected.size() - position);
+			x.erase(x.begin() + position, n);
+			expected.erase(position, n);
+		} else {
+			std::size_t n = 1 + std::rand() % 4;
+			char c = static_cast<char>('a' + std::rand() % 26);
+			x.insert(x.begin() + position, n, c);
+			expected.insert(position, n, c);
+		}
+	}
+	check(x, expected);
+
+	Piece_table y = x;
+	check(y, expected);
+	y.erase(y.begin(), y.size() / 2);
+	check(x, expected);
+
+	// An original read in a chunk at a time, edited in between
+	auto file = std::make_shared<const std::string>("first line\nsecond line\nthird line\n");
+	Piece_table z(std::shared_ptr<const char>(file, file->data()), 5);
+	expected = file->substr(0, 5);
+	check(z, expected);
+	z.insert(z.begin() + 2, std::string_view("XY"));
+	expected.insert(2, "XY");
+	z.append_original(10);
+	expected += file->substr(5, 10);
+	check(z, expected);
+	z.erase(z.begin(), 3);
+	expected.erase(0, 3);
+	z.append_original(file->size() - 15);
+	expected += file->substr(15);
+	check(z, expected);
+}
@@ -1,80 +1,104 @@
 #include <cassert>
 #include "prompt.h"
 #include "display.h"
-#include "input.h"
-#include "screen.h"
 #include "utility.h"
 
-User_response prompt_yesno(std::string_view message)
+static bool active = false;
+static std::string message;
+static std::string result;
+static std::string::size_type position;
+// One of them is set, for the kind of prompt shown
+static Prompt_answered answered_text;
+static Yesno_answered answered_yesno;
+static int prompt_count;
+
+bool prompt_active()
 {
-	User_response result;
-	while (true) {
-		set_status_line(message);
-		Key_input response = wait_for_key();
+	return active;
+}
 
-		if (response.ascii == 'y' || response.ascii == 'Y') {
-			result = User_response::yes;
-			break;
-		}
+static void render_prompt()
+{
+	set_status_prompt(message + result, static_cast<int>(message.size() + position));
+}
 
-		if (response.ascii == 'n' || response.ascii == 'N') {
-			result = User_response::no;
-			break;
-		}
+void prompt(std::string_view question, Prompt_answered answered, int count)
+{
+	assert(!active);
+	active = true;
+	message = question;
+	result.clear();
+	position = 0;
+	answered_text = answered;
+	answered_yesno = nullptr;
+	prompt_count = count;
+	render_prompt();
+}
 
-		if (response.ascii == 27) {
-			result = User_response::cancel;
-			break;
-		}
-	}
+void prompt_yesno(std::string_view question, Yesno_answered answered)
+{
+	assert(!active);
+	active = true;
+	message = question;
+	answered_text = nullptr;
+	answered_yesno = answered;
+	set_status_line(message);
+}
 
+/*
+ * The prompt is put away before it is answered, so the answer may ask
+ * another question
+ */
+static void answer_yesno(Editor_state& editor, User_response response, bool& should_exit)
+{
+	active = false;
 	set_status_line("");
-	return result;
+	answered_yesno(editor, response, should_exit);
 }
 
-void render_prompt(int column, std::string_view prompt, std::string::size_type cursor)
+static void answer_text(Editor_state& editor, bool& should_exit)
 {
-	Screen_dimension dimension = screen_dimension();
-	screen_cursor_visible(false);
-	screen_cursor(column, dimension.height - 1);
-	screen_putstring(prompt);
-	screen_clear_end_of_line();
-	screen_column(column + static_cast<int>(cursor));
-	screen_cursor_visible(true);
+	active = false;
+	set_status_line("");
+	std::string answer = std::move(result);
+	answered_text(editor, answer, should_exit, prompt_count);
 }
 
-std::string prompt(std::string_view message)
+void prompt_key(Editor_state& editor, const Key_input& input, bool& should_exit)
 {
-	std::string result;
-	std::string::size_type position = 0;
-	set_status_line(message);
-	auto prompt_start = static_cast<int>(message.size());
-	while (true) {
-		assert(position <= result.size());
-		render_prompt(prompt_start, result, position);
-		Key_input input = wait_for_key();
-		if (is_print(input.ascii)) {
-			result.insert(position, 1, input.ascii);
+	assert(active);
+	if (answered_yesno) {
+		if (input.ascii == 'y' || input.ascii == 'Y')
+			answer_yesno(editor, User_response::yes, should_exit);
+		else if (input.ascii == 'n' || input.ascii == 'N')
+			answer_yesno(editor, User_response::no, should_exit);
+		else if (input.ascii == 27 || is_cancel_key(input))
+			answer_yesno(editor, User_response::cancel, should_exit);
+		return;
+	}
+
+	assert(position <= result.size());
+	if (is_print(input.ascii)) {
+		result.insert(position, 1, input.ascii);
+		++position;
+	} else if (input.key == VK_RETURN) {
+		answer_text(editor, should_exit);
+		return;
+	} else if (input.key == VK_LEFT) {
+		if (position > 0)
+			--position;
+	} else if (input.key == VK_RIGHT) {
+		if (position < result.size())
 			++position;
-		} else if (input.key == VK_RETURN) {
-			break;
-		} else if (input.key == VK_LEFT) {
-			if (position > 0)
-				--position;
-		} else if (input.key == VK_RIGHT) {
-			if (position < result.size())
-				++position;
-		} else if (input.key == VK_BACK) {
-			if (position > 0) {
-				--position;
-				result.erase(position, 1);
-			}
-		} else if (input.ascii == 27) {
-			result.clear();
-			break;
+	} else if (input.key == VK_BACK) {
+		if (position > 0) {
+			--position;
+			result.erase(position, 1);
 		}
+	} else if (input.ascii == 27 || is_cancel_key(input)) {
+		result.clear();
+		answer_text(editor, should_exit);
+		return;
 	}
-	set_status_line("");
-	return result;
+	render_prompt();
 }
-
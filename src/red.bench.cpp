@@ -0,0 +1,475 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "buffer.h"
+#include "command.h"
+#include "display.h"
+#include "editor.h"
+#include "gap_buffer.h"
+#include "headless.h"
+#include "key_notation.h"
+#include "prompt.h"
+#include "segmented_algorithm.h"
+
+/*
+ * red-bench
+ *
+ * Microbenchmarks for the text storage, motions, search and display.  Each
+ * result is printed as a line of comma separated values:
+ *
+ *     benchmark,storage,size,operations,ns_per_operation
+ *
+ * where size is the size of the text in bytes, or the distance moved for
+ * gap_buffer_move_gap.  The text is generated from a fixed seed so runs are
+ * comparable.
+ *
+ * Usage: red-bench [--max-size BYTES[K|M|G]] [--filter SUBSTRING]
+ */
+
+using Clock = std::chrono::steady_clock;
+
+#if defined(RED_PIECE_TABLE)
+static const char* const storage_name = "piece_table";
+#elif defined(RED_CHUNKED_GAP_BUFFER)
+static const char* const storage_name = "chunked_gap_buffer";
+#else
+static const char* const storage_name = "gap_buffer";
+#endif
+
+// Each benchmark runs for at least this long, unless it runs out of operations
+static const Clock::duration time_budget = std::chrono::milliseconds(200);
+
+static std::string filter;
+
+// Results are stored here so the work producing them isn't optimised away
+static volatile std::size_t sink;
+
+static bool selected(const char* name)
+{
+	return filter.empty() || std::strstr(name, filter.c_str()) != nullptr;
+}
+
+/*
+ * Runs op(i) in doubling batches until the time budget or `max_operations`
+ * is used up and prints the mean time per operation.
+ */
+template <typename F>
+// requires Procedure(F, std::size_t)
+static void measure(const char* name, std::size_t size, std::size_t max_operations, F op)
+{
+	std::size_t done = 0;
+	std::size_t batch = 1;
+	Clock::duration elapsed{};
+	while (elapsed < time_budget && done < max_operations) {
+		batch = std::min(batch, max_operations - done);
+		Clock::time_point start = Clock::now();
+		for (std::size_t i = 0; i < batch; ++i)
+			op(done + i);
+		elapsed += Clock::now() - start;
+		done += batch;
+		batch *= 2;
+	}
+	double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+	std::printf("%s,%s,%zu,%zu,%.2f\n", name, storage_name, size, done, ns / done);
+	std::fflush(stdout);
+}
+
+/*
+ * Lines of words of random length with the odd tab, about 40 bytes a line
+ */
+static std::string generate_text(std::size_t size)
+{
+	std::mt19937_64 random(42);
+	std::string text;
+	text.reserve(size);
+	while (text.size() < size) {
+		if (random() % 16 == 0)
+			text += '\t';
+		for (int words = random() % 8; words >= 0 && text.size() < size; --words) {
+			for (int n = 1 + random() % 7; n > 0; --n)
+				text += static_cast<char>('a' + random() % 26);
+			text += ' ';
+		}
+		text.back() = '\n';
+	}
+	text.resize(size);
+	return text;
+}
+
+static Gap_buffer make_gap_buffer(const std::string& text)
+{
+	Gap_buffer buffer;
+	buffer.insert(buffer.end(), std::string_view(text));
+	return buffer;
+}
+
+static void bench_gap_buffer(const std::string& text)
+{
+	std::size_t size = text.size();
+	std::mt19937_64 random(7);
+
+	if (selected("gap_buffer_insert_sequential")) {
+		Gap_buffer buffer = make_gap_buffer(text);
+		std::size_t position = size / 2;
+		measure("gap_buffer_insert_sequential", size, 1 << 24, [&] (std::size_t) {
+			buffer.insert(buffer.begin() + position++, 1, 'x');
+		});
+	}
+
+	if (selected("gap_buffer_insert_random")) {
+		Gap_buffer buffer = make_gap_buffer(text);
+		measure("gap_buffer_insert_random", size, 1 << 20, [&] (std::size_t) {
+			buffer.insert(buffer.begin() + random() % (buffer.size() + 1), 1, 'x');
+		});
+	}
+
+	if (selected("gap_buffer_erase_sequential")) {
+		Gap_buffer buffer = make_gap_buffer(text);
+		measure("gap_buffer_erase_sequential", size, size / 2, [&] (std::size_t) {
+			buffer.erase(buffer.begin() + size / 4, 1);
+		});
+	}
+
+	if (selected("gap_buffer_erase_random")) {
+		Gap_buffer buffer = make_gap_buffer(text);
+		measure("gap_buffer_erase_random", size, size / 2, [&] (std::size_t) {
+			buffer.erase(buffer.begin() + random() % buffer.size(), 1);
+		});
+	}
+
+	// An insert alternating between two positions moves the gap the
+	// distance between them every time
+	if (selected("gap_buffer_move_gap")) {
+		Gap_buffer buffer = make_gap_buffer(text);
+		for (std::size_t distance = 1; distance < size; distance *= 32) {
+			measure("gap_buffer_move_gap", distance, 1 << 20, [&] (std::size_t i) {
+				std::size_t position = i % 2 == 0 ? 0 : distance;
+				buffer.insert(buffer.begin() + position, 1, 'x');
+			});
+		}
+	}
+}
+
+/*
+ * A growth policy that allocates exactly the size needed, as the gap buffer
+ * once did
+ */
+struct Exact_growth {
+	static std::size_t grow(std::size_t, std::size_t required)
+	{
+		return required;
+	}
+
+	static std::size_t shrink(std::size_t capacity, std::size_t)
+	{
+		return capacity;
+	}
+};
+
+template <typename Growth>
+static void bench_append(const char* name, std::size_t size)
+{
+	if (!selected(name))
+		return;
+	Basic_gap_buffer<char, std::allocator<char>, Growth> buffer;
+	measure(name, size, size, [&] (std::size_t) {
+		buffer.insert(buffer.end(), 1, 'a');
+	});
+}
+
+static void bench_traversal(Buffer& buffer)
+{
+	std::size_t size = buffer.contents.size();
+
+	if (selected("indexed_iterator_traversal")) {
+		measure("indexed_iterator_traversal", size, 1 << 20, [&] (std::size_t) {
+			std::size_t lines = 0;
+			for (auto i = buffer.begin(); i != buffer.end(); ++i)
+				lines += *i == '\n';
+			sink = lines;
+		});
+	}
+
+	if (selected("segmented_count")) {
+		measure("segmented_count", size, 1 << 20, [&] (std::size_t) {
+			sink = count(buffer.begin(), buffer.end(), '\n');
+		});
+	}
+}
+
+/*
+ * Runs a command as evaluate would, without the display refresh
+ */
+static void run(Command_function command, Editor_state& editor)
+{
+	bool should_exit = false;
+	command(editor, Key_input{}, should_exit, 0);
+}
+
+/*
+ * Runs a command that prompts, answering with `keys`
+ */
+static void run_answered(Command_function command, Editor_state& editor, const std::vector<Key_input>& keys)
+{
+	bool should_exit = false;
+	command(editor, Key_input{}, should_exit, 0);
+	for (const Key_input& key : keys)
+		prompt_key(editor, key, should_exit);
+}
+
+/*
+ * Hands `key` to evaluate, then the keys of the scripted input until the
+ * command has had all it needs
+ */
+static void run_keys(Editor_state& editor, Key_input key)
+{
+	evaluate(editor, key);
+	while (command_pending())
+		evaluate(editor, wait_for_key());
+}
+
+static void bench_motions(Editor_state& editor)
+{
+	Buffer& buffer = *editor.view.buffer;
+	std::size_t size = buffer.contents.size();
+	Buffer::size_type lines = buffer.line_count();
+	std::mt19937_64 random(11);
+	View& view = editor.view;
+
+	// Moving between lines keeps the column, measured through the column
+	// index
+	if (selected("forward_line")) {
+		view.cursor = buffer.begin();
+		measure("forward_line", size, lines - 1, [&] (std::size_t i) {
+			if (i % 64 == 0)
+				view.column_desired = -1;
+			run(forward_line, editor);
+		});
+	}
+
+	if (selected("backward_line")) {
+		view.cursor = buffer.end();
+		measure("backward_line", size, lines - 1, [&] (std::size_t i) {
+			if (i % 64 == 0)
+				view.column_desired = -1;
+			run(backward_line, editor);
+		});
+	}
+
+	if (selected("goto_line")) {
+		measure("goto_line", size, 1 << 20, [&] (std::size_t) {
+			bool should_exit = false;
+			goto_line(editor, Key_input{}, should_exit, static_cast<int>(1 + random() % lines));
+		});
+	}
+
+	if (selected("search_forward")) {
+		// The only match is at the end, so every search reads the whole text
+		buffer.insert(buffer.end(), std::string_view("needle!"));
+		std::vector<Key_input> keys;
+		std::string error;
+		parse_key_notation("needle!<CR>", keys, error);
+		measure("search_forward", size, 1 << 20, [&] (std::size_t) {
+			view.cursor = buffer.begin();
+			run_answered(search_forward, editor, keys);
+		});
+		buffer.erase(buffer.end() - 7, buffer.end());
+	}
+
+	if (selected("search_regex")) {
+		buffer.insert(buffer.end(), std::string_view("needle42!"));
+		std::vector<Key_input> keys;
+		std::string error;
+		parse_key_notation("ne+dle\\d+!<CR>", keys, error);
+		measure("search_regex", size, 1 << 20, [&] (std::size_t) {
+			view.cursor = buffer.begin();
+			run_answered(search_forward, editor, keys);
+		});
+		buffer.erase(buffer.end() - 9, buffer.end());
+	}
+
+	if (selected("search_backward")) {
+		buffer.insert(buffer.begin(), std::string_view("needle!"));
+		std::vector<Key_input> keys;
+		std::string error;
+		parse_key_notation("needle!<CR>", keys, error);
+		measure("search_backward", size, 1 << 20, [&] (std::size_t) {
+			view.cursor = buffer.end();
+			run_answered(search_backward, editor, keys);
+		});
+		buffer.erase(buffer.begin(), buffer.begin() + 7);
+	}
+}
+
+static void bench_display(Editor_state& editor)
+{
+	Buffer& buffer = *editor.view.buffer;
+	std::size_t size = buffer.contents.size();
+	Buffer::size_type lines = buffer.line_count();
+	std::mt19937_64 random(13);
+	View& view = editor.view;
+
+	if (selected("display_refresh_full")) {
+		measure("display_refresh_full", size, 1 << 20, [&] (std::size_t) {
+			view.cursor = buffer.line_begin(random() % lines);
+			display_invalidate();
+			display_refresh(view);
+		});
+	}
+
+	if (selected("display_refresh_scroll")) {
+		view.cursor = buffer.begin();
+		display_refresh(view);
+		measure("display_refresh_scroll", size, lines - 1, [&] (std::size_t) {
+			run(forward_line, editor);
+			display_refresh(view);
+		});
+	}
+
+	if (selected("display_refresh_typing")) {
+		view.cursor = buffer.line_begin(lines / 2);
+		display_refresh(view);
+		measure("display_refresh_typing", size, 1 << 20, [&] (std::size_t) {
+			buffer.insert(view.cursor, 'x');
+			++view.cursor;
+			display_refresh(view);
+		});
+	}
+
+	// A line typed a key at a time, repainting after each, and the same
+	// line pasted, repainting once it's in
+	for (bool typeahead : { false, true }) {
+		const char* name = typeahead ? "insert_line_typeahead" : "insert_line_typed";
+		if (!selected(name))
+			continue;
+		std::vector<Key_input> keys;
+		std::string error;
+		parse_key_notation(std::string(64, 'x') + "<Esc>", keys, error);
+		view.cursor = buffer.line_begin(lines / 2);
+		display_refresh(view);
+		measure(name, size, 1 << 14, [&] (std::size_t) {
+			input_set_backend(scripted_input(keys, typeahead));
+			run_keys(editor, Key_input{ VkKeyScanA('i'), 'i' });
+		});
+	}
+
+	// 64 KB of lines pasted into a terminal with bracketed paste
+	if (selected("insert_paste")) {
+		std::vector<Key_input> keys;
+		for (char c : generate_text(64 * 1024)) {
+			if (c == '\n')
+				keys.push_back(Key_input{ VK_RETURN, '\r' });
+			else
+				keys.push_back(Key_input{ VkKeyScanA(c), c });
+		}
+		keys.push_back(Key_input{ KEY_PASTE_END, 0 });
+		view.cursor = buffer.line_begin(lines / 2);
+		display_refresh(view);
+		measure("insert_paste", size, 1 << 8, [&] (std::size_t) {
+			input_set_backend(scripted_input(keys, true));
+			run_keys(editor, Key_input{ KEY_PASTE_START, 0 });
+		});
+	}
+}
+
+/*
+ * The text joined into 16 lines, as in minified or generated files, moving
+ * and drawing deep into them goes through the column checkpoints
+ */
+static void bench_long_lines(Editor_state& editor, std::string text)
+{
+	std::size_t size = text.size();
+	std::size_t length = std::max<std::size_t>(size / 16, 1);
+	for (std::size_t i = 0; i < text.size(); ++i) {
+		if ((i + 1) % length == 0)
+			text[i] = '\n';
+		else if (text[i] == '\n')
+			text[i] = ' ';
+	}
+	Buffer::Buffer_storage contents;
+	contents.insert(contents.end(), std::string_view(text));
+	Buffer& buffer = *editor.view.buffer;
+	buffer = Buffer("bench", std::move(contents));
+	Buffer::size_type lines = buffer.line_count();
+	View& view = editor.view;
+
+	if (selected("long_line_vertical")) {
+		view.cursor = buffer.begin() + std::min<std::size_t>(length - length / 4, size);
+		view.column_desired = -1;
+		measure("long_line_vertical", size, 1 << 16, [&] (std::size_t i) {
+			run(i / (lines - 1) % 2 ? backward_line : forward_line, editor);
+		});
+	}
+
+	if (selected("long_line_display_refresh")) {
+		view.cursor = buffer.begin() + length / 2;
+		view.top_line = buffer.begin();
+		display_refresh(view);
+		measure("long_line_display_refresh", size, 1 << 16, [&] (std::size_t) {
+			if (view.cursor != buffer.end())
+				++view.cursor;
+			display_refresh(view);
+		});
+	}
+}
+
+static std::size_t parse_size(const char* text)
+{
+	char* end;
+	std::size_t size = std::strtoull(text, &end, 10);
+	switch (*end) {
+	case 'k': case 'K': size <<= 10; break;
+	case 'm': case 'M': size <<= 20; break;
+	case 'g': case 'G': size <<= 30; break;
+	}
+	return size;
+}
+
+int main(int argc, char** argv)
+{
+	std::size_t max_size = 32 << 20;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (std::strcmp(argv[i], "--max-size") == 0) {
+			max_size = parse_size(argv[i + 1]);
+		} else if (std::strcmp(argv[i], "--filter") == 0) {
+			filter = argv[i + 1];
+		} else {
+			std::fprintf(stderr, "Usage: red-bench [--max-size BYTES[K|M|G]] [--filter SUBSTRING]\n");
+			return 1;
+		}
+	}
+
+	screen_set_backend(headless_screen(160, 50));
+	input_set_backend(scripted_input({}));
+	screen_initialize();
+	input_initialize();
+
+	std::printf("benchmark,storage,size,operations,ns_per_operation\n");
+	for (std::size_t size = 1 << 10; size <= max_size; size *= 32) {
+		std::string text = generate_text(size);
+		bench_gap_buffer(text);
+		bench_append<Exact_growth>("gap_buffer_append_exact", std::min<std::size_t>(size, 1 << 20));
+		bench_append<Geometric_growth<>>("gap_buffer_append_geometric", size);
+
+		Editor_state editor;
+		editor_initialize(editor);
+		Buffer::Buffer_storage contents;
+		contents.insert(contents.end(), std::string_view(text));
+		text = std::string();
+		Buffer& buffer = *editor.view.buffer;
+		buffer = Buffer("bench", std::move(contents));
+		editor.view.cursor = buffer.begin();
+		editor.view.top_line = buffer.begin();
+
+		bench_traversal(buffer);
+		bench_motions(editor);
+		bench_display(editor);
+		bench_long_lines(editor, generate_text(size));
+	}
+}
@@ -0,0 +1,739 @@
+#include "regular_expression.h"
+#include "byte_search.h"
+#include <algorithm>
+#include <cassert>
+#include <map>
+#include <utility>
+
+/*
+ * Patterns compiling to more instructions than this are refused, it bounds
+ * the work done for each state and so each byte when the DFA cache thrashes
+ */
+static constexpr std::size_t max_instructions = 8000;
+static constexpr int max_repeat = 1000;
+static constexpr int unbounded = -1;
+
+namespace {
+
+struct Node {
+	enum class Kind {
+		empty,
+		set,
+		concat,
+		alternate,
+		repeat,
+		line_begin,
+		line_end
+	};
+
+	Kind kind = Kind::empty;
+	int set = -1;
+	int min = 0;
+	int max = 0;
+	std::vector<Node> children;
+};
+
+class Parser {
+	std::string_view pattern;
+	std::size_t i = 0;
+	std::vector<std::bitset<256>>& sets;
+
+public:
+	std::string error;
+
+	Parser(std::string_view pattern, std::vector<std::bitset<256>>& sets) :
+		pattern(pattern),
+		sets(sets)
+	{
+	}
+
+	bool parse(Node& node)
+	{
+		node = alternation();
+		if (error.empty() && i < pattern.size())
+			error = "Unmatched )";
+		return error.empty();
+	}
+
+private:
+	bool more() const
+	{
+		return i < pattern.size() && error.empty();
+	}
+
+	Node make_set(const std::bitset<256>& set)
+	{
+		Node node;
+		node.kind = Node::Kind::set;
+		node.set = static_cast<int>(sets.size());
+		sets.push_back(set);
+		return node;
+	}
+
+	Node alternation()
+	{
+		Node first = concatenation();
+		if (!more() || pattern[i] != '|')
+			return first;
+		Node node;
+		node.kind = Node::Kind::alternate;
+		node.children.push_back(std::move(first));
+		while (more() && pattern[i] == '|') {
+			++i;
+			node.children.push_back(concatenation());
+		}
+		return node;
+	}
+
+	Node concatenation()
+	{
+		Node node;
+		node.kind = Node::Kind::concat;
+		while (more() && pattern[i] != '|' && pattern[i] != ')')
+			node.children.push_back(repetition());
+		return node;
+	}
+
+	bool number(int& n)
+	{
+		std::size_t start = i;
+		n = 0;
+		while (i < pattern.size() && pattern[i] >= '0' && pattern[i] <= '9') {
+			n = n * 10 + (pattern[i++] - '0');
+			if (n > max_repeat) {
+				error = "Repeat count too large";
+				return false;
+			}
+		}
+		return i > start;
+	}
+
+	Node repetition()
+	{
+		Node node = atom();
+		while (more()) {
+			int min;
+			int max;
+			char c = pattern[i];
+			if (c == '*') {
+				min = 0;
+				max = unbounded;
+				++i;
+			} else if (c == '+') {
+				min = 1;
+				max = unbounded;
+				++i;
+			} else if (c == '?') {
+				min = 0;
+				max = 1;
+				++i;
+			} else if (c == '{') {
+				++i;
+				if (!number(min)) {
+					if (error.empty())
+						error = "Expected a count after {";
+					return node;
+				}
+				max = min;
+				if (i < pattern.size() && pattern[i] == ',') {
+					++i;
+					if (!number(max))
+						max = unbounded;
+				}
+				if (!error.empty())
+					return node;
+				if (i >= pattern.size() || pattern[i] != '}') {
+					error = "Expected }";
+					return node;
+				}
+				++i;
+				if (max != unbounded && max < min) {
+					error = "Bad repeat range";
+					return node;
+				}
+			} else {
+				break;
+			}
+			if (node.kind == Node::Kind::line_begin || node.kind == Node::Kind::line_end) {
+				error = "Nothing to repeat";
+				return node;
+			}
+			Node repeat;
+			repeat.kind = Node::Kind::repeat;
+			repeat.min = min;
+			repeat.max = max;
+			repeat.children.push_back(std::move(node));
+			node = std::move(repeat);
+		}
+		return node;
+	}
+
+	/*
+	 * The set for \d \w \s and their complements, which like [^...] never
+	 * match a line break
+	 */
+	static bool class_escape(char c, std::bitset<256>& set)
+	{
+		std::bitset<256> x;
+		switch (c) {
+		case 'd': case 'D':
+			for (int b = '0'; b <= '9'; ++b)
+				x.set(b);
+			break;
+		case 'w': case 'W':
+			for (int b = 0; b < 256; ++b)
+				x[b] = (b >= 'a' && b <= 'z') || (b >= 'A' && b <= 'Z') || (b >= '0' && b <= '9') || b == '_';
+			break;
+		case 's': case 'S':
+			for (char b : std::string_view(" \t\r\v\f"))
+				x.set(static_cast<unsigned char>(b));
+			break;
+		default:
+			return false;
+		}
+		if (c == 'D' || c == 'W' || c == 'S') {
+			x.flip();
+			x.reset('\n');
+		}
+		set = x;
+		return true;
+	}
+
+	static char escaped_byte(char c)
+	{
+		switch (c) {
+		case 'n': return '\n';
+		case 't': return '\t';
+		case 'r': return '\r';
+		case 'f': return '\f';
+		case 'v': return '\v';
+		}
+		return c;
+	}
+
+	Node atom()
+	{
+		char c = pattern[i++];
+		std::bitset<256> set;
+		switch (c) {
+		case '(': {
+			Node node = alternation();
+			if (error.empty() && (i >= pattern.size() || pattern[i] != ')'))
+				error = "Unmatched (";
+			++i;
+			return node;
+		}
+		case '^': {
+			Node node;
+			node.kind = Node::Kind::line_begin;
+			return node;
+		}
+		case '$': {
+			Node node;
+			node.kind = Node::Kind::line_end;
+			return node;
+		}
+		case '.':
+			set.set();
+			set.reset('\n');
+			return make_set(set);
+		case '[':
+			return bracket();
+		case '*': case '+': case '?': case '{':
+			error = "Nothing to repeat";
+			return Node();
+		case '\\':
+			if (i >= pattern.size()) {
+				error = "Trailing backslash";
+				return Node();
+			}
+			c = pattern[i++];
+			if (class_escape(c, set))
+				return make_set(set);
+			c = escaped_byte(c);
+			break;
+		}
+		set.set(static_cast<unsigned char>(c));
+		return make_set(set);
+	}
+
+	Node bracket()
+	{
+		std::bitset<256> set;
+		bool negate = i < pattern.size() && pattern[i] == '^';
+		if (negate)
+			++i;
+		bool first = true;
+		while (true) {
+			if (i >= pattern.size()) {
+				error = "Unmatched [";
+				return Node();
+			}
+			char c = pattern[i++];
+			if (c == ']' && !first)
+				break;
+			first = false;
+			if (c == '\\' && i < pattern.size()) {
+				std::bitset<256> x;
+				if (class_escape(pattern[i], x)) {
+					set |= x;
+					++i;
+					continue;
+				}
+				c = escaped_byte(pattern[i++]);
+			}
+			auto low = static_cast<unsigned char>(c);
+			auto high = low;
+			if (i + 1 < pattern.size() && pattern[i] == '-' && pattern[i + 1] != ']') {
+				char d = pattern[i + 1];
+				i += 2;
+				if (d == '\\' && i < pattern.size())
+					d = escaped_byte(pattern[i++]);
+				high = static_cast<unsigned char>(d);
+				if (high < low) {
+					error = "Bad range in []";
+					return Node();
+				}
+			}
+			for (int b = low; b <= high; ++b)
+				set.set(b);
+		}
+		if (negate) {
+			set.flip();
+			set.reset('\n');
+		}
+		return make_set(set);
+	}
+};
+
+class Compiler {
+	Regex_program& program;
+
+	bool emit(Regex_program::Op op, int x = 0, int y = 0)
+	{
+		if (program.code.size() >= max_instructions)
+			return false;
+		program.code.push_back({ op, x, y });
+		return true;
+	}
+
+	int pc() const
+	{
+		return static_cast<int>(program.code.size());
+	}
+
+public:
+	explicit Compiler(Regex_program& program) :
+		program(program)
+	{
+	}
+
+	bool compile(const Node& node)
+	{
+		using Op = Regex_program::Op;
+		switch (node.kind) {
+		case Node::Kind::empty:
+			return true;
+		case Node::Kind::set:
+			return emit(Op::byte, node.set);
+		case Node::Kind::line_begin:
+			return emit(Op::line_begin);
+		case Node::Kind::line_end:
+			return emit(Op::line_end);
+		case Node::Kind::concat:
+			for (const Node& child : node.children) {
+				if (!compile(child))
+					return false;
+			}
+			return true;
+		case Node::Kind::alternate: {
+			// split L1, next; L1: child; jump end; next: split ...
+			std::vector<int> jumps;
+			for (std::size_t k = 0; k < node.children.size(); ++k) {
+				int split = pc();
+				bool last = k + 1 == node.children.size();
+				if (!last && !emit(Op::split, split + 1))
+					return false;
+				if (!compile(node.children[k]))
+					return false;
+				if (!last) {
+					jumps.push_back(pc());
+					if (!emit(Op::jump))
+						return false;
+					program.code[split].y = pc();
+				}
+			}
+			for (int jump : jumps)
+				program.code[jump].x = pc();
+			return true;
+		}
+		case Node::Kind::repeat: {
+			const Node& child = node.children[0];
+			for (int k = 0; k < node.min; ++k) {
+				if (!compile(child))
+					return false;
+			}
+			if (node.max == unbounded) {
+				// loop: split body, end; body: child; jump loop
+				int loop = pc();
+				if (!emit(Op::split, loop + 1) || !compile(child) || !emit(Op::jump, loop))
+					return false;
+				program.code[loop].y = pc();
+				return true;
+			}
+			// Each optional copy may skip to the end
+			std::vector<int> splits;
+			for (int k = node.min; k < node.max; ++k) {
+				splits.push_back(pc());
+				if (!emit(Op::split, pc() + 1) || !compile(child))
+					return false;
+			}
+			for (int split : splits)
+				program.code[split].y = pc();
+			return true;
+		}
+		}
+		return false;
+	}
+};
+
+/*
+ * The pattern matching the reverse of the text `node` matches, line begin
+ * and end swap over
+ */
+Node reverse(const Node& node)
+{
+	Node result = node;
+	switch (node.kind) {
+	case Node::Kind::line_begin:
+		result.kind = Node::Kind::line_end;
+		break;
+	case Node::Kind::line_end:
+		result.kind = Node::Kind::line_begin;
+		break;
+	case Node::Kind::concat:
+		std::reverse(result.children.begin(), result.children.end());
+		[[fallthrough]];
+	default:
+		for (Node& child : result.children)
+			child = reverse(child);
+		break;
+	}
+	return result;
+}
+
+/*
+ * Appends the bytes `node` matches to `text` if it matches one fixed string
+ */
+bool literal_text(const Node& node, const std::vector<std::bitset<256>>& sets, std::string& text)
+{
+	switch (node.kind) {
+	case Node::Kind::empty:
+		return true;
+	case Node::Kind::set:
+		if (sets[node.set].count() != 1)
+			return false;
+		for (int b = 0; b < 256; ++b) {
+			if (sets[node.set][b])
+				text += static_cast<char>(b);
+		}
+		return true;
+	case Node::Kind::concat:
+		for (const Node& child : node.children) {
+			if (!literal_text(child, sets, text))
+				return false;
+		}
+		return true;
+	default:
+		return false;
+	}
+}
+
+}
+
+bool compile_regex(std::string_view pattern, Regex& regex, std::string& error)
+{
+	Regex_program program;
+	Node node;
+	Parser parser(pattern, program.sets);
+	if (!parser.parse(node)) {
+		error = parser.error;
+		return false;
+	}
+
+	Regex result;
+	result.text = pattern;
+	for (const auto& set : program.sets)
+		result.newline = result.newline || set['\n'];
+	std::string literal;
+	if (literal_text(node, program.sets, literal)) {
+		result.literal = Literal_pattern(literal);
+		regex = std::move(result);
+		return true;
+	}
+	result.is_literal = false;
+
+	Regex_program reversed;
+	reversed.sets = program.sets;
+	if (!Compiler(program).compile(node) || !Compiler(reversed).compile(reverse(node))) {
+		error = "Pattern too large";
+		return false;
+	}
+	program.code.push_back({ Regex_program::Op::match, 0, 0 });
+	reversed.code.push_back({ Regex_program::Op::match, 0, 0 });
+
+	// Bytes no set tells apart share a class, line breaks are always their
+	// own for the assertions
+	std::array<std::uint8_t, 256> classes{};
+	int class_count = 1;
+	std::bitset<256> newline;
+	newline.set('\n');
+	std::vector<const std::bitset<256>*> partitions{ &newline };
+	for (const auto& set : program.sets)
+		partitions.push_back(&set);
+	for (const std::bitset<256>* set : partitions) {
+		std::map<std::pair<int, bool>, int> split;
+		for (int b = 0; b < 256; ++b) {
+			auto key = std::make_pair(static_cast<int>(classes[b]), static_cast<bool>((*set)[b]));
+			auto inserted = split.emplace(key, static_cast<int>(split.size()));
+			classes[b] = static_cast<std::uint8_t>(inserted.first->second);
+		}
+		class_count = static_cast<int>(split.size());
+	}
+
+	result.forward = Lazy_dfa(std::move(program), classes, class_count, true, true);
+	result.reverse_unanchored = Lazy_dfa(reversed, classes, class_count, true, false);
+	result.reverse_anchored = Lazy_dfa(std::move(reversed), classes, class_count, false, false);
+	regex = std::move(result);
+	return true;
+}
+
+std::size_t Lazy_dfa::Key_hash::operator()(const std::vector<int>& key) const
+{
+	std::size_t hash = 14695981039346656037ull;
+	for (int x : key) {
+		hash ^= static_cast<unsigned>(x);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+Lazy_dfa::Lazy_dfa(Regex_program program, const std::array<std::uint8_t, 256>& classes, int class_count, bool unanchored, bool leftmost) :
+	program(std::move(program)),
+	unanchored(unanchored),
+	leftmost(leftmost),
+	classes(classes),
+	representatives(class_count),
+	// Two more for the end of the text, followed by a line break or not
+	stride(class_count + 2),
+	visited(this->program.code.size()),
+	stepped(this->program.code.size())
+{
+	for (int b = 255; b >= 0; --b)
+		representatives[classes[b]] = static_cast<unsigned char>(b);
+	for (const auto& instruction : this->program.code)
+		line_begins = line_begins || instruction.op == Regex_program::Op::line_begin;
+	reset();
+}
+
+// The flags at the end of a key
+static constexpr int line_start_flag = 1;
+static constexpr int starting_flag = 2;
+
+int Lazy_dfa::intern(std::vector<int> key)
+{
+	auto found = ids.find(key);
+	if (found != ids.end())
+		return found->second;
+	int id = static_cast<int>(keys.size());
+	memory += 2 * key.size() * sizeof(int) + stride * sizeof(int) + 64;
+	keys.push_back(key);
+	ids.emplace(std::move(key), id * stride);
+	table.resize(table.size() + stride, unknown);
+	return id * stride;
+}
+
+void Lazy_dfa::reset()
+{
+	keys.clear();
+	ids.clear();
+	table.clear();
+	memory = 0;
+	accelerated_state = -1;
+	int id = intern({ 0 });
+	assert(id == dead);
+	(void)id;
+	states_at_reset = keys.size();
+}
+
+void Lazy_dfa::begin_search()
+{
+	scanned_at_reset = 0;
+	states_at_reset = keys.size();
+}
+
+int Lazy_dfa::start(bool line_start)
+{
+	if (memory > cache_budget / 2)
+		reset();
+	int state = intern({ 0, -1, (line_start && line_begins ? line_start_flag : 0) | (unanchored ? starting_flag : 0) });
+	if (unanchored && state != accelerated_state)
+		accelerate(state);
+	return state;
+}
+
+/*
+ * An unanchored search spends most of its time in the start state, which
+ * only leaves on bytes that can begin a match.  If just one byte does, the
+ * scan can skip to it with find_byte.
+ */
+void Lazy_dfa::accelerate(int state)
+{
+	accelerated_state = -1;
+	int escape = -1;
+	for (int byte_class = 0; byte_class < stride - 2; ++byte_class) {
+		int t = table[state + byte_class];
+		if (t == unknown)
+			t = compute(state, byte_class, 0);
+		if (t == state << 1)
+			continue;
+		int first = -1;
+		for (int b = 0; b < 256; ++b) {
+			if (classes[b] == byte_class) {
+				if (first != -1)
+					return;
+				first = b;
+			}
+		}
+		if (escape != -1)
+			return;
+		escape = first;
+	}
+	if (escape != -1) {
+		accelerated_state = state;
+		accelerated_byte = static_cast<char>(escape);
+	}
+}
+
+int Lazy_dfa::compute(int state, int byte_class, std::size_t scanned)
+{
+	if (memory > cache_budget) {
+		// Building a state every few bytes, the DFA is no faster than the
+		// NFA would be and the text could be gigabytes
+		if (scanned - scanned_at_reset < 10 * (keys.size() - states_at_reset))
+			return gave_up;
+		std::vector<int> key = keys[state / stride];
+		reset();
+		state = intern(std::move(key));
+		scanned_at_reset = scanned;
+	}
+
+	using Op = Regex_program::Op;
+	const std::vector<int> key = keys[state / stride];
+	int flags = key.back();
+	bool line_start = flags & line_start_flag;
+	bool starting = flags & starting_flag;
+	bool at_end = byte_class >= stride - 2;
+	bool line_end = at_end ? byte_class == stride - 2 : representatives[byte_class] == '\n';
+	unsigned char c = at_end ? 0 : representatives[byte_class];
+
+	if (++stamp == 0) {
+		std::fill(visited.begin(), visited.end(), 0);
+		std::fill(stepped.begin(), stepped.end(), 0);
+		stamp = 1;
+	}
+
+	std::vector<int> next;
+	std::vector<int> stack;
+	std::vector<int> group;
+	bool matched = false;
+	for (std::size_t k = 0; k + 1 < key.size(); ++k) {
+		// Follow the group's threads to the byte instructions they wait on
+		bool group_matched = false;
+		std::size_t group_start = next.size();
+		for (; key[k] != -1; ++k)
+			stack.push_back(key[k]);
+		group.clear();
+		while (!stack.empty()) {
+			int pc = stack.back();
+			stack.pop_back();
+			if (visited[pc] == stamp)
+				continue;
+			visited[pc] = stamp;
+			const Regex_program::Instruction& instruction = program.code[pc];
+			switch (instruction.op) {
+			case Op::byte:
+				group.push_back(pc);
+				break;
+			case Op::split:
+				stack.push_back(instruction.y);
+				stack.push_back(instruction.x);
+				break;
+			case Op::jump:
+				stack.push_back(instruction.x);
+				break;
+			case Op::line_begin:
+				if (line_start)
+					stack.push_back(pc + 1);
+				break;
+			case Op::line_end:
+				if (line_end)
+					stack.push_back(pc + 1);
+				break;
+			case Op::match:
+				group_matched = true;
+				break;
+			}
+		}
+
+		if (!at_end) {
+			for (int pc : group) {
+				if (program.sets[program.code[pc].x][c] && stepped[pc + 1] != stamp) {
+					stepped[pc + 1] = stamp;
+					next.push_back(pc + 1);
+				}
+			}
+		}
+		if (leftmost && next.size() > group_start) {
+			std::sort(next.begin() + group_start, next.end());
+			next.push_back(-1);
+		}
+
+		if (group_matched) {
+			matched = true;
+			// Later groups started after this match, so can't be leftmost
+			if (leftmost) {
+				starting = false;
+				break;
+			}
+		}
+	}
+
+	if (!leftmost && !next.empty()) {
+		std::sort(next.begin(), next.end());
+		next.push_back(-1);
+	}
+	if (starting && !at_end) {
+		// The thread starting at the next byte, last in priority
+		if (leftmost) {
+			if (stepped[0] != stamp) {
+				next.push_back(0);
+				next.push_back(-1);
+			}
+		} else if (next.empty()) {
+			next.push_back(0);
+			next.push_back(-1);
+		} else if (!std::binary_search(next.begin(), next.end() - 1, 0)) {
+			next.insert(std::lower_bound(next.begin(), next.end() - 1, 0), 0);
+		}
+	}
+
+	int target = dead;
+	if (!next.empty() && !at_end) {
+		next.push_back((c == '\n' && line_begins ? line_start_flag : 0) | (starting ? starting_flag : 0));
+		target = intern(std::move(next));
+	}
+	int t = target << 1 | (matched ? 1 : 0);
+	table[state + byte_class] = t;
+	return t;
+}
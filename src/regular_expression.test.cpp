@@ -0,0 +1,228 @@
+#include "regular_expression.h"
+#include "chunked_gap_buffer.h"
+#include "gap_buffer.h"
+#include "piece_table.h"
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <regex>
+#include <string>
+
+static std::string random_text(std::size_t n)
+{
+	std::string text(n, 0);
+	for (char& c : text)
+		c = "aab\n"[std::rand() % 4];
+	return text;
+}
+
+/*
+ * A pattern std::regex reads the same way, without anchors so the context
+ * doesn't matter.  Groups aren't starred, std::regex backtracks for ever on
+ * nested stars.
+ */
+static std::string random_pattern(int depth)
+{
+	static const char* const atoms[] = { "a", "b", ".", "[ab]", "ab", "ba" };
+	static const char* const quantifiers[] = { "", "", "", "*", "+", "?", "{1,2}", "{2}" };
+	static const char* const group_quantifiers[] = { "", "?", "{1,2}" };
+	std::string pattern;
+	for (int n = 1 + std::rand() % 3; n > 0; --n) {
+		if (depth > 0 && std::rand() % 4 == 0) {
+			pattern += "(" + random_pattern(depth - 1) + "|" + random_pattern(depth - 1) + ")";
+			pattern += group_quantifiers[std::rand() % 3];
+		} else {
+			pattern += atoms[std::rand() % 6];
+			pattern += quantifiers[std::rand() % 8];
+		}
+	}
+	return pattern;
+}
+
+/*
+ * Where the leftmost match at or after `from` starts, or npos
+ */
+static std::size_t expected_forward(const std::regex& re, const std::string& text, std::size_t from)
+{
+	std::smatch match;
+	if (!std::regex_search(text.begin() + from, text.end(), match, re))
+		return std::string::npos;
+	return from + match.position(0);
+}
+
+/*
+ * Where the last match starting before `before` starts, or npos
+ */
+static std::size_t expected_backward(const std::regex& re, const std::string& text, std::size_t before)
+{
+	std::smatch match;
+	for (std::size_t s = before; s > 0; --s) {
+		if (std::regex_search(text.begin() + (s - 1), text.end(), match, re, std::regex_constants::match_continuous))
+			return s - 1;
+	}
+	return std::string::npos;
+}
+
+template <typename I>
+// requires SegmentedIterator(I)
+static void check_against_std_regex(I first, I last, const std::string& text)
+{
+	for (int k = 0; k < 300; ++k) {
+		std::string pattern = random_pattern(2);
+		Regex regex;
+		std::string error;
+		assert(compile_regex(pattern, regex, error));
+		std::regex re(pattern);
+
+		std::size_t from = std::rand() % (text.size() + 1);
+		I match;
+		Regex_status status = find_regex(regex, first, first + from, last, match);
+		std::size_t expected = expected_forward(re, text, from);
+		assert(status != Regex_status::too_complex);
+		assert((status == Regex_status::match) == (expected != std::string::npos));
+		if (status == Regex_status::match)
+			assert(static_cast<std::size_t>(match - first) == expected);
+
+		// The search repeats with the DFA states built already
+		if (from > 0) {
+			status = find_regex(regex, first, first + from - 1, last, match);
+			expected = expected_forward(re, text, from - 1);
+			assert((status == Regex_status::match) == (expected != std::string::npos));
+			if (status == Regex_status::match)
+				assert(static_cast<std::size_t>(match - first) == expected);
+		}
+
+		status = find_regex_backward(regex, first, first + from, last, match);
+		expected = expected_backward(re, text, from);
+		assert((status == Regex_status::match) == (expected != std::string::npos));
+		if (status == Regex_status::match)
+			assert(static_cast<std::size_t>(match - first) == expected);
+	}
+}
+
+static std::size_t find_in(const std::string& pattern, const std::string& text, std::size_t from = 0)
+{
+	Regex regex;
+	std::string error;
+	assert(compile_regex(pattern, regex, error));
+	const char* match;
+	if (find_regex(regex, text.data(), text.data() + from, text.data() + text.size(), match) != Regex_status::match)
+		return std::string::npos;
+	return match - text.data();
+}
+
+static std::size_t find_backward_in(const std::string& pattern, const std::string& text, std::size_t before)
+{
+	Regex regex;
+	std::string error;
+	assert(compile_regex(pattern, regex, error));
+	const char* match;
+	if (find_regex_backward(regex, text.data(), text.data() + before, text.data() + text.size(), match) != Regex_status::match)
+		return std::string::npos;
+	return match - text.data();
+}
+
+static void check_syntax()
+{
+	const std::string text = "int x = 42;\nfoo(bar_1)\n\tERROR 404: not found\nend";
+	assert(find_in("^foo", text) == 12);
+	assert(find_in("^f", text, 13) == std::string::npos);
+	assert(find_in("x$", text) == std::string::npos);
+	assert(find_in("\\)$", text) == 21);
+	assert(find_in("d$", text) == 43);
+	assert(find_in("^$", "a\n\nb") == 2);
+	assert(find_in("\\d+", text) == 8);
+	assert(find_in("\\d{3}", text) == 30);
+	assert(find_in("[A-Z]+ \\d", text) == 24);
+	assert(find_in("\\w+\\(", text) == 12);
+	assert(find_in("[^a-z =]", text) == 8);
+	assert(find_in("\\s\\S", text) == 3);
+	assert(find_in("x|bar|404", text) == 4);
+	assert(find_in("(ba|fo)+o", text) == 12);
+	assert(find_in(";\\nf", text) == 10);
+	assert(find_in("[\\n]\\t", text) == 22);
+	assert(find_in("a.b", "a\nb axb") == 4);
+	assert(find_in("foo", text) == 12);
+	assert(find_in("f\\.o", "foo f.o") == 4);
+
+	// The leftmost match, not the first to end
+	assert(find_in("abcd|c", "xabcd") == 1);
+	assert(find_in("b+|ab", "aabbb") == 1);
+
+	assert(find_backward_in("o+", text, text.size()) == 40);
+	assert(find_backward_in("^\\w", text, 48) == 45);
+	assert(find_backward_in("^\\w", text, 44) == 12);
+	assert(find_backward_in("\\d+", text, 31) == 30);
+	assert(find_backward_in("x =", text, 4) == std::string::npos);
+	assert(find_backward_in("x =", text, 5) == 4);
+
+	Regex regex;
+	std::string error;
+	assert(compile_regex("[a-z]*", regex, error) && !regex.is_literal_pattern());
+	assert(compile_regex("foo\\.bar", regex, error) && regex.is_literal_pattern());
+	assert(regex.literal_pattern().pattern() == "foo.bar");
+	assert(!regex.matches_newline());
+	assert(compile_regex("a\\nb", regex, error) && regex.matches_newline());
+
+	const char* const malformed[] = { "(a", "a)", "[ab", "*a", "a{2", "a{3,1}", "a{1001}", "\\", "^*", "(|+)" };
+	for (const char* pattern : malformed) {
+		error.clear();
+		assert(!compile_regex(pattern, regex, error));
+		assert(!error.empty());
+	}
+	assert(!compile_regex("((a{1000}){1000}){1000}", regex, error));
+	assert(error == "Pattern too large");
+}
+
+static void check_pathological()
+{
+	using Clock = std::chrono::steady_clock;
+
+	// Backtracking engines take exponential time on these
+	std::string text(1 << 20, 'a');
+	Clock::time_point start = Clock::now();
+	assert(find_in("(a|aa)*b", text) == std::string::npos);
+	assert(find_in("(a*)*b", text) == std::string::npos);
+	assert(find_in("(x+x+)+y", text) == std::string::npos);
+
+	// The DFA for this has 2^16 states, random text reaches most of them,
+	// so the search either finds the match or gives up quickly
+	std::string random(8 << 20, 0);
+	for (char& c : random)
+		c = "ab"[std::rand() % 2];
+	Regex regex;
+	std::string error;
+	assert(compile_regex("a[ab]{15}c", regex, error));
+	const char* first = random.data();
+	const char* match;
+	Regex_status status = find_regex(regex, first, first, first + random.size(), match);
+	assert(status != Regex_status::match);
+	assert(std::chrono::duration_cast<std::chrono::seconds>(Clock::now() - start).count() < 20);
+}
+
+int main()
+{
+	check_syntax();
+
+	std::string text = random_text(300);
+	const char* data = text.data();
+	check_against_std_regex(data, data + text.size(), text);
+
+	Gap_buffer x;
+	x.insert(x.end(), std::string_view(text));
+	x.insert(x.begin() + 150, 1, 0);
+	x.erase(x.begin() + 150, 1);
+	check_against_std_regex(x.begin(), x.end(), text);
+
+	// Single byte pieces, so every match crosses segments
+	Piece_table y(text);
+	for (int k = 0; k < 100; ++k) {
+		std::size_t i = std::rand() % (y.size() + 1);
+		char c = "ab\n"[std::rand() % 3];
+		y.insert(y.begin() + i, 1, c);
+		text.insert(text.begin() + i, c);
+	}
+	check_against_std_regex(y.begin(), y.end(), text);
+
+	check_pathological();
+}
@@ -0,0 +1,160 @@
+#include "replay.h"
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+#include "command.h"
+#include "display.h"
+#include "editor.h"
+#include "file.h"
+#include "headless.h"
+#include "key_notation.h"
+#include "latency.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Command_time {
+	std::size_t calls = 0;
+	Clock::duration self{};
+	Clock::duration total{};
+};
+
+struct Running_command {
+	const char* name;
+	Clock::time_point start;
+	Clock::duration children;
+};
+
+static std::map<std::string, Command_time> command_times;
+static std::vector<Running_command> running;
+
+/*
+ * Commands nest, a command's self time excludes the commands it ran
+ */
+static void trace_command(const char* name, bool done)
+{
+	Clock::time_point now = Clock::now();
+	if (!done) {
+		running.push_back({ name, now, Clock::duration{} });
+		return;
+	}
+
+	Running_command command = running.back();
+	running.pop_back();
+	Clock::duration elapsed = now - command.start;
+	Command_time& time = command_times[command.name];
+	++time.calls;
+	time.total += elapsed;
+	time.self += elapsed - command.children;
+	if (!running.empty())
+		running.back().children += elapsed;
+}
+
+/*
+ * 64 bit FNV-1a of the buffer's text
+ */
+static std::uint64_t hash_text(const Buffer::Buffer_storage& text)
+{
+	std::uint64_t hash = 0xcbf29ce484222325;
+	for (Buffer::size_type i = 0; i < text.size();) {
+		std::string_view segment = text.segment_from(i);
+		for (char c : segment) {
+			hash ^= static_cast<unsigned char>(c);
+			hash *= 0x100000001b3;
+		}
+		i += segment.size();
+	}
+	return hash;
+}
+
+static double milliseconds(Clock::duration duration)
+{
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+static void report(std::size_t keys, Clock::duration elapsed, const Buffer& buffer)
+{
+	double total = milliseconds(elapsed);
+	std::printf("keys %zu\n", keys);
+	std::printf("total %.3f ms, %.0f keys/s\n", total, total > 0 ? keys / total * 1000 : 0.0);
+
+	std::vector<std::pair<std::string, Command_time>> times(command_times.begin(), command_times.end());
+	std::sort(times.begin(), times.end(), [] (const auto& a, const auto& b) {
+		return a.second.self > b.second.self;
+	});
+	std::printf("%-24s %10s %12s %12s %10s\n", "command", "calls", "self ms", "total ms", "mean us");
+	for (const auto& [name, time] : times) {
+		double self = milliseconds(time.self);
+		std::printf("%-24s %10zu %12.3f %12.3f %10.2f\n", name.c_str(), time.calls, self,
+			    milliseconds(time.total), self * 1000 / time.calls);
+	}
+
+	std::printf("written %zu cells\n", headless_screen_written());
+	std::printf("size %zu bytes, %zu lines\n", static_cast<std::size_t>(buffer.contents.size()),
+		    static_cast<std::size_t>(buffer.line_count()));
+	std::printf("hash %016" PRIx64 "\n", hash_text(buffer.contents));
+	// Empty unless built with RED_LATENCY
+	std::fputs(latency_report().c_str(), stdout);
+}
+
+int replay(const char* trace_filename, const char* filename)
+{
+	std::ifstream trace(trace_filename, std::ios::binary);
+	if (!trace) {
+		std::fprintf(stderr, "red: can't read %s\n", trace_filename);
+		return 1;
+	}
+	std::string text((std::istreambuf_iterator<char>(trace)), std::istreambuf_iterator<char>());
+	std::vector<Key_input> keys;
+	std::string error;
+	if (!parse_key_notation(text, keys, error)) {
+		std::fprintf(stderr, "red: %s: %s\n", trace_filename, error.c_str());
+		return 1;
+	}
+	std::size_t key_count = keys.size();
+
+	// The size of a classic console
+	screen_set_backend(headless_screen(80, 25));
+	input_set_backend(scripted_input(std::move(keys)));
+	screen_initialize();
+	input_initialize();
+
+	Editor_state editor;
+	editor_initialize(editor);
+	DWORD last_error = file_open(filename, *editor.view.buffer);
+	if (last_error != 0) {
+		std::fprintf(stderr, "red: can't open %s (%lu)\n", filename, static_cast<unsigned long>(last_error));
+		return 1;
+	}
+	// Timings shouldn't depend on how far the file had been read
+	file_load_finish(*editor.view.buffer);
+
+	command_set_trace(trace_command);
+	Clock::time_point start = Clock::now();
+	display_refresh(editor.view);
+	// Once the script has run out every key is ESC, backing out of any mode
+	// or prompt it left
+	while (!scripted_input_finished() || command_pending()) {
+		if (evaluate(editor, wait_for_key()))
+			break;
+	}
+	file_save_wait();
+	Clock::duration elapsed = Clock::now() - start;
+	command_set_trace(nullptr);
+
+	std::string saved;
+	while (file_save_finished(saved, last_error)) {
+		if (last_error != 0)
+			std::fprintf(stderr, "red: error writing %s (%lu)\n", saved.c_str(), static_cast<unsigned long>(last_error));
+	}
+
+	input_finalize();
+	screen_finalize();
+	report(key_count, elapsed, *editor.view.buffer);
+	return 0;
+}
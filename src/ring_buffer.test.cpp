@@ -0,0 +1,64 @@
+#include "ring_buffer.h"
+#include <cassert>
+#include <deque>
+#include <thread>
+
+int main()
+{
+	Ring_buffer<int, 8> ring;
+	assert(ring.empty() && !ring.full() && ring.size() == 0);
+	assert(ring.capacity() == 8);
+
+	for (int i = 0; i < 8; ++i)
+		assert(ring.push(i));
+	assert(ring.full() && ring.size() == 8);
+	assert(!ring.push(8));
+	int x;
+	for (int i = 0; i < 8; ++i) {
+		assert(ring.pop(x));
+		assert(x == i);
+	}
+	assert(ring.empty());
+	assert(!ring.pop(x));
+
+	// Wrapping around the slots many times over keeps the order
+	std::deque<int> expected;
+	unsigned random = 1;
+	for (int i = 0; i < 10000; ++i) {
+		random = random * 1103515245 + 12345;
+		if ((random >> 16) % 3 != 0) {
+			if (ring.push(i))
+				expected.push_back(i);
+			else
+				assert(expected.size() == 8);
+		} else if (ring.pop(x)) {
+			assert(x == expected.front());
+			expected.pop_front();
+		} else {
+			assert(expected.empty());
+		}
+		assert(ring.size() == expected.size());
+	}
+
+	ring.clear();
+	assert(ring.empty());
+	assert(ring.push(42) && ring.size() == 1);
+
+	// One thread pushing while another pops sees every element once, in order
+	static Ring_buffer<unsigned, 64> shared;
+	const unsigned count = 1000000;
+	std::thread producer([count] {
+		for (unsigned i = 0; i < count; ++i) {
+			while (!shared.push(i))
+				std::this_thread::yield();
+		}
+	});
+	for (unsigned i = 0; i < count; ++i) {
+		unsigned y;
+		while (!shared.pop(y))
+			std::this_thread::yield();
+		assert(y == i);
+	}
+	producer.join();
+	assert(shared.empty());
+}
@@ -1,85 +1,58 @@
 #include "screen.h"
 
-static HANDLE screen_handle;
+static const Screen_backend* backend = &terminal_screen;
+
+void screen_set_backend(const Screen_backend& screen_backend)
+{
+	backend = &screen_backend;
+}
 
 DWORD screen_initialize()
 {
-	DWORD last_error = 0;
-	screen_handle = CreateConsoleScreenBuffer(GENERIC_READ | GENERIC_WRITE,
-						  FILE_SHARE_WRITE,
-						  NULL,
-						  CONSOLE_TEXTMODE_BUFFER,
-						  NULL);
-	if (screen_handle != INVALID_HANDLE_VALUE) {
-		if (SetConsoleActiveScreenBuffer(screen_handle)) {
-		} else {
-			last_error = GetLastError();
-		}
-	} else {
-		last_error = GetLastError();
-	}
+	return backend->initialize();
+}
 
-	return last_error;
+void screen_finalize()
+{
+	backend->finalize();
 }
 
 Screen_dimension screen_dimension()
 {
-	CONSOLE_SCREEN_BUFFER_INFO csbi;
-	GetConsoleScreenBufferInfo(screen_handle, &csbi);
-	Screen_dimension dimension;
-	dimension.width = csbi.srWindow.Right - csbi.srWindow.Left + 1;
-	dimension.height = csbi.srWindow.Bottom - csbi.srWindow.Top + 1;
-	return dimension;
+	return backend->dimension();
+}
+
+void screen_putstring(std::string_view str)
+{
+	backend->putstring(str);
 }
 
 void screen_cursor(int column, int row)
 {
-	COORD position;
-	position.X = static_cast<SHORT>(column);
-	position.Y = static_cast<SHORT>(row);
-	SetConsoleCursorPosition(screen_handle, position);
+	backend->cursor(column, row);
 }
 
 void screen_column(int column)
 {
-	CONSOLE_SCREEN_BUFFER_INFO csbi;
-	GetConsoleScreenBufferInfo(screen_handle, &csbi);
-	csbi.dwCursorPosition.X = static_cast<SHORT>(column);
-	SetConsoleCursorPosition(screen_handle, csbi.dwCursorPosition);
+	backend->column(column);
 }
 
-void screen_cursor_style(Cursor_style style)
+void screen_clear_end_of_line()
 {
-	CONSOLE_CURSOR_INFO cursor_info;
-	if (style == Cursor_style::block)
-		cursor_info.dwSize = 100;
-	else
-		cursor_info.dwSize = 1;
-	cursor_info.bVisible = true;
-	SetConsoleCursorInfo(screen_handle, &cursor_info);
+	backend->clear_end_of_line();
 }
 
-void screen_putstring(std::string_view str)
+void screen_cursor_style(Cursor_style style)
 {
-	DWORD length = static_cast<DWORD>(str.size());
-	DWORD chars_written;
-	WriteConsole(screen_handle, str.data(), length, &chars_written, nullptr);
+	backend->cursor_style(style);
 }
 
-void screen_clear_end_of_line()
+void screen_cursor_visible(bool visible)
 {
-	CONSOLE_SCREEN_BUFFER_INFO csbi;
-	GetConsoleScreenBufferInfo(screen_handle, &csbi);
-	COORD position = csbi.dwCursorPosition;
-	DWORD width = csbi.srWindow.Right - csbi.srWindow.Left + 1;
-	DWORD chars_written;
-	FillConsoleOutputCharacterA(screen_handle, ' ', width - position.X, position, &chars_written);
+	backend->cursor_visible(visible);
 }
 
-void screen_cursor_visible(bool visible)
+void screen_flush()
 {
-	CONSOLE_CURSOR_INFO cursor;
-	GetConsoleCursorInfo(screen_handle, &cursor);
-	cursor.bVisible = visible;
-	SetConsoleCursorInfo(screen_handle, &cursor);
+	backend->flush();
 }
@@ -0,0 +1,128 @@
+#include "screen.h"
+#include <cerrno>
+#include <string>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+/*
+ * Everything is written as ANSI escape sequences into `output`, which
+ * flush writes to the terminal with a single write.
+ */
+static std::string output;
+
+static void append_number(int n)
+{
+	char digits[16];
+	int i = sizeof(digits);
+	do {
+		digits[--i] = static_cast<char>('0' + n % 10);
+		n /= 10;
+	} while (n != 0 && i > 0);
+	output.append(digits + i, sizeof(digits) - i);
+}
+
+static void flush()
+{
+	const char* data = output.data();
+	std::size_t remaining = output.size();
+	while (remaining > 0) {
+		ssize_t written = write(STDOUT_FILENO, data, remaining);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		data += written;
+		remaining -= written;
+	}
+	output.clear();
+}
+
+static DWORD initialize()
+{
+	if (!isatty(STDOUT_FILENO))
+		return ENOTTY;
+	// Switch to the alternate screen so the shell's screen is restored on exit
+	output += "\x1b[?1049h\x1b[H\x1b[2J";
+	flush();
+	return 0;
+}
+
+static void finalize()
+{
+	output += "\x1b[0 q\x1b[?25h\x1b[?1049l";
+	flush();
+}
+
+static Screen_dimension dimension()
+{
+	Screen_dimension dimension{ 80, 24 };
+	winsize size;
+	if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_col > 0 && size.ws_row > 0) {
+		dimension.width = size.ws_col;
+		dimension.height = size.ws_row;
+	}
+	return dimension;
+}
+
+static void cursor(int column, int row)
+{
+	output += "\x1b[";
+	append_number(row + 1);
+	output += ';';
+	append_number(column + 1);
+	output += 'H';
+}
+
+static void column(int column)
+{
+	output += "\x1b[";
+	append_number(column + 1);
+	output += 'G';
+}
+
+static void cursor_style(Cursor_style style)
+{
+	if (style == Cursor_style::block)
+		output += "\x1b[2 q";
+	else
+		output += "\x1b[4 q";
+}
+
+/*
+ * Control characters would be interpreted by the terminal, they are shown as
+ * '?' so the text can't move the cursor or change the terminal's state.
+ */
+static void putstring(std::string_view str)
+{
+	std::size_t start = output.size();
+	output += str;
+	for (std::size_t i = start; i < output.size(); ++i) {
+		auto c = static_cast<unsigned char>(output[i]);
+		if (c < ' ' || c == 127)
+			output[i] = '?';
+	}
+}
+
+static void clear_end_of_line()
+{
+	output += "\x1b[K";
+}
+
+static void cursor_visible(bool visible)
+{
+	output += visible ? "\x1b[?25h" : "\x1b[?25l";
+}
+
+const Screen_backend terminal_screen = {
+	initialize,
+	finalize,
+	dimension,
+	putstring,
+	cursor,
+	column,
+	clear_end_of_line,
+	cursor_style,
+	cursor_visible,
+	flush,
+};
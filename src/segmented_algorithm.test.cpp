@@ -0,0 +1,103 @@
+#include "segmented_algorithm.h"
+#include "chunked_gap_buffer.h"
+#include "gap_buffer.h"
+#include "piece_table.h"
+#include <cassert>
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+static std::string random_text(std::size_t n)
+{
+	// Include bytes above 127 so the comparisons see negative chars
+	const char alphabet[] = "ab\n\xe9";
+	std::string text(n, 0);
+	for (char& c : text)
+		c = alphabet[std::rand() % 4];
+	return text;
+}
+
+/*
+ * A gap buffer holding `text` with the gap at `gap`
+ */
+static Gap_buffer make_gap_buffer(const std::string& text, std::size_t gap)
+{
+	Gap_buffer x;
+	x.insert(x.end(), text.size(), 0);
+	std::copy(text.begin(), text.end(), x.begin());
+	x.insert(x.begin() + gap, 1, 0);
+	x.erase(x.begin() + gap, 1);
+	return x;
+}
+
+template <typename I>
+// requires SegmentedIterator(I)
+static void check_algorithms(I first, const std::string& text)
+{
+	for (int k = 0; k < 200; ++k) {
+		std::size_t f = std::rand() % (text.size() + 1);
+		std::size_t l = f + std::rand() % (text.size() - f + 1);
+		auto tf = text.begin() + f;
+		auto tl = text.begin() + l;
+
+		assert(find(first + f, first + l, '\n') - first == std::find(tf, tl, '\n') - text.begin());
+		assert(count(first + f, first + l, 'b') == std::count(tf, tl, 'b'));
+
+		std::string copied(l - f, 0);
+		assert(copy(first + f, first + l, copied.begin()) == copied.end());
+		assert(std::equal(copied.begin(), copied.end(), tf));
+		assert(equal(first + f, first + l, text.data() + f));
+
+		std::size_t m = std::rand() % 4;
+		std::string pattern = text.substr(std::rand() % (text.size() - m + 1), m);
+		auto expected = std::search(tf, tl, pattern.begin(), pattern.end());
+		I found = search(first + f, first + l, pattern.data(), pattern.data() + pattern.size());
+		assert(found - first == expected - text.begin());
+
+		std::size_t g = std::rand() % (text.size() + 1);
+		std::size_t n = std::min(l - f, text.size() - g);
+		assert(equal(first + f, first + f + n, first + g) == std::equal(tf, tf + n, text.begin() + g));
+		std::size_t h = g + std::rand() % (text.size() - g + 1);
+		assert(lexicographical_compare(first + f, first + l, first + g, first + h) ==
+		       std::lexicographical_compare(tf, tl, text.begin() + g, text.begin() + h));
+	}
+}
+
+static void check_comparisons()
+{
+	for (int k = 0; k < 500; ++k) {
+		std::string a = random_text(std::rand() % 8);
+		std::string b = std::rand() % 3 == 0 ? a : random_text(std::rand() % 8);
+		if (std::rand() % 3 == 0 && !a.empty())
+			b = a.substr(0, std::rand() % a.size());
+		Gap_buffer x = make_gap_buffer(a, std::rand() % (a.size() + 1));
+		Gap_buffer y = make_gap_buffer(b, std::rand() % (b.size() + 1));
+		assert((x == y) == (a == b));
+		bool less = std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+		assert((x < y) == less);
+	}
+}
+
+int main()
+{
+	std::string text = random_text(1000);
+	for (int k = 0; k < 10; ++k) {
+		Gap_buffer x = make_gap_buffer(text, std::rand() % (text.size() + 1));
+		check_algorithms(x.begin(), text);
+		check_algorithms(Indexed_iterator<Gap_buffer>(x, 0), text);
+	}
+
+	Piece_table y(text);
+	for (int k = 0; k < 20; ++k) {
+		std::size_t i = std::rand() % (y.size() + 1);
+		y.insert(y.begin() + i, 1, 'a');
+		text.insert(text.begin() + i, 'a');
+	}
+	check_algorithms(y.begin(), text);
+
+	std::string large = random_text(3 * Chunked_gap_buffer::block_size);
+	Chunked_gap_buffer z(large);
+	check_algorithms(z.begin(), large);
+
+	check_comparisons();
+}
@@ -0,0 +1,185 @@
+#include "snapshot.h"
+#include <algorithm>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+Snapshot::Snapshot(Text_storage& text)
+{
+	owner = text.share(spans);
+	spans.erase(std::remove_if(spans.begin(), spans.end(), [] (std::string_view span) {
+		return span.empty();
+	}), spans.end());
+	for (std::string_view span : spans)
+		length += span.size();
+}
+
+std::size_t Snapshot::size() const
+{
+	return length;
+}
+
+const std::vector<std::string_view>& Snapshot::segments() const
+{
+	return spans;
+}
+
+/*
+ * The directory part of `filename` including the trailing separator, empty
+ * for the current directory.
+ */
+static std::string directory_of(const std::string& filename)
+{
+#if defined(_WIN32)
+	std::string::size_type slash = filename.find_last_of("\\/:");
+#else
+	std::string::size_type slash = filename.rfind('/');
+#endif
+	if (slash == std::string::npos)
+		return std::string();
+	return filename.substr(0, slash + 1);
+}
+
+#if defined(_WIN32)
+
+unsigned long write_snapshot(const Snapshot& snapshot, const std::string& filename)
+{
+	std::string directory = directory_of(filename);
+	if (directory.empty())
+		directory = ".";
+	char temp_filename[MAX_PATH];
+	if (GetTempFileNameA(directory.c_str(), "RED", 0, temp_filename) == 0)
+		return GetLastError();
+
+	DWORD last_error = 0;
+	HANDLE file_handle = CreateFileA(temp_filename,
+					 GENERIC_WRITE,
+					 0,
+					 NULL,
+					 CREATE_ALWAYS,
+					 FILE_ATTRIBUTE_NORMAL,
+					 NULL);
+	if (file_handle != INVALID_HANDLE_VALUE) {
+		for (std::string_view segment : snapshot.segments()) {
+			while (!segment.empty() && last_error == 0) {
+				DWORD bytes = static_cast<DWORD>(std::min<std::size_t>(segment.size(), 1u << 30));
+				DWORD bytes_written;
+				if (WriteFile(file_handle, segment.data(), bytes, &bytes_written, NULL))
+					segment.remove_prefix(bytes_written);
+				else
+					last_error = GetLastError();
+			}
+		}
+		if (last_error == 0 && !FlushFileBuffers(file_handle))
+			last_error = GetLastError();
+		CloseHandle(file_handle);
+	} else {
+		last_error = GetLastError();
+	}
+
+	// The temporary file is on the same volume, so this is a rename
+	if (last_error == 0 && !MoveFileExA(temp_filename, filename.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+		last_error = GetLastError();
+	if (last_error != 0)
+		DeleteFileA(temp_filename);
+	return last_error;
+}
+
+#else
+
+/*
+ * Creates a new file next to `filename` to write to, stores its name in
+ * `temp_filename`.
+ */
+static int create_temp_file(const std::string& filename, std::string& temp_filename)
+{
+	std::string directory = directory_of(filename);
+	std::string base = filename.substr(directory.size());
+	for (unsigned attempt = 0; attempt < 100; ++attempt) {
+		temp_filename = directory + "." + base + ".red-" + std::to_string(getpid()) + "-" + std::to_string(attempt);
+		int fd = open(temp_filename.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+		if (fd != -1 || errno != EEXIST)
+			return fd;
+	}
+	errno = EEXIST;
+	return -1;
+}
+
+static unsigned long write_segments(int fd, const std::vector<std::string_view>& segments)
+{
+	std::vector<iovec> vectors;
+	vectors.reserve(segments.size());
+	for (std::string_view segment : segments) {
+		if (!segment.empty())
+			vectors.push_back({ const_cast<char*>(segment.data()), segment.size() });
+	}
+
+	iovec* first = vectors.data();
+	iovec* last = first + vectors.size();
+	while (first != last) {
+		int count = static_cast<int>(std::min<std::ptrdiff_t>(last - first, IOV_MAX));
+		ssize_t written = writev(fd, first, count);
+		if (written == -1) {
+			if (errno == EINTR)
+				continue;
+			return errno;
+		}
+		// Skip the vectors that were written, a short write leaves part of one
+		std::size_t n = written;
+		while (first != last && n >= first->iov_len) {
+			n -= first->iov_len;
+			++first;
+		}
+		if (n > 0) {
+			first->iov_base = static_cast<char*>(first->iov_base) + n;
+			first->iov_len -= n;
+		}
+	}
+	return 0;
+}
+
+unsigned long write_snapshot(const Snapshot& snapshot, const std::string& path)
+{
+	// Renaming over a symbolic link would replace the link, not the file
+	std::string filename = path;
+	if (char* resolved = realpath(path.c_str(), nullptr)) {
+		filename = resolved;
+		std::free(resolved);
+	}
+
+	std::string temp_filename;
+	int fd = create_temp_file(filename, temp_filename);
+	if (fd == -1)
+		return errno;
+
+	// Keep the permissions of the file being replaced
+	unsigned long last_error = 0;
+	struct stat status;
+	if (stat(filename.c_str(), &status) == 0 && fchmod(fd, status.st_mode & 07777) == -1)
+		last_error = errno;
+	if (last_error == 0)
+		last_error = write_segments(fd, snapshot.segments());
+	if (last_error == 0 && fsync(fd) == -1)
+		last_error = errno;
+	if (close(fd) == -1 && last_error == 0)
+		last_error = errno;
+
+	if (last_error == 0 && std::rename(temp_filename.c_str(), filename.c_str()) == -1)
+		last_error = errno;
+	if (last_error != 0)
+		unlink(temp_filename.c_str());
+	return last_error;
+}
+
+#endif
@@ -0,0 +1,101 @@
+#include "snapshot.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+static std::string read_file(const std::string& filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static std::string joined(const Snapshot& snapshot)
+{
+	std::string text;
+	for (std::string_view segment : snapshot.segments())
+		text += segment;
+	return text;
+}
+
+/*
+ * Mostly typing at one place, moving on now and then
+ */
+static std::size_t position_hint(int i)
+{
+	return 1000 + (i / 100) * 5000 + (i % 100) * 5;
+}
+
+int main()
+{
+	const std::string filename = "snapshot.test.txt";
+
+	std::string text;
+	for (int i = 0; text.size() < 1024 * 1024; ++i)
+		text += std::to_string(std::rand()) + (i % 7 == 0 ? "\n" : " ");
+	Text_storage storage;
+	storage.insert(storage.end(), std::string_view(text));
+	// Split the text into several segments
+	for (int i = 0; i < 10; ++i) {
+		std::size_t position = std::rand() % (storage.size() + 1);
+		storage.insert(storage.begin() + position, std::string_view("edit"));
+		text.insert(position, "edit");
+	}
+
+	// The snapshot doesn't see edits made after it was taken, at the gap
+	// or away from it, nor does a second one taken in between
+	Snapshot snapshot(storage);
+	assert(snapshot.size() == text.size());
+	std::string edited = text;
+	Snapshot second;
+	std::string second_text;
+	for (int i = 0; i < 2000; ++i) {
+		std::size_t position = i % 100 == 0 ? std::rand() % (edited.size() + 1) : std::min<std::size_t>(position_hint(i), edited.size());
+		if (std::rand() % 3 == 0 && position < edited.size()) {
+			storage.erase(storage.begin() + position, 1);
+			edited.erase(position, 1);
+		} else {
+			storage.insert(storage.begin() + position, std::string_view("typed"));
+			edited.insert(position, "typed");
+		}
+		if (i == 1000) {
+			second = Snapshot(storage);
+			second_text = edited;
+		}
+	}
+	assert(joined(snapshot) == text);
+	assert(joined(second) == second_text);
+	assert(joined(Snapshot(storage)) == edited);
+	storage.erase(storage.begin(), storage.size() / 2);
+	assert(joined(snapshot) == text);
+
+	std::ofstream(filename) << "old contents";
+	assert(write_snapshot(snapshot, filename) == 0);
+	assert(read_file(filename) == text);
+
+	assert(write_snapshot(Snapshot(), filename) == 0);
+	assert(read_file(filename).empty());
+
+	assert(write_snapshot(snapshot, "snapshot.test.missing/file.txt") != 0);
+
+#if !defined(_WIN32)
+	// Saving through a symbolic link replaces the file it points to
+	const std::string link = "snapshot.test.link";
+	std::remove(link.c_str());
+	assert(symlink(filename.c_str(), link.c_str()) == 0);
+	assert(write_snapshot(snapshot, link) == 0);
+	assert(read_file(filename) == text);
+	char target[64];
+	assert(readlink(link.c_str(), target, sizeof(target)) == static_cast<ssize_t>(filename.size()));
+	std::remove(link.c_str());
+#endif
+
+	std::remove(filename.c_str());
+}
@@ -0,0 +1,151 @@
+#include "terminal_keys.h"
+
+static Key_input decode_byte(unsigned char c)
+{
+	Key_input key;
+	key.ascii = static_cast<char>(c);
+	if (c == 127 || c == '\b') {
+		key.key = VK_BACK;
+		key.ascii = '\b';
+	} else if (c == '\t' || c == '\r' || c == 27) {
+		key.key = VkKeyScanA(static_cast<char>(c));
+	} else if (c == 0) {
+		key.key = CONTROL | VK_SPACE;
+	} else if (c < 27) {
+		key.key = CONTROL | (c - 1 + 'A');
+	} else if (c < ' ') {
+		// ^\ ^] ^^ ^_
+		const SHORT keys[] = { VK_OEM_5, VK_OEM_6, SHIFT | '6', SHIFT | VK_OEM_MINUS };
+		key.key = CONTROL | keys[c - 28];
+	} else {
+		SHORT scan = VkKeyScanA(static_cast<char>(c));
+		// Characters outside the layout, such as UTF-8 bytes, are only text
+		key.key = scan == -1 ? 0 : scan;
+	}
+	return key;
+}
+
+/*
+ * xterm modifier parameters are one more than a bit mask of shift, alt and
+ * control.
+ */
+static SHORT modifier_bits(int parameter)
+{
+	int mask = parameter > 1 ? parameter - 1 : 0;
+	SHORT bits = 0;
+	if (mask & 1)
+		bits |= SHIFT;
+	if (mask & 2)
+		bits |= ALT;
+	if (mask & 4)
+		bits |= CONTROL;
+	return bits;
+}
+
+static SHORT final_key(char final)
+{
+	switch (final) {
+	case 'A': return VK_UP;
+	case 'B': return VK_DOWN;
+	case 'C': return VK_RIGHT;
+	case 'D': return VK_LEFT;
+	case 'H': return VK_HOME;
+	case 'F': return VK_END;
+	case 'P': case 'Q': case 'R': case 'S': return VK_F1 + (final - 'P');
+	}
+	return 0;
+}
+
+static SHORT tilde_key(int parameter)
+{
+	switch (parameter) {
+	case 1: case 7: return VK_HOME;
+	case 2: return VK_INSERT;
+	case 3: return VK_DELETE;
+	case 4: case 8: return VK_END;
+	case 5: return VK_PRIOR;
+	case 6: return VK_NEXT;
+	case 11: case 12: case 13: case 14: return VK_F1 + (parameter - 11);
+	case 15: return VK_F1 + 4;
+	case 17: case 18: case 19: case 20: case 21: return VK_F1 + 5 + (parameter - 17);
+	case 23: case 24: return VK_F1 + 10 + (parameter - 23);
+	case 200: return KEY_PASTE_START;
+	case 201: return KEY_PASTE_END;
+	}
+	return 0;
+}
+
+/*
+ * Decodes ESC [ parameters final, returns zero if the sequence is incomplete
+ */
+static std::size_t decode_csi(std::string_view input, Key_input& key)
+{
+	int parameters[2] = { 0, 0 };
+	int count = 0;
+	std::size_t i = 2;
+	for (; i < input.size(); ++i) {
+		char c = input[i];
+		if (c >= '0' && c <= '9') {
+			if (count < 2 && parameters[count] < 10000)
+				parameters[count] = parameters[count] * 10 + (c - '0');
+		} else if (c == ';') {
+			++count;
+		} else if (c >= 0x40 && c <= 0x7E) {
+			break;
+		} else if (c < 0x20 || c > 0x3F) {
+			// Not a well formed sequence, drop what has been seen
+			key = Key_input{ 0, 0 };
+			return i;
+		}
+	}
+	if (i == input.size())
+		return 0;
+
+	char final = input[i];
+	SHORT code = final == '~' ? tilde_key(parameters[0]) : final_key(final);
+	key.key = code ? code | modifier_bits(parameters[1]) : 0;
+	key.ascii = 0;
+	return i + 1;
+}
+
+std::size_t decode_terminal_key(std::string_view input, bool more, Key_input& key)
+{
+	if (input.empty())
+		return 0;
+
+	auto c = static_cast<unsigned char>(input[0]);
+	if (c != 27) {
+		key = decode_byte(c);
+		return 1;
+	}
+
+	if (input.size() == 1) {
+		if (more)
+			return 0;
+		key = decode_byte(c);
+		return 1;
+	}
+
+	if (input[1] == '[') {
+		std::size_t n = decode_csi(input, key);
+		if (n != 0 || more)
+			return n;
+	} else if (input[1] == 'O') {
+		if (input.size() > 2) {
+			SHORT code = final_key(input[2]);
+			key = Key_input{ code, 0 };
+			return 3;
+		}
+		if (more)
+			return 0;
+	} else if (input[1] != 27) {
+		// ESC followed by a key is that key with ALT held
+		key = decode_byte(static_cast<unsigned char>(input[1]));
+		if (key.key != 0)
+			key.key |= ALT;
+		return 2;
+	}
+
+	key = decode_byte(c);
+	return 1;
+}
@@ -0,0 +1,54 @@
+#include "terminal_keys.h"
+#include <cassert>
+#include <string_view>
+
+static Key_input decode(std::string_view input, std::size_t expected_length)
+{
+	Key_input key;
+	std::size_t n = decode_terminal_key(input, false, key);
+	assert(n == expected_length);
+	return key;
+}
+
+int main()
+{
+	// Characters use the codes VkKeyScanA gives, as command.cpp's binds do
+	assert(decode("h", 1).key == VkKeyScanA('h') && decode("h", 1).ascii == 'h');
+	assert(decode("G", 1).key == (SHIFT | 'G'));
+	assert(decode("$", 1).key == VkKeyScanA('$'));
+	assert(decode("/", 1).key == VkKeyScanA('/'));
+	assert(decode("\x18", 1).key == (CONTROL | VkKeyScanA('x')));
+	assert(decode("\x05", 1).key == (CONTROL | VkKeyScanA('e')));
+	assert(decode("\r", 1).key == VK_RETURN);
+	assert(decode("\t", 1).key == VK_TAB);
+	assert(decode("\x7f", 1).key == VK_BACK);
+	assert(decode("\x1b", 1).key == VK_ESCAPE && decode("\x1b", 1).ascii == 27);
+	assert(decode("\xc3", 1).key == 0 && decode("\xc3", 1).ascii == '\xc3');
+
+	// Cursor and editing keys, with and without modifiers
+	assert(decode("\x1b[A", 3).key == VK_UP);
+	assert(decode("\x1bOD", 3).key == VK_LEFT);
+	assert(decode("\x1b[H", 3).key == VK_HOME);
+	assert(decode("\x1b[4~", 4).key == VK_END);
+	assert(decode("\x1b[3~x", 4).key == VK_DELETE);
+	assert(decode("\x1b[1;5H", 6).key == (CONTROL | VK_HOME));
+	assert(decode("\x1b[1;5F", 6).key == (CONTROL | VK_END));
+	assert(decode("\x1b[1;2C", 6).key == (SHIFT | VK_RIGHT));
+	assert(decode("\x1b[6;3~", 6).key == (ALT | VK_NEXT));
+	assert(decode("\x1b[200~", 6).key == KEY_PASTE_START);
+	assert(decode("\x1b[201~", 6).key == KEY_PASTE_END);
+
+	// ESC before a key is ALT
+	assert(decode("\x1bx", 2).key == (ALT | VkKeyScanA('x')));
+
+	// Unknown sequences are consumed whole
+	assert(decode("\x1b[99z", 5).key == 0);
+
+	// Incomplete sequences wait for more input, unless there is none
+	Key_input key;
+	assert(decode_terminal_key("\x1b", true, key) == 0);
+	assert(decode_terminal_key("\x1b[1;", true, key) == 0);
+	assert(decode_terminal_key("\x1bO", true, key) == 0);
+	assert(decode("\x1b[1;", 1).key == VK_ESCAPE);
+	assert(decode_terminal_key("", false, key) == 0);
+}
@@ -0,0 +1,159 @@
+#include "text_search.h"
+#include "byte_search.h"
+#include <cstring>
+
+/*
+ * A rough rank of how often a byte turns up in prose and source code, higher
+ * is more common.  Only the order matters, it picks the anchor byte.
+ */
+static int byte_frequency(unsigned char c)
+{
+	static const char common_letters[] = "etaoinsrhldcumfpgwybvkxjqz";
+	if (c == ' ')
+		return 1000;
+	if (c == '\n' || c == '\t')
+		return 400;
+	if (c >= 'a' && c <= 'z')
+		return 500 - 10 * static_cast<int>(std::strchr(common_letters, c) - common_letters);
+	if (c >= 'A' && c <= 'Z')
+		return 200 - 5 * static_cast<int>(std::strchr(common_letters, c - 'A' + 'a') - common_letters);
+	if (c >= '0' && c <= '9')
+		return 150;
+	if (c != '\0' && std::strchr("_.,;()=\"'-*/:>{}<", c))
+		return 120;
+	if (c < 0x80)
+		return c >= 0x20 && c < 0x7F ? 40 : 10;
+	return 20;
+}
+
+Literal_pattern::Literal_pattern() :
+	Literal_pattern(std::string_view())
+{
+}
+
+Literal_pattern::Literal_pattern(std::string_view pattern) :
+	text(pattern)
+{
+	auto m = static_cast<unsigned>(text.size());
+	forward_shift.fill(m);
+	backward_shift.fill(m);
+	for (unsigned i = 0; i + 1 < m; ++i)
+		forward_shift[static_cast<unsigned char>(text[i])] = m - 1 - i;
+	for (unsigned i = m; i-- > 1;)
+		backward_shift[static_cast<unsigned char>(text[i])] = i;
+
+	for (std::size_t i = 1; i < text.size(); ++i) {
+		if (byte_frequency(text[i]) < byte_frequency(text[anchor_offset]))
+			anchor_offset = i;
+	}
+}
+
+/*
+ * Candidates the anchor may produce before we check whether it is too common,
+ * and the fewest bytes scanned per candidate for it to be worth keeping.
+ */
+static constexpr std::size_t anchor_trial = 32;
+static constexpr std::ptrdiff_t anchor_stride = 16;
+
+const char* Literal_pattern::find(const char* first, const char* last) const
+{
+	std::size_t m = text.size();
+	if (m == 0)
+		return first;
+	if (static_cast<std::size_t>(last - first) < m)
+		return last;
+	if (m == 1)
+		return find_byte(first, last, text[0]);
+
+	const char* p = text.data();
+	char anchor = p[anchor_offset];
+	// The anchor of a match starting at s is at s + anchor_offset
+	const char* a = first + anchor_offset;
+	const char* a_last = last - m + anchor_offset + 1;
+	std::size_t candidates = 0;
+	while (a != a_last) {
+		a = find_byte(a, a_last, anchor);
+		if (a == a_last)
+			break;
+		const char* s = a - anchor_offset;
+		if (std::memcmp(s, p, m) == 0)
+			return s;
+		++a;
+		if (++candidates == anchor_trial) {
+			candidates = 0;
+			if (a - first < static_cast<std::ptrdiff_t>(anchor_trial) * anchor_stride)
+				return horspool(s + 1, last);
+			first = a;
+		}
+	}
+	return last;
+}
+
+const char* Literal_pattern::find_backward(const char* first, const char* last) const
+{
+	std::size_t m = text.size();
+	if (m == 0)
+		return last;
+	if (static_cast<std::size_t>(last - first) < m)
+		return last;
+	if (m == 1) {
+		const char* hit = find_byte_backward(first, last, text[0]);
+		return hit != first ? hit - 1 : last;
+	}
+
+	const char* p = text.data();
+	char anchor = p[anchor_offset];
+	// find_byte_backward returns the position after the anchor
+	const char* a_first = first + anchor_offset;
+	const char* a = last - m + anchor_offset + 1;
+	const char* scanned_from = last;
+	std::size_t candidates = 0;
+	while (a != a_first) {
+		a = find_byte_backward(a_first, a, anchor);
+		if (a == a_first)
+			break;
+		const char* s = a - 1 - anchor_offset;
+		if (std::memcmp(s, p, m) == 0)
+			return s;
+		--a;
+		if (++candidates == anchor_trial) {
+			candidates = 0;
+			if (scanned_from - a < static_cast<std::ptrdiff_t>(anchor_trial) * anchor_stride) {
+				// The matches left start before s
+				const char* hit = horspool_backward(first, s - 1 + m);
+				return hit != s - 1 + m ? hit : last;
+			}
+			scanned_from = a;
+		}
+	}
+	return last;
+}
+
+const char* Literal_pattern::horspool(const char* first, const char* last) const
+{
+	std::size_t m = text.size();
+	const char* p = text.data();
+	for (const char* s = first; last - s >= static_cast<std::ptrdiff_t>(m);) {
+		unsigned char c = s[m - 1];
+		if (c == static_cast<unsigned char>(p[m - 1]) && std::memcmp(s, p, m - 1) == 0)
+			return s;
+		s += forward_shift[c];
+	}
+	return last;
+}
+
+const char* Literal_pattern::horspool_backward(const char* first, const char* last) const
+{
+	std::size_t m = text.size();
+	const char* p = text.data();
+	if (last - first < static_cast<std::ptrdiff_t>(m))
+		return last;
+	for (const char* s = last - m;;) {
+		unsigned char c = s[0];
+		if (c == static_cast<unsigned char>(p[0]) && std::memcmp(s + 1, p + 1, m - 1) == 0)
+			return s;
+		if (s - first < static_cast<std::ptrdiff_t>(backward_shift[c]))
+			return last;
+		s -= backward_shift[c];
+	}
+}
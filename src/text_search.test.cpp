@@ -0,0 +1,107 @@
+#include "text_search.h"
+#include "chunked_gap_buffer.h"
+#include "gap_buffer.h"
+#include "piece_table.h"
+#include <cassert>
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+static std::string random_text(std::size_t n, const char* alphabet)
+{
+	std::size_t k = std::char_traits<char>::length(alphabet);
+	std::string text(n, 0);
+	for (char& c : text)
+		c = alphabet[std::rand() % k];
+	return text;
+}
+
+/*
+ * A pattern that usually occurs in `text`, sometimes one that doesn't
+ */
+static std::string random_pattern(const std::string& text, std::size_t max_size)
+{
+	std::size_t m = std::min(text.size(), static_cast<std::size_t>(std::rand()) % (max_size + 1));
+	std::string pattern = text.substr(std::rand() % (text.size() - m + 1), m);
+	if (std::rand() % 4 == 0 && !pattern.empty())
+		pattern[std::rand() % m] = 'z';
+	return pattern;
+}
+
+static void check_contiguous()
+{
+	// Texts where the anchor is rare, and ones so repetitive the search has
+	// to fall back to Horspool
+	const char* alphabets[] = { "abcdefghij \n", "ab", "a", "ab\n\xe9" };
+	for (const char* alphabet : alphabets) {
+		for (int k = 0; k < 300; ++k) {
+			std::string text = random_text(1 + std::rand() % 3000, alphabet);
+			std::string pattern = random_pattern(text, 12);
+			Literal_pattern compiled(pattern);
+			std::size_t f = std::rand() % (text.size() + 1);
+			std::size_t l = f + std::rand() % (text.size() - f + 1);
+			std::string_view range(text.data() + f, l - f);
+			const char* first = text.data() + f;
+			const char* last = text.data() + l;
+
+			std::size_t expected = range.find(pattern);
+			const char* found = compiled.find(first, last);
+			assert(found == (expected == std::string_view::npos ? last : first + expected));
+
+			expected = range.rfind(pattern);
+			found = compiled.find_backward(first, last);
+			assert(found == (expected == std::string_view::npos ? last : first + expected));
+		}
+	}
+}
+
+template <typename I>
+// requires SegmentedIterator(I)
+static void check_segmented(I first, const std::string& text)
+{
+	for (int k = 0; k < 200; ++k) {
+		std::size_t f = std::rand() % (text.size() + 1);
+		std::size_t l = f + std::rand() % (text.size() - f + 1);
+		std::string_view range(text.data() + f, l - f);
+		std::string pattern = random_pattern(text, 10);
+		Literal_pattern compiled(pattern);
+
+		std::size_t expected = range.find(pattern);
+		I found = find_pattern(compiled, first + f, first + l);
+		assert(found - first == static_cast<std::ptrdiff_t>(expected == std::string_view::npos ? l : f + expected));
+
+		expected = range.rfind(pattern);
+		found = find_pattern_backward(compiled, first + f, first + l);
+		assert(found - first == static_cast<std::ptrdiff_t>(expected == std::string_view::npos ? l : f + expected));
+	}
+}
+
+int main()
+{
+	check_contiguous();
+
+	std::string text = random_text(1000, "ab\n");
+	for (int k = 0; k < 10; ++k) {
+		Gap_buffer x;
+		x.insert(x.end(), std::string_view(text));
+		std::size_t gap = std::rand() % (text.size() + 1);
+		x.insert(x.begin() + gap, 1, 0);
+		x.erase(x.begin() + gap, 1);
+		check_segmented(x.begin(), text);
+		check_segmented(Indexed_iterator<Gap_buffer>(x, 0), text);
+	}
+
+	// Single byte pieces, so matches straddle many segments
+	Piece_table y(text);
+	for (int k = 0; k < 200; ++k) {
+		std::size_t i = std::rand() % (y.size() + 1);
+		char c = "ab\n"[std::rand() % 3];
+		y.insert(y.begin() + i, 1, c);
+		text.insert(text.begin() + i, c);
+	}
+	check_segmented(y.begin(), text);
+
+	std::string large = random_text(3 * Chunked_gap_buffer::block_size, "ab\n");
+	Chunked_gap_buffer z(large);
+	check_segmented(z.begin(), large);
+}
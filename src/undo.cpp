@@ -0,0 +1,161 @@
+#include "undo.h"
+#include <cassert>
+#include <algorithm>
+
+void Undo_journal::begin_group(size_type cursor)
+{
+	assert(!open);
+	open = true;
+	recording = false;
+	cursor_before = cursor;
+}
+
+void Undo_journal::end_group(size_type cursor)
+{
+	// The buffer may have been replaced by a new one during the group
+	if (!open)
+		return;
+	if (recording) {
+		Group& group = groups[current - 1];
+		group.cursor_after = cursor;
+		// Everything typed was erased again
+		if (group.edits.empty()) {
+			memory -= group.memory;
+			groups.pop_back();
+			--current;
+		}
+	}
+	open = false;
+	recording = false;
+}
+
+/*
+ * The group to record an edit at `position` in.  The first edit of a group
+ * discards anything that could be redone.  Edits made outside of a group get
+ * a group each.
+ */
+Undo_journal::Group& Undo_journal::recording_group(size_type position)
+{
+	if (open && recording)
+		return groups[current - 1];
+
+	while (groups.size() > current) {
+		memory -= groups.back().memory;
+		groups.pop_back();
+	}
+	groups.emplace_back();
+	Group& group = groups.back();
+	group.cursor_before = open ? cursor_before : position;
+	group.cursor_after = position;
+	++current;
+	recording = open;
+	return group;
+}
+
+void Undo_journal::account(Group& group)
+{
+	memory -= group.memory;
+	group.memory = sizeof(Group) + group.arena.capacity() + group.edits.capacity() * sizeof(Edit);
+	memory += group.memory;
+	evict();
+}
+
+/*
+ * Drops the oldest groups until the history fits in the limit, keeping the
+ * group being recorded.
+ */
+void Undo_journal::evict()
+{
+	while (memory > limit && current > 1) {
+		memory -= groups.front().memory;
+		groups.pop_front();
+		--current;
+	}
+}
+
+void Undo_journal::record_insert(size_type position, std::string_view text)
+{
+	if (replaying || text.empty())
+		return;
+
+	Group& group = recording_group(position);
+	Edit* last = group.edits.empty() ? nullptr : &group.edits.back();
+	if (last && last->kind == Undo_edit::Kind::insert && last->position + last->length == position) {
+		// Typing, the last edit's text is always at the end of the arena
+		last->length += text.size();
+	} else {
+		group.edits.push_back({ Undo_edit::Kind::insert, position, text.size(), group.arena.size() });
+	}
+	group.arena.append(text);
+	account(group);
+}
+
+void Undo_journal::record_erase(const Text_storage& text, size_type position, size_type n)
+{
+	if (replaying || n == 0)
+		return;
+
+	std::string erased;
+	erased.reserve(n);
+	for (size_type i = position; i < position + n;) {
+		std::string_view segment = text.segment_from(i).substr(0, position + n - i);
+		erased.append(segment);
+		i += segment.size();
+	}
+
+	Group& group = recording_group(position);
+	Edit* last = group.edits.empty() ? nullptr : &group.edits.back();
+	if (last && last->kind == Undo_edit::Kind::insert && position >= last->position &&
+	    position + n == last->position + last->length) {
+		// Backspacing over text typed in this group
+		last->length -= n;
+		group.arena.resize(group.arena.size() - n);
+		if (last->length == 0)
+			group.edits.pop_back();
+	} else if (last && last->kind == Undo_edit::Kind::erase && last->position == position) {
+		// Deleting forward
+		last->length += n;
+		group.arena.append(erased);
+	} else if (last && last->kind == Undo_edit::Kind::erase && position + n == last->position) {
+		// Backspacing
+		group.arena.insert(last->offset, erased);
+		last->position = position;
+		last->length += n;
+	} else if (group.edits.empty() && group.arena.empty()) {
+		group.edits.push_back({ Undo_edit::Kind::erase, position, n, 0 });
+		group.arena = std::move(erased);
+	} else {
+		group.edits.push_back({ Undo_edit::Kind::erase, position, n, group.arena.size() });
+		group.arena.append(erased);
+	}
+	account(group);
+}
+
+bool Undo_journal::can_undo() const
+{
+	return current > 0;
+}
+
+bool Undo_journal::can_redo() const
+{
+	return current < groups.size();
+}
+
+Undo_journal::size_type Undo_journal::memory_used() const
+{
+	return memory;
+}
+
+void Undo_journal::set_limit(size_type bytes)
+{
+	limit = bytes;
+	evict();
+}
+
+void Undo_journal::clear()
+{
+	groups.clear();
+	current = 0;
+	memory = 0;
+	recording = false;
+}
@@ -0,0 +1,154 @@
+#include "buffer.h"
+#include <cassert>
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+static std::string contents(Buffer& buffer)
+{
+	return std::string(buffer.begin(), buffer.end());
+}
+
+static void check_random_edits()
+{
+	Buffer buffer;
+	std::vector<std::string> states{ "" };
+	std::vector<Buffer::size_type> cursors{ 0 };
+	for (int i = 0; i < 500; ++i) {
+		Buffer::size_type size = buffer.contents.size();
+		Buffer::size_type position = std::rand() % (size + 1);
+		buffer.history.begin_group(position);
+		for (int j = std::rand() % 4; j >= 0; --j) {
+			size = buffer.contents.size();
+			position = std::rand() % (size + 1);
+			switch (std::rand() % 3) {
+			case 0:
+				buffer.insert(buffer.begin() + position, std::string(std::rand() % 20, 'a' + std::rand() % 26));
+				break;
+			case 1: {
+				Buffer::size_type n = std::min<Buffer::size_type>(std::rand() % 20, size - position);
+				buffer.erase(buffer.begin() + position, buffer.begin() + position + n);
+				break;
+			}
+			default: {
+				Buffer::size_type n = std::min<Buffer::size_type>(std::rand() % 20, size - position);
+				buffer.replace(buffer.begin() + position, buffer.begin() + position + n, "replaced");
+				break;
+			}
+			}
+		}
+		buffer.history.end_group(position);
+		if (contents(buffer) != states.back()) {
+			states.push_back(contents(buffer));
+			cursors.push_back(position);
+		}
+	}
+
+	Buffer::iterator cursor = buffer.begin();
+	for (auto state = states.rbegin() + 1; state != states.rend(); ++state) {
+		assert(buffer.undo(cursor));
+		assert(contents(buffer) == *state);
+		assert(buffer.line_count() == std::size_t(std::count(state->begin(), state->end(), '\n')) + 1);
+	}
+	assert(!buffer.undo(cursor));
+	for (std::size_t i = 1; i < states.size(); ++i) {
+		assert(buffer.redo(cursor));
+		assert(contents(buffer) == states[i]);
+		assert(cursor.index == std::min(cursors[i], states[i].size()));
+	}
+	assert(!buffer.redo(cursor));
+}
+
+static void check_coalescing()
+{
+	Buffer buffer;
+	buffer.insert(buffer.begin(), std::string_view("hello world"));
+	buffer.history.clear();
+	Buffer::iterator cursor = buffer.begin();
+
+	// Typing and backspacing in one group is one edit
+	buffer.history.begin_group(5);
+	for (char c : std::string(" there"))
+		buffer.insert(buffer.begin() + buffer.contents.size() - 6, c);
+	buffer.erase(buffer.begin() + 10);
+	buffer.erase(buffer.begin() + 9);
+	buffer.history.end_group(9);
+	assert(contents(buffer) == "hello the world");
+	assert(buffer.undo(cursor));
+	assert(contents(buffer) == "hello world");
+	assert(cursor.index == 5);
+
+	// Backspacing over everything typed leaves nothing to undo
+	assert(buffer.history.can_redo());
+	buffer.history.begin_group(0);
+	buffer.insert(buffer.begin(), 'x');
+	buffer.erase(buffer.begin());
+	buffer.history.end_group(0);
+	assert(contents(buffer) == "hello world");
+	assert(!buffer.history.can_undo() && !buffer.history.can_redo());
+
+	// Backspacing and deleting forward
+	buffer.history.begin_group(6);
+	buffer.erase(buffer.begin() + 5);
+	buffer.erase(buffer.begin() + 4);
+	buffer.erase(buffer.begin() + 4);
+	buffer.erase(buffer.begin() + 4);
+	buffer.history.end_group(4);
+	assert(contents(buffer) == "hellrld");
+	assert(!buffer.history.can_redo());
+	std::size_t memory = buffer.history.memory_used();
+	assert(buffer.undo(cursor));
+	assert(contents(buffer) == "hello world" && cursor.index == 6);
+	assert(buffer.redo(cursor));
+	assert(contents(buffer) == "hellrld" && cursor.index == 4);
+	assert(buffer.history.memory_used() == memory);
+}
+
+static void check_large_erase()
+{
+	const std::size_t n = 50 * 1024 * 1024;
+	Buffer buffer;
+	std::string text(n, 'x');
+	for (std::size_t i = 0; i < n; i += 4096)
+		text[i] = '\n';
+	buffer.insert(buffer.begin(), text);
+	buffer.history.clear();
+
+	Buffer::iterator cursor = buffer.begin();
+	buffer.erase(buffer.begin(), buffer.end());
+	assert(buffer.contents.size() == 0);
+	int edits = 0;
+	buffer.history.undo([&] (const Undo_edit& edit) {
+		assert(edit.kind == Undo_edit::Kind::insert && edit.text.size() == n);
+		buffer.insert(buffer.begin() + edit.position, edit.text);
+		++edits;
+	}, cursor.index);
+	assert(edits == 1);
+	assert(contents(buffer) == text);
+	assert(buffer.line_count() == n / 4096 + 1);
+}
+
+static void check_limit()
+{
+	Buffer buffer;
+	buffer.history.set_limit(64 * 1024);
+	for (int i = 0; i < 1000; ++i)
+		buffer.insert(buffer.end(), std::string(1024, 'a' + i % 26));
+	assert(buffer.history.memory_used() <= 64 * 1024);
+
+	Buffer::iterator cursor = buffer.begin();
+	int undone = 0;
+	while (buffer.undo(cursor))
+		++undone;
+	assert(undone > 0 && undone < 1000);
+	assert(buffer.contents.size() == std::size_t(1000 - undone) * 1024);
+}
+
+int main()
+{
+	check_random_edits();
+	check_coalescing();
+	check_large_erase();
+	check_limit();
+}